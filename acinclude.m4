@@ -110,6 +110,30 @@ AC_DEFUN([MK_AM_GEOIP], [
   fi
 ])
 
+AC_DEFUN([MK_AM_ZLIB], [
+
+  AC_ARG_WITH([zlib],
+              [AS_HELP_STRING([--with-zlib],
+                [zlib compression library @<:@default=check@:>@])
+              ],
+              [
+                CPPFLAGS="$CPPFLAGS -I$withval/include"
+                LDFLAGS="$LDFLAGS -L$withval/lib"
+              ],
+              [])
+
+  mk_not_found=""
+  AC_CHECK_HEADERS(zlib.h, [], [mk_not_found=1])
+  AC_CHECK_LIB(z, inflateInit2_, [], [mk_not_found=1])
+
+  if test "$mk_not_found" = "1"; then
+    AC_MSG_WARN([Failed to find dependency: zlib])
+    echo "    - to install on Debian: sudo apt-get install zlib1g-dev"
+    echo "    - to install on OSX: zlib is part of the base system"
+    AC_MSG_ERROR([Please, install zlib and run configure again])
+  fi
+])
+
 AC_DEFUN([MK_AM_OPENSSL], [
 
   AC_ARG_WITH([openssl],
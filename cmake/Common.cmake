@@ -107,13 +107,21 @@ if(UNIX)
     message(FATAL_ERROR "libevent missing; Use -DMK_LIBEVENT to specify where it is installed (e.g. -DMK_LIBEVENT=/usr/local if it is installed under /usr/local)")
   endif()
 
+  # zlib
+
+  CHECK_INCLUDE_FILES(zlib.h HAVE_ZLIB_H)
+  CHECK_LIBRARY_EXISTS(z inflateInit2_ "" HAVE_LIBZ)
+  if (NOT HAVE_ZLIB_H OR NOT HAVE_LIBZ)
+    message(FATAL_ERROR "zlib missing; please install it using your package manager")
+  endif()
+
   # libresolv (required by `./test/common/encoding`)
   CHECK_LIBRARY_EXISTS(resolv hstrerror "" HAVE_LIBRESOLV)
   if (HAVE_LIBRESOLV)
     list(APPEND MK_LIBS resolv)
   endif()
 
-  list(APPEND MK_LIBS GeoIP crypto ssl event event_openssl event_pthreads)
+  list(APPEND MK_LIBS GeoIP crypto ssl event event_openssl event_pthreads z)
 endif()
 
 # Add targets
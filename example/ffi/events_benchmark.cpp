@@ -0,0 +1,105 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include <measurement_kit/ffi.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Compares the speed at which the events of tasks are retrieved one at a
+// time and many at a time. To measure only the cost of retrieving them, we
+// wait for the tasks to queue all their events before retrieving them.
+//
+// Usage: events_benchmark [tasks [max_events [settings]]]
+//
+// By default, the tasks are tcp_connect tests with DEBUG2 verbosity, which
+// fail to contact the bouncer (a closed port of the local host) and thus
+// only emit a burst of events, so no network is needed.
+
+static const char *default_settings =
+      "{\"type\": \"TcpConnect\", \"verbosity\": \"DEBUG2\", \"options\": "
+      "{\"bouncer_base_url\": \"http://127.0.0.1:1\"}}";
+
+static std::vector<mk_task_t *> start_tasks(int count, const char *settings) {
+    std::vector<mk_task_t *> tasks;
+    for (int i = 0; i < count; ++i) {
+        mk_task_t *task = mk_task_start(settings);
+        if (task == nullptr) {
+            std::clog << "ERROR: cannot start task" << std::endl;
+            exit(1);
+        }
+        tasks.push_back(task);
+    }
+    for (auto task : tasks) {
+        while (mk_task_is_running(task)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    return tasks;
+}
+
+static void report(const char *what, size_t count, size_t bytes,
+                   std::chrono::steady_clock::time_point begin) {
+    std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - begin;
+    std::cout << what << ": " << count << " events (" << bytes << " bytes) in "
+              << elapsed.count() << " s: " << count / elapsed.count()
+              << " events/s" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    int count = (argc > 1) ? atoi(argv[1]) : 1000;
+    size_t max_events = (argc > 2) ? (size_t)atoi(argv[2]) : 1024;
+    const char *settings = (argc > 3) ? argv[3] : default_settings;
+
+    {
+        std::vector<mk_task_t *> tasks = start_tasks(count, settings);
+        size_t events = 0, bytes = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (auto task : tasks) {
+            for (;;) {
+                mk_event_t *event = mk_task_wait_for_next_event(task);
+                const char *serio = mk_event_serialize(event);
+                bool done = strcmp(serio, "null") == 0;
+                if (!done) {
+                    events += 1;
+                    bytes += strlen(serio) + 1;
+                }
+                mk_event_destroy(event);
+                if (done) {
+                    break;
+                }
+            }
+        }
+        report("one at a time", events, bytes, begin);
+        for (auto task : tasks) {
+            mk_task_destroy(task);
+        }
+    }
+
+    {
+        std::vector<mk_task_t *> tasks = start_tasks(count, settings);
+        mk_events_t *buffer = mk_events_create();
+        size_t events = 0, bytes = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (auto task : tasks) {
+            int terminated = 0;
+            while (!terminated) {
+                events += mk_task_wait_for_events(task, buffer, max_events,
+                                                  -1.0, &terminated);
+                bytes += mk_events_size(buffer);
+            }
+        }
+        report("many at a time", events, bytes, begin);
+        mk_events_destroy(buffer);
+        for (auto task : tasks) {
+            mk_task_destroy(task);
+        }
+    }
+}
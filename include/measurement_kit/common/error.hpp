@@ -178,6 +178,10 @@ MK_DEFINE_ERR(16, TimeoutError, "generic_timeout_error")
 /// `JsonProcessingError` indicates an error processing a JSON.
 MK_DEFINE_ERR(17, JsonProcessingError, "json_processing_error")
 
+/// `DeadlineExceededError` indicates that an operation was interrupted
+/// because the measurement it belongs to ran out of time.
+MK_DEFINE_ERR(18, DeadlineExceededError, "deadline_exceeded")
+
 /// \brief `MK_ERR_NET` takes a relative error code and returns an error code
 /// inside of the error codes space reserved for the net sub-library.
 #define MK_ERR_NET(x) (1000 + x)
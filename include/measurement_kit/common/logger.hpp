@@ -7,6 +7,7 @@
 #include <cstdint>
 #include <measurement_kit/common/aaa_base.h>
 #include <measurement_kit/common/callback.hpp>
+#include <measurement_kit/common/json.hpp>
 #include <measurement_kit/common/shared_ptr.hpp>
 #include <stdarg.h>
 
@@ -168,6 +169,20 @@ class Logger {
     /// `on_event()` allows to set the MK_LOG_EVENT handler.
     virtual void on_event(Callback<const char *> &&fn) = 0;
 
+    /// \brief `on_json_event()` allows to set the handler of the events
+    /// emitted with emit_event(), which receives them as JSON objects.
+    virtual void on_json_event(Callback<Json &&> &&fn) = 0;
+
+    /// \brief `emit_event()` emits an event. \param event is a JSON
+    /// object whose "type" key is the name of the event.
+    ///
+    /// If you set an handler with on_json_event(), the event is passed to
+    /// such handler, regardless of the verbosity. Otherwise, the event is
+    /// serialized and passed to log() with MK_LOG_EVENT and MK_LOG_INFO,
+    /// such that it is processed like events emitted as log messages
+    /// (e.g. it is passed to the handler set with on_event()).
+    virtual void emit_event(Json &&event) = 0;
+
     /// \brief `on_progress()` allows to set the progress handler. Progress
     /// is emitted when the test proceeeds.
     virtual void on_progress(Callback<double, const char *> &&fn) = 0;
@@ -18,6 +18,7 @@
 #ifdef MK_ENGINE_INTERNALS
 
 #include <memory>
+#include <vector>
 
 #include <measurement_kit/common/nlohmann/json.hpp>
 
@@ -31,12 +32,15 @@ class TaskImpl;
 /// by passing it the desired settings as a nlohmann::json. The minimal settings
 /// JSON must include the task type (see MK_ENUM_TASK for all types).
 ///
-/// Creating a Task also creates the thread that will run it. Altough you can
-/// construct more than one Task at a time, Measurement Kit will make sure that
-/// tasks run sequentially in the order in which they were created.
+/// Creating a Task also creates the thread that will run it. You can construct
+/// more than one Task at a time, and Measurement Kit will run up to four of them
+/// concurrently, in the order in which they were created, as long as they do
+/// not need more sockets than allowed by the limit on open files. Tasks that
+/// measure the bandwidth (see MK_ENUM_TASK) always run alone.
 ///
 /// A Task will emits events while running, which you can retrieve using the
-/// wait_for_next_event() call, which blocks until next event occurs. You can
+/// wait_for_next_event() call, which blocks until next event occurs, or, many
+/// at a time, using the wait_for_next_events() call. You can
 /// configure a Task to disable some or all events. Regardless of whether there
 /// are enabled events, wait_for_next_event() will return the `null` JSON
 /// when the task has terminated.
@@ -58,6 +62,18 @@ class Task {
     /// wait_for_next_event() blocks until the next event occurs.
     nlohmann::json wait_for_next_event();
 
+    /// wait_for_next_events() blocks until the next event occurs, the task
+    /// terminates, or \p timeout seconds elapse (if \p timeout is negative,
+    /// it waits like wait_for_next_event()). Then it appends the events that
+    /// occurred, up to \p max_events, to \p events. If \p terminated is not
+    /// null, it is set to true iff the task terminated and all its events
+    /// have been consumed, i.e., there is no point in calling again. Do not
+    /// use is_running() for that, since a task stops running after emitting
+    /// its last events. \return the number of events appended.
+    size_t wait_for_next_events(std::vector<nlohmann::json> &events,
+                                size_t max_events, double timeout,
+                                bool *terminated = nullptr);
+
     /// is_running() returns true iff the task is running.
     bool is_running() const;
 
@@ -132,13 +148,58 @@ class Task {
  *   "type": "Ndt"
  * }
  * ```
+ *
+ * The LOG event contains the "verbosity" and the "message" of a log line.
+ * When the events are not consumed as fast as they are emitted, consecutive
+ * LOG events with the same verbosity are coalesced and their "message"
+ * contains many log lines, separated by newlines.
+ *
+ * The PROGRESS event contains the "percentage" of completion of the task,
+ * between zero and one, and a "message" describing the current operation.
+ * Only the latest PROGRESS event that was not consumed yet is kept.
+ *
+ * The RESULT event is emitted for each measurement and contains the
+ * measurement entry, serialized as a JSON string, in the "json_str" key.
+ *
+ * The PERFORMANCE event reports the speed measured by NDT and DASH, in the
+ * "direction", "num_streams" and "speed_kbit_s" keys. For tests using the
+ * "adaptive_parallelism" option, it also reports, in the "parallelism" key,
+ * how many measurements may run in parallel whenever that changes, and in
+ * the "running" key how many were running. Both kinds of PERFORMANCE event
+ * contain the "elapsed_seconds" key.
+ *
+ * The QUEUED event is emitted when a task cannot run immediately, because of
+ * the other running tasks, and whenever its position in the queue of waiting
+ * tasks changes. It contains the position, starting from one, in the
+ * "queue_position" key and the seconds waited so far in "wait_seconds". When
+ * the task leaves the queue to run, "queue_position" is zero.
+ *
+ * Up to 1024 events wait to be consumed; when there are more, events other
+ * than RESULT, FAILURE, STATISTICS, and LOG with ERR or WARNING verbosity
+ * are dropped. The STATISTICS event is the last event of a task and contains
+ * the number of events that were dropped ("dropped_events") and coalesced
+ * or replaced by more recent events ("merged_events"), and the maximum
+ * number of events that were waiting to be consumed ("max_queued_events").
+ *
+ * The rate of the PROGRESS and LOG events is limited, such that tasks with
+ * many fast measurements do not emit more events than can be consumed. At
+ * most "max_progress_rate" PROGRESS events per second (10 by default) are
+ * emitted, plus the one marking the completion of the task. At most
+ * "max_log_rate" LOG events per second (100 by default) are emitted for each
+ * verbosity level, with bursts of up to "max_log_burst" events (200 by
+ * default), plus all the LOG events with ERR and WARNING verbosity. These
+ * are options of the task; a rate that is not positive means no limit. The
+ * events that were not emitted are counted in the "rate_limited_events" key
+ * of the STATISTICS event.
  */
 #define MK_ENUM_EVENT(XX)                                                      \
     XX(LOG)                                                                    \
     XX(PROGRESS)                                                               \
     XX(FAILURE)                                                                \
     XX(PERFORMANCE)                                                            \
-    XX(RESULT)
+    XX(QUEUED)                                                                 \
+    XX(RESULT)                                                                 \
+    XX(STATISTICS)
 
 /**
  * MK_ENUM_TASK enumerates the task that Measurement Kit can run. When
@@ -148,6 +209,16 @@ class Task {
  * ```JSON
  *   {"type": "Ndt"}
  * ```
+ *
+ * The Resubmit task does not run a network test; it resubmits the entries
+ * that could not be submitted to the collector and were saved into the
+ * directory specified by the "spool_dir" option.
+ *
+ * The Dash, MultiNdt and Ndt tasks measure the bandwidth and thus never run
+ * along with other tasks. The other tasks may run concurrently, each using up
+ * to four sockets per measurement run in parallel (see the "parallelism"
+ * option). These defaults can be changed with the "task_bandwidth_sensitive"
+ * and "task_sockets" options, respectively.
  */
 #define MK_ENUM_TASK(XX)                                                       \
     XX(Dash)                                                                   \
@@ -159,6 +230,7 @@ class Task {
     XX(MeekFrontedRequests)                                                    \
     XX(MultiNdt)                                                               \
     XX(Ndt)                                                                    \
+    XX(Resubmit)                                                               \
     XX(TcpConnect)                                                             \
     XX(Telegram)                                                               \
     XX(WebConnectivity)                                                        \
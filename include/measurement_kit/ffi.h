@@ -73,6 +73,39 @@ enum mk_task_error_t mk_task_start_ex(
  * returned event pointer and must mk_event_destroy() it when done. */
 mk_event_t *mk_task_wait_for_next_event(mk_task_t *task) MK_FFI_NOEXCEPT;
 
+/** mk_events_t is a buffer of events, which you own and can reuse, such that
+ * many events can be retrieved at a time with mk_task_wait_for_events(). */
+typedef struct mk_events_ mk_events_t;
+
+/** mk_events_create() creates a buffer of events. You own the returned
+ * pointer and must mk_events_destroy() it when done. */
+mk_events_t *mk_events_create(void) MK_FFI_NOEXCEPT;
+
+/** mk_events_serialize() returns the events in the buffer, each serialized
+ * as a JSON on its own line, i.e. followed by a newline. The returned string
+ * is valid until the buffer is reused or destroyed. */
+const char *mk_events_serialize(mk_events_t *events) MK_FFI_NOEXCEPT;
+
+/** mk_events_size() returns the length of the string returned by
+ * mk_events_serialize(), excluding the final null byte. */
+size_t mk_events_size(mk_events_t *events) MK_FFI_NOEXCEPT;
+
+/** mk_events_destroy() destroys a buffer of events. */
+void mk_events_destroy(mk_events_t *events) MK_FFI_NOEXCEPT;
+
+/** mk_task_wait_for_events() blocks until the next event, like
+ * mk_task_wait_for_next_event(), or until @p timeout seconds have elapsed if
+ * @p timeout is not negative. Then it replaces the content of @p events with
+ * the events that occurred, up to @p max_events. This is much faster than
+ * retrieving the events one at a time when there are many events. @return
+ * the number of events in @p events. If @p terminated is not NULL, it is set
+ * to nonzero when the task terminated and all its events have been retrieved,
+ * in which case you should stop calling, and to zero otherwise. Do not use
+ * mk_task_is_running() to decide when to stop, because the task stops running
+ * after emitting its last events, so they could still be queued. */
+size_t mk_task_wait_for_events(mk_task_t *task, mk_events_t *events,
+        size_t max_events, double timeout, int *terminated) MK_FFI_NOEXCEPT;
+
 /** mk_task_is_running() returns nonzero if the task is running, 0 otherwise. */
 int mk_task_is_running(mk_task_t *task) MK_FFI_NOEXCEPT;
 
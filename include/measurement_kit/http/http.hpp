@@ -55,6 +55,9 @@ MK_DEFINE_ERR(MK_ERR_HTTP(30), ParserInvalidInternalStateError, "http_parser_inv
 MK_DEFINE_ERR(MK_ERR_HTTP(31), ParserStrictModeAssertionError, "http_parser_strict_mode_assertion")
 MK_DEFINE_ERR(MK_ERR_HTTP(32), ParserPausedError, "http_parser_paused")
 MK_DEFINE_ERR(MK_ERR_HTTP(33), GenericParserError, "http_parser_generic_error")
+MK_DEFINE_ERR(MK_ERR_HTTP(34), ContentDecodingError, "http_content_decoding_error")
+MK_DEFINE_ERR(MK_ERR_HTTP(35), MaxDecompressedSizeExceededError, "http_max_decompressed_size_exceeded")
+MK_DEFINE_ERR(MK_ERR_HTTP(36), PipeliningBrokenError, "http_pipelining_broken")
 
 /*
  _   _      _
@@ -115,6 +118,17 @@ class Request {
     static ErrorOr<SharedPtr<Request>> make(Settings, Headers, std::string);
 };
 
+// Timestamps, taken with a monotonic clock, of the events that happened
+// while issuing a request. Zero means that the event did not happen.
+class ResponseTimings {
+  public:
+    net::ConnectTimings connect;  // Only set by request()
+    double request_written = 0.0;
+    double first_byte = 0.0;
+    double headers_complete = 0.0;
+    double body_complete = 0.0;
+};
+
 struct Response {
     SharedPtr<Request> request;
     SharedPtr<Response> previous;
@@ -125,10 +139,18 @@ struct Response {
     std::string reason;
     Headers headers;
     std::string body;
+    std::string raw_body; // Still-encoded body, set only if body was decoded
+    ResponseTimings timings;
 };
 
 ErrorOr<Url> redirect(const Url &orig_url, const std::string &location);
 
+// Whether the comma separated list in the `name` header contains `token`,
+// which is compared case insensitively (e.g. `Connection: Keep-Alive, Close`
+// contains the `close` token).
+bool header_has_token(const Headers &headers, const std::string &name,
+                      const std::string &token);
+
 void request_connect(Settings, Callback<Error, SharedPtr<net::Transport>>,
                      SharedPtr<Reactor> = Reactor::global(),
                      SharedPtr<Logger> = Logger::global());
@@ -144,6 +166,16 @@ void request_recv_response(SharedPtr<net::Transport>, Callback<Error, SharedPtr<
                            Settings = {}, SharedPtr<Reactor> = Reactor::global(),
                            SharedPtr<Logger> = Logger::global());
 
+// Same as request_recv_response() except that `buff` is shared with the
+// caller and, upon return, contains the bytes that followed the response,
+// i.e. the beginning of the next response when pipelining.
+void request_recv_pipelined_response(SharedPtr<net::Transport>,
+                                     SharedPtr<net::Buffer>,
+                                     Callback<Error, SharedPtr<Response>>,
+                                     Settings = {},
+                                     SharedPtr<Reactor> = Reactor::global(),
+                                     SharedPtr<Logger> = Logger::global());
+
 void request_sendrecv(SharedPtr<net::Transport>, Settings, Headers, std::string,
                       Callback<Error, SharedPtr<Response>>,
                       SharedPtr<Reactor> = Reactor::global(),
@@ -165,7 +197,9 @@ void request_maybe_sendrecv(ErrorOr<SharedPtr<Request>>, SharedPtr<net::Transpor
  *       {"http/ignore_body", boolean},
  *       {"http/method", "GET|DELETE|PUT|POST|HEAD|..."},
  *       {"http/http_version", "HTTP/1.1"},
- *       {"http/path", by default is taken from the url}
+ *       {"http/path", by default is taken from the url},
+ *       {"http/accept_encoding", e.g. "gzip, deflate" (default: "")},
+ *       {"http/max_decompressed_size", integer (default: 64 MiB)}
  *     }
  */
 
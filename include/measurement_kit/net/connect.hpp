@@ -12,6 +12,20 @@ struct bufferevent;
 namespace mk {
 namespace net {
 
+/// Statistics of the cache used to resume TLS sessions.
+class SslSessionCacheStats {
+  public:
+    unsigned long long lookups = 0; ///< Number of attempts to find a session
+    unsigned long long hits = 0;    ///< Number of sessions found
+    unsigned long long resumed = 0; ///< Number of sessions actually resumed
+    unsigned long long stored = 0;  ///< Number of sessions saved
+    unsigned long long evicted = 0; ///< Sessions removed because cache is full
+    unsigned long long expired = 0; ///< Sessions removed because expired
+};
+
+/// Return the statistics of the process-wide TLS session cache.
+SslSessionCacheStats ssl_session_cache_stats();
+
 void connect(std::string address, int port,
              Callback<Error, SharedPtr<Transport>> callback,
              Settings settings = {},
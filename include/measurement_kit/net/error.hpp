@@ -78,7 +78,9 @@ MK_DEFINE_ERR(MK_ERR_NET(28), SslCtxLoadVerifyMemError, "ssl_ctx_load_verify_mem
     XX(54, ProtocolErrorError, protocol_error)                             \
     XX(55, ProtocolNotSupportedError, protocol_not_supported)              \
     XX(56, TimedOutError, timed_out)                                       \
-    XX(57, WrongProtocolTypeError, wrong_protocol_type)
+    XX(57, WrongProtocolTypeError, wrong_protocol_type)                    \
+    XX(60, TooManyFilesOpenError, too_many_files_open)                     \
+    XX(61, TooManyFilesOpenInSystemError, too_many_files_open_in_system)
 
 #define XX(_code_, _name_, _descr_)                                        \
     MK_DEFINE_ERR(MK_ERR_NET(_code_), _name_, #_descr_)
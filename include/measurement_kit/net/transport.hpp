@@ -102,6 +102,23 @@ class TransportPollable {
     virtual void start_writing() = 0;
 };
 
+// Timestamps, taken with a monotonic clock, of the events that happened
+// while connecting. Zero means that the event did not happen.
+class ConnectTimings {
+  public:
+    class Attempt {
+      public:
+        double start = 0.0;
+        double end = 0.0;
+    };
+
+    double dns_start = 0.0;
+    double dns_end = 0.0;
+    std::vector<Attempt> connect_attempts;
+    double tls_handshake_start = 0.0;
+    double tls_handshake_end = 0.0;
+};
+
 class TransportConnectable {
   public:
     virtual ~TransportConnectable();
@@ -111,6 +128,8 @@ class TransportConnectable {
     virtual void set_connect_errors_(std::vector<Error>) = 0;
     virtual dns::ResolveHostnameResult dns_result() = 0;
     virtual void set_dns_result_(dns::ResolveHostnameResult) = 0;
+    virtual ConnectTimings connect_timings() = 0;
+    virtual void set_connect_timings_(ConnectTimings) = 0;
 };
 
 class TransportSockNamePeerName {
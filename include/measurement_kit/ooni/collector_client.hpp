@@ -61,6 +61,20 @@ void connect_and_update_report(std::string report_id, report::Entry,
                                SharedPtr<Reactor> = Reactor::global(),
                                SharedPtr<Logger> = Logger::global());
 
+// Same as above but using an already serialized entry, which MUST already
+// contain the correct `report_id`, to avoid serializing it again
+void update_report_serialized(SharedPtr<net::Transport>, std::string report_id,
+                              report::SerializedEntry, Callback<Error>,
+                              Settings = {},
+                              SharedPtr<Reactor> = Reactor::global(),
+                              SharedPtr<Logger> = Logger::global());
+
+void connect_and_update_report_serialized(std::string report_id,
+                                          report::SerializedEntry,
+                                          Callback<Error>, Settings = {},
+                                          SharedPtr<Reactor> = Reactor::global(),
+                                          SharedPtr<Logger> = Logger::global());
+
 void close_report(SharedPtr<net::Transport>, std::string report_id, Callback<Error>,
                   Settings = {}, SharedPtr<Reactor> = Reactor::global(),
                   SharedPtr<Logger> = Logger::global());
@@ -24,8 +24,16 @@ class BaseReporter : public NonCopyable, public NonMovable {
         return do_open_([=](Callback<Error> cb) { cb(NoError()); });
     }
 
+    // Reporters should override this method, which receives an entry that
+    // has already been serialized. By default it calls the method below.
+    virtual Continuation<Error> write_entry(SerializedEntry e) {
+        return write_entry(e.entry());
+    }
+
+    // Kept for compatibility: serializes the entry and writes it.
     virtual Continuation<Error> write_entry(Entry e) {
-        return do_write_entry_(e, [=](Callback<Error> cb) { cb(NoError()); });
+        return do_write_entry_(SerializedEntry::make(std::move(e)),
+                               [=](Callback<Error> cb) { cb(NoError()); });
     }
 
     virtual Continuation<Error> close() {
@@ -41,6 +49,8 @@ class BaseReporter : public NonCopyable, public NonMovable {
 
     Continuation<Error> do_open_(Continuation<Error> cc);
 
+    Continuation<Error> do_write_entry_(SerializedEntry, Continuation<Error> cc);
+
     Continuation<Error> do_write_entry_(Entry, Continuation<Error> cc);
 
     Continuation<Error> do_close_(Continuation<Error> cc);
@@ -49,7 +59,7 @@ class BaseReporter : public NonCopyable, public NonMovable {
 
     bool openned_ = false;
     bool closed_ = false;
-    std::string prev_entry_;
+    std::string prev_entry_hash_;
 };
 
 } // namespace report
@@ -7,13 +7,17 @@
 #include <measurement_kit/common.hpp>
 
 namespace mk {
+
+class JsonSink;
+
 namespace report {
 
 // A report entry.
 class Entry : public Json {
   public:
     Entry() : Json() {}
-    template <typename T> Entry(T t) : Json(t) {}
+    // Note: we move `t`, which may be a large tree, rather than copying it
+    template <typename T> Entry(T t) : Json(move_(t)) {}
 
     /*
      * I'd like to also declare these two constructors but apparently
@@ -35,7 +39,7 @@ class Entry : public Json {
     static Entry object();
 
     template <typename T> Entry &operator=(T t) {
-        Json::operator=(t);
+        Json::operator=(move_(t));
         return *this;
     }
 
@@ -68,7 +72,7 @@ class Entry : public Json {
 
     template <typename T> void push_back(T t) {
         try {
-            Json::push_back(t);
+            Json::push_back(move_(t));
         } catch (const std::domain_error &) {
             throw JsonDomainError();
         }
@@ -83,10 +87,41 @@ class Entry : public Json {
 
   protected:
   private:
+    // Since an Entry is also an iterable type, nlohmann::json would convert
+    // it into an array of its values; casting it makes sure that we use the
+    // move constructor of Json instead.
+    static Json &&move_(Entry &t) { return static_cast<Json &&>(t); }
+    template <typename T> static T &&move_(T &t) { return std::move(t); }
+
     // NO ATTRIBUTES HERE BY DESIGN. DO NOT ADD ATTRIBUTES HERE BECAUSE
     // DOING THAT CREATES THE RISK OF OBJECT SLICING.
 };
 
+// An immutable entry along with its serialization and the SHA256 of it. It
+// is created once per measurement and shared by all the reporters, which
+// should use write() to copy the serialization into their output, such that
+// the entry is serialized exactly once. All the copies of this object share
+// the same entry and serialization. The entry is kept for the reporters that
+// need to inspect it (e.g., to validate it before submitting it).
+class SerializedEntry {
+  public:
+    SerializedEntry() {}
+
+    static SerializedEntry make(Entry entry);
+
+    const Entry &entry() const { return *entry_; }
+    const std::string &str() const { return *data_; }
+    const std::string &hash() const { return hash_; }
+
+    // Writes the serialization into `sink`
+    Error write(JsonSink &sink) const;
+
+  private:
+    SharedPtr<Entry> entry_ = SharedPtr<Entry>::make();
+    SharedPtr<std::string> data_ = SharedPtr<std::string>::make();
+    std::string hash_;
+};
+
 } // namespace report
 } // namespace mk
 #endif
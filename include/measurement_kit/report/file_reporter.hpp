@@ -10,21 +10,79 @@
 namespace mk {
 namespace report {
 
+// Statistics collected by a FileReporter. Latencies are in seconds: commit
+// latency is the time spent in write() and fsync() for each group of entries,
+// entry latency is the time from write_entry() to commit. In unbuffered mode
+// only `entries` and `bytes` are collected.
+class FileReporterStats {
+  public:
+    uint64_t entries = 0;
+    uint64_t bytes = 0;
+    uint64_t commits = 0;
+    uint64_t fsyncs = 0;
+    double commit_latency_max = 0.0;
+    double commit_latency_total = 0.0;
+    double entry_latency_max = 0.0;
+    double entry_latency_total = 0.0;
+};
+
+class BufferedFileWriter;
+class GzipFrameWriter;
+
 class FileReporter : public BaseReporter {
   public:
     static SharedPtr<BaseReporter> make(std::string filename);
 
+    // The following `settings` select the buffered mode:
+    //
+    // - file_report_buffer_size: size of the user-space buffer in bytes;
+    //   if zero (the default), every entry is written and flushed
+    //   synchronously, as the factory above does
+    // - file_report_durability: "none" (the default), "interval" or "entry"
+    // - file_report_flush_interval: max seconds between commits (default 1)
+    //
+    // The following `settings` select gzip compression:
+    //
+    // - file_report_compression: "gzip" or "none"; by default, "gzip" if
+    //   `filename` ends with ".gz" and "none" otherwise
+    // - file_report_frame_entries: number of entries in each independently
+    //   compressed gzip member (default 100)
+    //
+    // If `file_report_resume_offset` is set, the existing file is truncated
+    // to that many bytes and then appended to, rather than overwritten.
+    static SharedPtr<BaseReporter> make(std::string filename,
+                                        Settings settings,
+                                        SharedPtr<Reactor> reactor = Reactor::global(),
+                                        SharedPtr<Logger> logger = Logger::global());
+
     Continuation<Error> open(Report &report) override;
     Continuation<Error> write_entry(Entry entry) override;
+    Continuation<Error> write_entry(SerializedEntry entry) override;
     Continuation<Error> close() override;
 
-    ~FileReporter() override {}
+    FileReporterStats stats() const;
+
+    ~FileReporter() override;
 
   private:
     FileReporter() {}
 
     std::string filename;
     std::ofstream file;
+    void write_(const SerializedEntry &entry, Callback<Error> &&cb);
+    void write_(std::string data, size_t entries, Callback<Error> &&cb);
+    void flush_frame_(Callback<Error> &&cb);
+    void close_(Callback<Error> cb);
+
+    Settings settings;
+    FileReporterStats plain_stats; // Only when not buffered
+    size_t frame_entries = 0; // zero means not compressing
+    SharedPtr<GzipFrameWriter> frame; // Only when compressing
+    size_t frame_count = 0;
+    Error frame_error; // Sticky, since acked entries may have been lost
+    SharedPtr<Reactor> reactor = Reactor::global();
+    SharedPtr<Logger> logger = Logger::global();
+    SharedPtr<BufferedFileWriter> writer;
 };
 
 } // namespace report
@@ -7,27 +7,39 @@
 #include <measurement_kit/report/base_reporter.hpp>
 
 namespace mk {
+namespace ooni {
+namespace collector {
+class Session;
+} // namespace collector
+} // namespace ooni
 namespace report {
 
+class Spool;
+
 class OoniReporter : public BaseReporter {
   public:
     static SharedPtr<BaseReporter> make(Settings, SharedPtr<Reactor>, SharedPtr<Logger>);
 
     Continuation<Error> open(Report &report) override;
     Continuation<Error> write_entry(Entry entry) override;
+    Continuation<Error> write_entry(SerializedEntry entry) override;
     Continuation<Error> close() override;
 
-    ~OoniReporter() override {}
+    ~OoniReporter() override;
 
     std::string get_report_id() override;
 
   private:
     OoniReporter(Settings, SharedPtr<Reactor>, SharedPtr<Logger>);
 
+    Continuation<Error> submit_entry_(SerializedEntry entry);
+
     SharedPtr<Reactor> reactor = Reactor::global();
     SharedPtr<Logger> logger = Logger::global();
     Settings settings; // Our private copy of the ooni_test settings
     std::string report_id;
+    SharedPtr<ooni::collector::Session> session; // If persistent connection
+    SharedPtr<Spool> spool; // If we should save entries we cannot submit
 };
 
 } // namespace report
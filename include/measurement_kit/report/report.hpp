@@ -45,6 +45,14 @@ class Report {
 
     void write_entry(Entry entry, Callback<Error> callback, SharedPtr<Logger> logger);
 
+    // Add the report-id (if known) to `entry` and serialize it once for
+    // all the reporters, to be passed to the write_entry() below.
+    ErrorOr<SerializedEntry> serialize_entry(Entry entry,
+                                             SharedPtr<Logger> logger);
+
+    void write_entry(SerializedEntry entry, Callback<Error> callback,
+                     SharedPtr<Logger> logger);
+
     void close(Callback<Error> callback);
 
   private:
@@ -0,0 +1,43 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/common/deadline.hpp"
+#include "src/libmeasurement_kit/common/utils.hpp"
+
+#include <algorithm>
+
+namespace mk {
+
+// Shortest timeout we return, because non-positive timeouts usually
+// mean that there is no timeout at all
+static const double min_timeout = 0.001;
+
+Settings with_deadline(Settings settings, double timeout) {
+    // Not passing a double, which would be formatted with six significant
+    // digits, way less than needed for the monotonic clock
+    settings["deadline_"] = std::to_string(monotonic_time_now() + timeout);
+    return settings;
+}
+
+bool has_deadline(const Settings &settings) {
+    return settings.find("deadline_") != settings.end();
+}
+
+bool deadline_expired(const Settings &settings) {
+    return has_deadline(settings) &&
+           settings.get("deadline_", 0.0) <= monotonic_time_now();
+}
+
+double timeout_before_deadline(const Settings &settings, double timeout) {
+    if (!has_deadline(settings)) {
+        return timeout;
+    }
+    double left = settings.get("deadline_", 0.0) - monotonic_time_now();
+    if (timeout >= 0.0) {
+        left = std::min(left, timeout);
+    }
+    return std::max(left, min_timeout);
+}
+
+} // namespace mk
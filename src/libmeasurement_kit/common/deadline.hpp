@@ -0,0 +1,31 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+#ifndef SRC_LIBMEASUREMENT_KIT_COMMON_DEADLINE_HPP
+#define SRC_LIBMEASUREMENT_KIT_COMMON_DEADLINE_HPP
+
+#include <measurement_kit/common/settings.hpp>
+
+namespace mk {
+
+// Deadlines allow to bound the time taken by a measurement as a whole,
+// rather than by each of its operations. The code running a measurement
+// sets the "deadline_" setting to the time (see monotonic_time_now()) by
+// which it must complete, and the code performing I/O (i.e. net and dns,
+// and thus http) honours it by clamping its own timeouts and by failing
+// with DeadlineExceededError when it has expired.
+
+// Returns the settings with the deadline set `timeout` seconds from now
+Settings with_deadline(Settings settings, double timeout);
+
+bool has_deadline(const Settings &settings);
+
+bool deadline_expired(const Settings &settings);
+
+// Returns the smallest between `timeout` and the time left before the
+// deadline, if any. A negative `timeout` means no timeout. The result is
+// always positive when there is a deadline, even if it has expired.
+double timeout_before_deadline(const Settings &settings, double timeout);
+
+} // namespace mk
+#endif
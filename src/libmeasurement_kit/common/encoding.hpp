@@ -5,13 +5,17 @@
 #define SRC_LIBMEASUREMENT_KIT_COMMON_ENCODING_HPP
 
 #include <measurement_kit/common/error.hpp>
+#include <measurement_kit/common/error_or.hpp>
 #include <string>
 
 namespace mk {
 
 Error utf8_parse(const std::string &s);
 
-std::string base64_encode(std::string s);
+std::string base64_encode(const std::string &s);
+
+// Decodes padded base64, failing with ValueError on malformed input.
+ErrorOr<std::string> base64_decode(const std::string &s);
 
 } // namespace mk
 #endif
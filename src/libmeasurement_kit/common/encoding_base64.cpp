@@ -28,47 +28,87 @@
  * René Nyffenegger rene.nyffenegger@adp-gmbh.ch
  */
 
+#include <array>
 #include <cstdint>
 #include "src/libmeasurement_kit/common/encoding.hpp"
 #include <string>
 
 namespace mk {
 
-static inline std::string base64_encode(const uint8_t *base, size_t len) {
-    static const std::string b64_table = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-                                         "abcdefghijklmnopqrstuvwxyz"
-                                         "0123456789+/";
-    std::string res;
-    uint8_t in[3];
-    uint8_t out[4];
-    int state = 0;
-    auto copy = [&]() {
-        out[0] = (in[0] & 0xfc) >> 2;
-        out[1] = ((in[0] & 0x03) << 4) + ((in[1] & 0xf0) >> 4);
-        out[2] = ((in[1] & 0x0f) << 2) + ((in[2] & 0xc0) >> 6);
-        out[3] = in[2] & 0x3f;
-        for (int idx = 0; idx < 4; ++idx) {
-            res += (idx <= state) ? b64_table[out[idx]] : '=';
-        }
-    };
-    while (len-- > 0) {
-        in[state++] = *(base++);
-        if (state == 3) {
-            copy();
-            state = 0;
-        }
+static const char b64_table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                "abcdefghijklmnopqrstuvwxyz"
+                                "0123456789+/";
+
+std::string base64_encode(const std::string &s) {
+    const uint8_t *base = (const uint8_t *)s.data();
+    size_t len = s.size();
+    // Size the output once and write into it, rather than appending
+    std::string res(4 * ((len + 2) / 3), '=');
+    char *out = &res[0];
+    size_t i = 0;
+    for (; i + 3 <= len; i += 3, out += 4) {
+        uint32_t v = (base[i] << 16) | (base[i + 1] << 8) | base[i + 2];
+        out[0] = b64_table[(v >> 18) & 0x3f];
+        out[1] = b64_table[(v >> 12) & 0x3f];
+        out[2] = b64_table[(v >> 6) & 0x3f];
+        out[3] = b64_table[v & 0x3f];
     }
-    if (state != 0) {
-        for (int idx = state; idx < 3; ++idx) {
-            in[idx] = '\0';
+    if (i < len) {
+        uint32_t v = base[i] << 16;
+        if (i + 1 < len) {
+            v |= base[i + 1] << 8;
         }
-        copy();
+        out[0] = b64_table[(v >> 18) & 0x3f];
+        out[1] = b64_table[(v >> 12) & 0x3f];
+        if (i + 1 < len) {
+            out[2] = b64_table[(v >> 6) & 0x3f];
+        }
+        // The remaining characters are already padding
     }
     return res;
 }
 
-std::string base64_encode(std::string s) {
-    return base64_encode((uint8_t *)s.data(), s.size());
+ErrorOr<std::string> base64_decode(const std::string &s) {
+    // Maps each character to its six bits value, or to 0xff if invalid
+    static const std::array<uint8_t, 256> reverse = []() {
+        std::array<uint8_t, 256> table;
+        table.fill(0xff);
+        for (uint8_t idx = 0; idx < 64; ++idx) {
+            table[(uint8_t)b64_table[idx]] = idx;
+        }
+        return table;
+    }();
+    size_t len = s.size();
+    if (len % 4 != 0) {
+        return {ValueError(), {}};
+    }
+    size_t padding = 0;
+    if (len > 0 && s[len - 1] == '=') {
+        padding = (s[len - 2] == '=') ? 2 : 1;
+    }
+    const uint8_t *in = (const uint8_t *)s.data();
+    std::string res(len / 4 * 3 - padding, '\0');
+    char *out = &res[0];
+    for (size_t i = 0; i < len; i += 4) {
+        uint32_t v = 0;
+        // Padding characters are only allowed at the end of the input
+        size_t valid = (i + 4 == len) ? 4 - padding : 4;
+        for (size_t k = 0; k < valid; ++k) {
+            uint8_t c = reverse[in[i + k]];
+            if (c == 0xff) {
+                return {ValueError(), {}};
+            }
+            v |= (uint32_t)c << (18 - 6 * k);
+        }
+        *out++ = (char)(v >> 16);
+        if (valid > 2) {
+            *out++ = (char)((v >> 8) & 0xff);
+        }
+        if (valid > 3) {
+            *out++ = (char)(v & 0xff);
+        }
+    }
+    return {NoError(), std::move(res)};
 }
 
 } // namespace mk
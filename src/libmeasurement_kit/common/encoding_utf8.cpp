@@ -2,42 +2,99 @@
 // Measurement Kit is free software under the BSD license. See AUTHORS
 // and LICENSE for more information on the copying conditions.
 
-#include "src/libmeasurement_kit/common/citrus_ctype.h"
 #include "src/libmeasurement_kit/common/encoding.hpp"
 #include <measurement_kit/common/error.hpp>
 
-#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace mk {
 
+/*
+ * Returns the index of the first byte at or after `i` that is either
+ * zero or not ASCII, or `n` if there is no such byte. Web pages and
+ * headers are mostly ASCII, so this is where we spend most of the time.
+ */
+static inline size_t skip_ascii(const uint8_t *p, size_t i, size_t n) {
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        if ((_mm_movemask_epi8(v) |
+             _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero))) != 0) {
+            break;
+        }
+    }
+#endif
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, sizeof(w));
+        // High bit set in some byte, or some byte is zero
+        if (((w & highs) | ((w - ones) & ~w & highs)) != 0) {
+            break;
+        }
+    }
+    while (i < n && (uint8_t)(p[i] - 1) < 0x7f) {
+        ++i;
+    }
+    return i;
+}
+
+/*
+ * Note: this returns the same errors that parsing `s` byte by byte with
+ * mk_utf8_mbrtowc() would return; in particular, a sequence is checked
+ * for redundant encodings and invalid code points only once complete.
+ */
 Error utf8_parse(const std::string &s) {
-    _utf8_state state = {};
-    size_t r = 1;
-    for (char c : s) {
-        r = mk_utf8_mbrtowc(nullptr, &c, 1, (mbstate_t *)&state);
-        if (r == (size_t)-2) {
-            // We're in the middle of a multibyte sequence
-            continue;
+    const uint8_t *p = (const uint8_t *)s.data();
+    size_t n = s.size();
+    size_t i = 0;
+    for (;;) {
+        i = skip_ascii(p, i, n);
+        if (i >= n) {
+            return NoError();
+        }
+        uint8_t ch = p[i++];
+        if (ch == 0) {
+            return UnexpectedNullByteError();
         }
-        if (r == (size_t)-1) {
-            // The sequence is invalid
+        int want;
+        uint32_t lbound, wch;
+        if ((ch & 0xe0) == 0xc0) {
+            want = 2;
+            lbound = 0x80;
+            wch = ch & 0x1f;
+        } else if ((ch & 0xf0) == 0xe0) {
+            want = 3;
+            lbound = 0x800;
+            wch = ch & 0x0f;
+        } else if ((ch & 0xf8) == 0xf0) {
+            want = 4;
+            lbound = 0x10000;
+            wch = ch & 0x07;
+        } else {
             return IllegalSequenceError();
         }
-        if (r == 0) {
-            // We were not expecting a L'\0' at this point
-            return UnexpectedNullByteError();
+        for (int k = 1; k < want; ++k, ++i) {
+            if (i >= n) {
+                return IncompleteUtf8SequenceError();
+            }
+            if ((p[i] & 0xc0) != 0x80) {
+                return IllegalSequenceError();
+            }
+            wch = (wch << 6) | (p[i] & 0x3f);
+        }
+        if (wch < lbound || (wch >= 0xd800 && wch <= 0xdfff) ||
+            wch > 0x10ffff) {
+            return IllegalSequenceError();
         }
-        /*
-         * Because we parse each character independently, mbrtowc() should
-         * tell us that we have consumed one character after each call.
-         */
-        assert(r == 1);
-    }
-    assert(r == (size_t)-2 || r == 1);
-    if (r == (size_t)-2) {
-        return IncompleteUtf8SequenceError();
     }
-    return NoError();
 }
 
 } // namespace mk
@@ -0,0 +1,190 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/common/json_writer.hpp"
+
+#include <event2/buffer.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <array>
+
+namespace mk {
+
+JsonSink::~JsonSink() {}
+
+Error StringSink::write(const char *base, size_t count) {
+    s_.append(base, count);
+    return NoError();
+}
+
+Error OstreamSink::write(const char *base, size_t count) {
+    o_.write(base, count);
+    if (!o_.good()) {
+        return FileIoError();
+    }
+    return NoError();
+}
+
+Error EvbufferSink::write(const char *base, size_t count) {
+    if (evbuffer_add(evbuf_, base, count) != 0) {
+        return GenericError();
+    }
+    return NoError();
+}
+
+Error FdSink::write(const char *base, size_t count) {
+    while (count > 0) {
+        ssize_t n = ::write(fd_, base, count);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return FileIoError();
+        }
+        base += n;
+        count -= (size_t)n;
+    }
+    return NoError();
+}
+
+Sha256Sink::Sha256Sink() { SHA256_Init(&ctx_); }
+
+Error Sha256Sink::write(const char *base, size_t count) {
+    SHA256_Update(&ctx_, base, count);
+    return NoError();
+}
+
+std::string Sha256Sink::hexdigest() {
+    static const char hex[] = "0123456789abcdef";
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    SHA256_Final(hash, &ctx_);
+    std::string s;
+    for (unsigned char c : hash) {
+        s += hex[c >> 4];
+        s += hex[c & 0x0f];
+    }
+    return s;
+}
+
+// Not exposed in the header, because write_json() is all we need
+class JsonWriter {
+  public:
+    explicit JsonWriter(JsonSink &sink) : sink_{sink} {}
+
+    Error write(const Json &json) {
+        value_(json);
+        flush_();
+        return error_;
+    }
+
+  private:
+    void put_(const char *base, size_t count) {
+        if (error_) {
+            return;
+        }
+        if (count > buffer_.size() - used_) {
+            flush_();
+            if (count >= buffer_.size()) {
+                error_ = sink_.write(base, count);
+                return;
+            }
+        }
+        memcpy(buffer_.data() + used_, base, count);
+        used_ += count;
+    }
+
+    void put_(char c) { put_(&c, 1); }
+
+    void put_(const std::string &s) { put_(s.data(), s.size()); }
+
+    void flush_() {
+        if (!error_ && used_ > 0) {
+            error_ = sink_.write(buffer_.data(), used_);
+        }
+        used_ = 0;
+    }
+
+    // Same escaping rules of nlohmann::json::escape_string()
+    void string_(const std::string &s) {
+        static const char hexify[] = "0123456789abcdef";
+        put_('"');
+        const char *base = s.data();
+        size_t start = 0;
+        for (size_t i = 0; i < s.size(); ++i) {
+            unsigned char c = (unsigned char)base[i];
+            if (c != '"' && c != '\\' && c > 0x1f) {
+                continue;
+            }
+            put_(base + start, i - start);
+            start = i + 1;
+            char escape[6] = {'\\', 0, 0, 0, 0, 0};
+            size_t length = 2;
+            switch (c) {
+            case '"': escape[1] = '"'; break;
+            case '\\': escape[1] = '\\'; break;
+            case '\b': escape[1] = 'b'; break;
+            case '\f': escape[1] = 'f'; break;
+            case '\n': escape[1] = 'n'; break;
+            case '\r': escape[1] = 'r'; break;
+            case '\t': escape[1] = 't'; break;
+            default:
+                escape[1] = 'u';
+                escape[2] = '0';
+                escape[3] = '0';
+                escape[4] = hexify[c >> 4];
+                escape[5] = hexify[c & 0x0f];
+                length = 6;
+                break;
+            }
+            put_(escape, length);
+        }
+        put_(base + start, s.size() - start);
+        put_('"');
+    }
+
+    void value_(const Json &json) {
+        if (error_) {
+            return;
+        }
+        if (json.is_object()) {
+            put_('{');
+            for (auto it = json.cbegin(); it != json.cend(); ++it) {
+                if (it != json.cbegin()) {
+                    put_(',');
+                }
+                string_(it.key());
+                put_(':');
+                value_(it.value());
+            }
+            put_('}');
+        } else if (json.is_array()) {
+            put_('[');
+            for (auto it = json.cbegin(); it != json.cend(); ++it) {
+                if (it != json.cbegin()) {
+                    put_(',');
+                }
+                value_(*it);
+            }
+            put_(']');
+        } else if (json.is_string()) {
+            string_(json.get_ref<const std::string &>());
+        } else {
+            put_(json.dump()); // Numbers, booleans, and null are short
+        }
+    }
+
+    JsonSink &sink_;
+    Error error_;
+    std::array<char, 8192> buffer_;
+    size_t used_ = 0;
+};
+
+Error write_json(const Json &json, JsonSink &sink) {
+    return JsonWriter{sink}.write(json);
+}
+
+} // namespace mk
@@ -0,0 +1,91 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+#ifndef SRC_LIBMEASUREMENT_KIT_COMMON_JSON_WRITER_HPP
+#define SRC_LIBMEASUREMENT_KIT_COMMON_JSON_WRITER_HPP
+
+#include <measurement_kit/common.hpp>
+
+#include <openssl/sha.h>
+
+#include <ostream>
+
+struct evbuffer;
+
+namespace mk {
+
+// Destination of a JSON serialization written by write_json().
+class JsonSink {
+  public:
+    virtual Error write(const char *base, size_t count) = 0;
+
+    Error write(const std::string &s) { return write(s.data(), s.size()); }
+
+    virtual ~JsonSink();
+};
+
+// Appends to a string.
+class StringSink : public JsonSink {
+  public:
+    explicit StringSink(std::string &s) : s_{s} {}
+    using JsonSink::write;
+    Error write(const char *base, size_t count) override;
+
+  private:
+    std::string &s_;
+};
+
+// Writes into a stream, failing with FileIoError if the stream is not good.
+class OstreamSink : public JsonSink {
+  public:
+    explicit OstreamSink(std::ostream &o) : o_{o} {}
+    using JsonSink::write;
+    Error write(const char *base, size_t count) override;
+
+  private:
+    std::ostream &o_;
+};
+
+// Appends to an evbuffer, e.g. the output buffer of a connection.
+class EvbufferSink : public JsonSink {
+  public:
+    explicit EvbufferSink(evbuffer *evbuf) : evbuf_{evbuf} {}
+    using JsonSink::write;
+    Error write(const char *base, size_t count) override;
+
+  private:
+    evbuffer *evbuf_;
+};
+
+// Writes into a (blocking) file descriptor.
+class FdSink : public JsonSink {
+  public:
+    explicit FdSink(int fd) : fd_{fd} {}
+    using JsonSink::write;
+    Error write(const char *base, size_t count) override;
+
+  private:
+    int fd_;
+};
+
+// Computes the SHA256 of what is written; hexdigest() returns the same
+// string that sha256_of() would have returned for the whole input.
+class Sha256Sink : public JsonSink {
+  public:
+    Sha256Sink();
+    using JsonSink::write;
+    Error write(const char *base, size_t count) override;
+    std::string hexdigest();
+
+  private:
+    SHA256_CTX ctx_;
+};
+
+// Writes into `sink` the same bytes that `json.dump()` would return,
+// walking the tree rather than building the whole serialization in
+// memory. Small tokens are buffered and written in chunks of a few KiB,
+// while long strings without characters to escape are written in place.
+Error write_json(const Json &json, JsonSink &sink);
+
+} // namespace mk
+#endif
@@ -167,6 +167,27 @@ class DefaultLogger : public Logger, public NonCopyable, public NonMovable {
         event_handler_ = std::move(f);
     }
 
+    void on_json_event(Callback<Json &&> &&f) override {
+        std::unique_lock<std::recursive_mutex> _{mutex_};
+        json_event_handler_ = std::move(f);
+    }
+
+    void emit_event(Json &&event) override {
+        std::unique_lock<std::recursive_mutex> _{mutex_};
+        if (json_event_handler_) {
+            try {
+                json_event_handler_(std::move(event));
+            } catch (const std::exception &) {
+                /* Suppress */;
+            }
+            return;
+        }
+        // Serialize only if the event will not be filtered out by log()
+        if (MK_LOG_INFO <= verbosity_) {
+            log(MK_LOG_EVENT | MK_LOG_INFO, "%s", event.dump().c_str());
+        }
+    }
+
     void on_progress(Callback<double, const char *> &&fn) override {
         std::unique_lock<std::recursive_mutex> _{mutex_};
         progress_handler_ = fn;
@@ -231,6 +252,7 @@ class DefaultLogger : public Logger, public NonCopyable, public NonMovable {
     SharedPtr<std::ofstream> ofile_;
     std::list<Delegate<>> eof_handlers_;
     Delegate<const char *> event_handler_;
+    Delegate<Json &&> json_event_handler_;
     Delegate<double, const char *> progress_handler_;
     double progress_offset_ = 0.0;
     double progress_scale_ = 1.0;
@@ -0,0 +1,51 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/common/timer.hpp"
+#include "src/libmeasurement_kit/common/utils.hpp"
+
+#include <event2/event.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+extern "C" {
+static void mk_timer_cb(evutil_socket_t, short, void *opaque) {
+    mk::Callback<> *cbp = static_cast<mk::Callback<> *>(opaque);
+    // Copy the callback, which may destroy the timer and hence `*cbp`
+    mk::Callback<> cb = *cbp;
+    cb();
+}
+}
+
+namespace mk {
+
+/* static */ SharedPtr<Timer> Timer::make(SharedPtr<Reactor> reactor,
+                                          double delay, Callback<> &&cb) {
+    SharedPtr<Timer> timer{new Timer};
+    timer->reactor_ = reactor;
+    timer->cb_ = std::move(cb);
+    timer->evp_ = evtimer_new(reactor->get_event_base(), mk_timer_cb,
+                              &timer->cb_);
+    if (timer->evp_ == nullptr) {
+        throw std::runtime_error("evtimer_new");
+    }
+    timeval tv{};
+    if (evtimer_add(timer->evp_, timeval_init(&tv, std::max(0.0, delay))) !=
+        0) {
+        throw std::runtime_error("evtimer_add");
+    }
+    return timer;
+}
+
+void Timer::cancel() {
+    if (evp_ != nullptr) {
+        event_free(evp_); // Also removes it, if pending
+        evp_ = nullptr;
+    }
+}
+
+Timer::~Timer() { cancel(); }
+
+} // namespace mk
@@ -0,0 +1,39 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+#ifndef SRC_LIBMEASUREMENT_KIT_COMMON_TIMER_HPP
+#define SRC_LIBMEASUREMENT_KIT_COMMON_TIMER_HPP
+
+#include <measurement_kit/common/callback.hpp>
+#include <measurement_kit/common/non_copyable.hpp>
+#include <measurement_kit/common/non_movable.hpp>
+#include <measurement_kit/common/reactor.hpp>
+#include <measurement_kit/common/shared_ptr.hpp>
+
+struct event;
+
+namespace mk {
+
+// Like Reactor::call_later(), except that the callback is not called if
+// the timer is cancelled or destroyed before, in which case the timer does
+// not keep the reactor running. The callback may destroy the timer. A
+// negative delay is treated as zero.
+class Timer : public NonCopyable, public NonMovable {
+  public:
+    static SharedPtr<Timer> make(SharedPtr<Reactor> reactor, double delay,
+                                 Callback<> &&cb);
+
+    void cancel();
+
+    ~Timer();
+
+  private:
+    Timer() {}
+
+    SharedPtr<Reactor> reactor_; // Keep the event base alive
+    event *evp_ = nullptr;
+    Callback<> cb_;
+};
+
+} // namespace mk
+#endif
@@ -0,0 +1,34 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/common/token_bucket.hpp"
+
+#include <algorithm>
+
+namespace mk {
+
+TokenBucket::TokenBucket(double rate, double burst)
+    : burst_{std::max(1.0, burst)}, rate_{rate} {}
+
+bool TokenBucket::consume(double now) {
+    if (rate_ <= 0.0) {
+        return true;
+    }
+    if (!started_) {
+        started_ = true;
+        last_ = now;
+        tokens_ = burst_;
+    }
+    if (now > last_) {
+        tokens_ = std::min(burst_, tokens_ + (now - last_) * rate_);
+        last_ = now;
+    }
+    if (tokens_ < 1.0) {
+        return false;
+    }
+    tokens_ -= 1.0;
+    return true;
+}
+
+} // namespace mk
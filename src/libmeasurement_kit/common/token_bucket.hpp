@@ -0,0 +1,29 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+#ifndef SRC_LIBMEASUREMENT_KIT_COMMON_TOKEN_BUCKET_HPP
+#define SRC_LIBMEASUREMENT_KIT_COMMON_TOKEN_BUCKET_HPP
+
+namespace mk {
+
+// Limits the rate of events to `rate` events per second on average, with
+// bursts of up to `burst` events (at least one). A non-positive `rate`
+// means that there is no limit. Not thread safe.
+class TokenBucket {
+  public:
+    TokenBucket(double rate, double burst);
+
+    // Returns whether an event occurring at `now` (in seconds, e.g. from
+    // monotonic_time_now()) is within the limit.
+    bool consume(double now);
+
+  private:
+    double burst_ = 1.0;
+    double last_ = 0.0;
+    double rate_ = 0.0;
+    bool started_ = false;
+    double tokens_ = 0.0;
+};
+
+} // namespace mk
+#endif
@@ -5,6 +5,7 @@
 #include "src/libmeasurement_kit/common/mock.hpp"
 #include "src/libmeasurement_kit/common/utils.hpp"
 #include <cctype>
+#include <chrono>
 #include <cmath>
 #include <cstdio>
 #include <event2/util.h>
@@ -26,6 +27,12 @@ double time_now() {
     return result;
 }
 
+double monotonic_time_now() {
+    return std::chrono::duration<double>(
+                 std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+}
+
 Error parse_iso8601_utc(std::string ts, std::tm *tmb) {
     *tmb = {}; // "portable programs should initialize the structure"
     std::istringstream ss(ts);
@@ -103,6 +103,10 @@ void timeval_now(timeval *tv) {
 
 double time_now();
 
+// Seconds elapsed since an unspecified point in time, not affected by changes
+// of the system clock; only useful to compute time differences
+double monotonic_time_now();
+
 template <MK_MOCK(time), MK_MOCK(gmtime_r)>
 void utc_time_now(struct tm *utc) {
     time_t tv = {};
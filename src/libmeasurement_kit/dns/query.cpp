@@ -2,12 +2,29 @@
 // Measurement Kit is free software under the BSD license. See AUTHORS
 // and LICENSE for more information on the copying conditions.
 
+#include "src/libmeasurement_kit/common/deadline.hpp"
 #include "src/libmeasurement_kit/dns/libevent_query.hpp"
 #include "src/libmeasurement_kit/dns/system_resolver.hpp"
 
+#include <algorithm>
+
 namespace mk {
 namespace dns {
 
+// Makes sure that all the attempts are made before the deadline, if any;
+// the system resolver cannot be interrupted, instead
+static Settings clamp_timeout_to_deadline(Settings settings) {
+    if (!has_deadline(settings)) {
+        return settings;
+    }
+    int attempts = std::max(1, settings.get("dns/attempts", 3));
+    double timeout = std::min(settings.get("dns/timeout", 5.0),
+                              timeout_before_deadline(settings, -1.0) /
+                                    attempts);
+    settings["dns/timeout"] = std::to_string(timeout);
+    return settings;
+}
+
 void query(QueryClass dns_class, QueryType dns_type, std::string name,
         Callback<Error, SharedPtr<Message>> cb, Settings settings,
         SharedPtr<Reactor> reactor, SharedPtr<Logger> logger) {
@@ -15,11 +32,16 @@ void query(QueryClass dns_class, QueryType dns_type, std::string name,
     // but rather are deferred to the next I/O cycle. To this end, we basically
     // schedule the DNS query so that it happens in the next I/O cycle.
     reactor->call_soon([=]() {
+        if (deadline_expired(settings)) {
+            cb(DeadlineExceededError(), {});
+            return;
+        }
         std::string engine = settings.get("dns/engine", std::string("system"));
         logger->debug2("dns: engine: %s", engine.c_str());
         if (engine == "libevent") {
-            libevent_query(
-                    dns_class, dns_type, name, cb, settings, reactor, logger);
+            libevent_query(dns_class, dns_type, name, cb,
+                           clamp_timeout_to_deadline(settings), reactor,
+                           logger);
         } else if (engine == "system") {
             system_resolver(
                     dns_class, dns_type, name, settings, reactor, logger, cb);
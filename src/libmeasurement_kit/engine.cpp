@@ -10,8 +10,8 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
-#include <deque>
 #include <exception>
 #include <future>
 #include <memory>
@@ -29,6 +29,11 @@
 #include <measurement_kit/common/reactor.hpp>
 #include <measurement_kit/common/shared_ptr.hpp>
 
+#include "src/libmeasurement_kit/common/token_bucket.hpp"
+#include "src/libmeasurement_kit/common/utils.hpp"
+#include "src/libmeasurement_kit/engine/event_queue.hpp"
+#include "src/libmeasurement_kit/engine/scheduler.hpp"
+#include "src/libmeasurement_kit/nettests/parallelism.hpp"
 #include "src/libmeasurement_kit/nettests/runnable.hpp"
 
 namespace mk {
@@ -38,40 +43,16 @@ namespace engine {
 //
 // Comes first because it needs more careful handling.
 
-class Semaphore {
-  public:
-    Semaphore() = default;
-
-    void acquire() {
-        std::unique_lock<std::mutex> lock{mutex_};
-        cond_.wait(lock, [this]() { return !active_; });
-        active_ = true;
-    }
-
-    void release() {
-        {
-            std::unique_lock<std::mutex> _{mutex_};
-            active_ = false;
-        }
-        cond_.notify_one();
-    }
-
-    ~Semaphore() = default;
-
-  private:
-    bool active_ = false;
-    std::condition_variable cond_;
-    std::mutex mutex_;
-};
-
 class TaskImpl {
   public:
     std::condition_variable cond;
-    std::deque<nlohmann::json> deque;
     std::atomic_bool interrupted{false};
     std::mutex mutex;
+    EventQueue queue;
     SharedPtr<Reactor> reactor = Reactor::make();
     std::atomic_bool running{false};
+    bool statistics = true; // whether to emit the STATISTICS event
+    uint64_t rate_limited = 0; // events not emitted because of the rate
     std::thread thread;
 };
 
@@ -89,11 +70,22 @@ static void emit(TaskImpl *pimpl, nlohmann::json &&event) {
     // Actually emit the event.
     {
         std::unique_lock<std::mutex> _{pimpl->mutex};
-        pimpl->deque.push_back(std::move(event));
+        pimpl->queue.push(std::move(event));
     }
     pimpl->cond.notify_all(); // more efficient if unlocked
 }
 
+static void emit_log(TaskImpl *pimpl, const std::string &verbosity,
+                     const char *message) {
+    // Like emit(), except that the event is not created when the message
+    // is coalesced with the previous one, which is common with DEBUG2
+    {
+        std::unique_lock<std::mutex> _{pimpl->mutex};
+        pimpl->queue.push_log(verbosity, message);
+    }
+    pimpl->cond.notify_all();
+}
+
 Task::Task(nlohmann::json &&settings) {
     pimpl_ = std::make_unique<TaskImpl>();
     std::promise<void> barrier;
@@ -103,12 +95,14 @@ Task::Task(nlohmann::json &&settings) {
                                                  settings)]() mutable {
         pimpl_->running = true;
         barrier.set_value();
-        static Semaphore semaphore;
-        semaphore.acquire(); // block until a previous task has finished running
         task_run(pimpl_.get(), settings);
+        if (pimpl_->statistics) {
+            auto event = pimpl_->queue.make_statistics_event();
+            event["rate_limited_events"] = pimpl_->rate_limited;
+            emit(pimpl_.get(), std::move(event));
+        }
         pimpl_->running = false;
         pimpl_->cond.notify_all(); // tell the readers we're done
-        semaphore.release();       // allow another task to run
     });
     started.wait(); // guarantee Task() completes when the thread is running
 }
@@ -121,24 +115,58 @@ void Task::interrupt() {
     // both variables are safe to use in a MT context
     pimpl_->reactor->stop();
     pimpl_->interrupted = true;
+    Scheduler::global().wakeup(); // in case we're waiting to run
 }
 
 nlohmann::json Task::wait_for_next_event() {
     std::unique_lock<std::mutex> lock{pimpl_->mutex};
     // purpose: block here until we stop running or we have events to read
     pimpl_->cond.wait(lock, [this]() { //
-        return !pimpl_->running || !pimpl_->deque.empty();
+        return !pimpl_->running || !pimpl_->queue.empty();
     });
     // must be first so we drain the queue before emitting the final null
-    if (!pimpl_->deque.empty()) {
-        auto rv = std::move(pimpl_->deque.front());
-        pimpl_->deque.pop_front();
-        return nlohmann::json{std::move(rv)};
+    nlohmann::json rv;
+    if (pimpl_->queue.pop(rv)) {
+        return rv;
     }
     assert(!pimpl_->running);
     return nlohmann::json(); // this is a `null` JSON object
 }
 
+size_t Task::wait_for_next_events(std::vector<nlohmann::json> &events,
+                                  size_t max_events, double timeout,
+                                  bool *terminated) {
+    if (terminated != nullptr) {
+        *terminated = false;
+    }
+    if (max_events <= 0) {
+        return 0;
+    }
+    std::unique_lock<std::mutex> lock{pimpl_->mutex};
+    auto ready = [this]() {
+        return !pimpl_->running || !pimpl_->queue.empty();
+    };
+    if (timeout < 0.0) {
+        pimpl_->cond.wait(lock, ready);
+    } else {
+        (void)pimpl_->cond.wait_for(
+              lock, std::chrono::duration<double>(timeout), ready);
+    }
+    // Serializing is left to the caller, which does that unlocked
+    size_t count = 0;
+    nlohmann::json event;
+    while (count < max_events && pimpl_->queue.pop(event)) {
+        events.push_back(std::move(event));
+        count += 1;
+    }
+    // Decided under the lock, because the task emits its last events and
+    // only then stops running: checking is_running() afterwards would race
+    if (terminated != nullptr) {
+        *terminated = !pimpl_->running && pimpl_->queue.empty();
+    }
+    return count;
+}
+
 Task::~Task() {
     if (pimpl_->thread.joinable()) {
         pimpl_->thread.join();
@@ -302,6 +330,36 @@ static void remove_unknown_settings_and_warn(
     }
 }
 
+// Tests measuring the bandwidth, which do not run along with other tasks
+static bool is_bandwidth_sensitive(const std::string &type) {
+    return type == "Dash" || type == "MultiNdt" || type == "Ndt";
+}
+
+static bool make_task_budget(TaskImpl *pimpl, const std::string &type,
+                             const Settings &options, TaskBudget &budget) {
+    ErrorOr<bool> adaptive =
+          options.get_noexcept<bool>("adaptive_parallelism", false);
+    ErrorOr<size_t> parallelism = options.get_noexcept<size_t>(
+          (!!adaptive && *adaptive) ? "parallelism_max" : "parallelism",
+          (!!adaptive && *adaptive) ? 64 : 3);
+    if (!adaptive || !parallelism) {
+        return true; // Let the test complain about its options
+    }
+    ErrorOr<size_t> sockets = options.get_noexcept<size_t>(
+          "task_sockets",
+          *parallelism * nettests::ParallelismController::sockets_per_measurement);
+    ErrorOr<bool> bandwidth_sensitive = options.get_noexcept<bool>(
+          "task_bandwidth_sensitive", is_bandwidth_sensitive(type));
+    if (!sockets || *sockets <= 0 || !bandwidth_sensitive) {
+        emit_settings_failure(pimpl, "invalid 'task_sockets' or "
+                                     "'task_bandwidth_sensitive' option");
+        return false;
+    }
+    budget.sockets = *sockets;
+    budget.bandwidth_sensitive = *bandwidth_sensitive;
+    return true;
+}
+
 // # Run task
 
 static void task_run(TaskImpl *pimpl, nlohmann::json &settings) {
@@ -413,17 +471,57 @@ static void task_run(TaskImpl *pimpl, nlohmann::json &settings) {
 
     // TODO(bassosimone): add code for processing more event types.
 
+    pimpl->statistics = enabled_events.count("STATISTICS") != 0;
+
+    // extract and process the max rate of the PROGRESS and LOG events
+    ErrorOr<double> progress_rate =
+          runnable->options.get_noexcept<double>("max_progress_rate", 10.0);
+    ErrorOr<double> log_rate =
+          runnable->options.get_noexcept<double>("max_log_rate", 100.0);
+    ErrorOr<double> log_burst =
+          runnable->options.get_noexcept<double>("max_log_burst", 200.0);
+    if (!progress_rate || !log_rate || !log_burst) {
+        emit_settings_failure(pimpl, "invalid 'max_progress_rate', "
+                                     "'max_log_rate' or 'max_log_burst' option");
+        return;
+    }
+
+    // see whether 'PROGRESS' is enabled
+    if (enabled_events.count("PROGRESS") != 0) {
+        SharedPtr<TokenBucket> bucket{new TokenBucket{*progress_rate, 1.0}};
+        runnable->logger->on_progress(
+              [pimpl, bucket](double percentage, const char *message) {
+                  // The final progress must always be emitted
+                  if (percentage < 1.0 &&
+                      !bucket->consume(monotonic_time_now())) {
+                      pimpl->rate_limited += 1;
+                      return;
+                  }
+                  emit(pimpl, nlohmann::json{{"type", "PROGRESS"},
+                                             {"percentage", percentage},
+                                             {"message", message}});
+              });
+    }
+
     // see whether 'PERFORMANCE' is enabled
     // TODO(bassosimone): adapt this event according to spec when @hellais will
     // have finalized the events specification.
     //
-    // TODO(bassosimone): currently events are emitted using the logger and as
-    // such they're subject to the verosity, which is really a bummer.
+    // Note: we receive the events as JSON, rather than serialized, so they
+    // are not parsed again and they are not subject to the verbosity.
     if (enabled_events.count("PERFORMANCE") != 0) {
-        runnable->logger->on_event([pimpl](const char *line) {
+        runnable->logger->on_json_event([pimpl](nlohmann::json &&inner) {
             nlohmann::json event;
             try {
-                auto inner = nlohmann::json::parse(line);
+                event["type"] = "PERFORMANCE";
+                event["elapsed_seconds"] = inner.at("elapsed")[0];
+                if (inner.at("type") == "parallelism") {
+                    // Emitted by tests with adaptive parallelism
+                    event["parallelism"] = inner.at("window");
+                    event["running"] = inner.at("running");
+                    emit(pimpl, std::move(event));
+                    return;
+                }
                 if (inner.at("type") == "download-speed") {
                     event["direction"] = "download";
                 } else if (inner.at("type") == "upload-speed") {
@@ -432,10 +530,8 @@ static void task_run(TaskImpl *pimpl, nlohmann::json &settings) {
                     assert(false);
                     return; // Not an event we wanted to filter
                 }
-                event["type"] = "PERFORMANCE";
-                event["elapsed_seconds"] = inner["elapsed"][0];
-                event["num_streams"] = inner["num_streams"];
-                event["speed_kbit_s"] = inner["speed"][0];
+                event["num_streams"] = inner.at("num_streams");
+                event["speed_kbit_s"] = inner.at("speed")[0];
             } catch (const std::exception &) {
                 assert(false);
                 return; // Perhaps not the right event format
@@ -444,15 +540,41 @@ static void task_run(TaskImpl *pimpl, nlohmann::json &settings) {
         });
     }
 
+    // see whether 'RESULT' is enabled
+    if (enabled_events.count("RESULT") != 0) {
+        // Note: we get the serialization that is shared with the reporters,
+        // which costs a copy of the bytes, rather than the entry, which would
+        // cost a copy of the whole tree
+        runnable->entry_cb = [pimpl](std::string json_str) {
+            emit(pimpl, nlohmann::json{
+                    {"type", "RESULT"},
+                    {"value", {{"json_str", std::move(json_str)}}}});
+        };
+    }
+
     // see whether 'LOG' is enabled
     // TODO(bassosimone): adapt this event according to spec when @hellais will
     // have finalized the events specification.
     if (enabled_events.count("LOG") != 0) {
-        runnable->logger->on_log([pimpl](uint32_t verbosity, const char *line) {
+        // One bucket per verbosity level, such that e.g. many DEBUG2 logs
+        // do not prevent INFO logs from being emitted
+        SharedPtr<std::vector<TokenBucket>> buckets{
+              new std::vector<TokenBucket>(MK_LOG_DEBUG2 + 1,
+                                           TokenBucket{*log_rate, *log_burst})};
+        runnable->logger->on_log([pimpl, buckets](uint32_t verbosity,
+                                                  const char *line) {
             if ((verbosity & ~MK_LOG_VERBOSITY_MASK) != 0) {
                 return; // mask out non-logging events
             }
-            emit(pimpl, make_log_event(verbosity, line));
+            // Errors and warnings must always be emitted
+            if (verbosity > MK_LOG_WARNING && verbosity < buckets->size() &&
+                !(*buckets)[verbosity].consume(monotonic_time_now())) {
+                pimpl->rate_limited += 1;
+                return;
+            }
+            auto verbosity_tuple = verbosity_itoa(verbosity);
+            assert(std::get<1>(verbosity_tuple));
+            emit_log(pimpl, std::get<0>(verbosity_tuple), line);
         });
     } else {
         // Here we should silence the logger but we cannot do that since events
@@ -463,6 +585,26 @@ static void task_run(TaskImpl *pimpl, nlohmann::json &settings) {
         runnable->logger->on_log([](uint32_t, const char *) { /* NOTHING */ });
     }
 
+    // wait until the task can run along with the other running tasks
+    TaskBudget budget;
+    if (!make_task_budget(pimpl, settings.at("type").get<std::string>(),
+                          runnable->options, budget)) {
+        return;
+    }
+    bool queued_enabled = enabled_events.count("QUEUED") != 0;
+    Scheduler &scheduler = Scheduler::global();
+    if (!scheduler.acquire(budget, [pimpl]() { return !!pimpl->interrupted; },
+                           [pimpl, queued_enabled](size_t pos, double wait) {
+                               if (queued_enabled) {
+                                   emit(pimpl, nlohmann::json{
+                                                     {"type", "QUEUED"},
+                                                     {"queue_position", pos},
+                                                     {"wait_seconds", wait}});
+                               }
+                           })) {
+        return; // interrupted while waiting
+    }
+
     // start the task (reactor and interrupted are MT safe)
     pimpl->reactor->run_with_initial_event([&]() {
         if (pimpl->interrupted) {
@@ -474,6 +616,7 @@ static void task_run(TaskImpl *pimpl, nlohmann::json &settings) {
             });
         });
     });
+    scheduler.release(budget); // allow other tasks to run
 }
 
 } // namespace engine
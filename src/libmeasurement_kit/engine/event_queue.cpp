@@ -0,0 +1,100 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/engine/event_queue.hpp"
+
+#include <algorithm>
+
+namespace mk {
+namespace engine {
+
+// Messages coalesced into a single LOG event at most
+static const uint64_t max_log_lines = 64;
+
+EventQueue::EventQueue(size_t capacity)
+    : capacity_{std::max<size_t>(1, capacity)} {}
+
+bool EventQueue::is_queued_(uint64_t seqno) const {
+    return seqno >= popped_ && seqno - popped_ < queue_.size();
+}
+
+void EventQueue::push_back_(nlohmann::json &&event) {
+    queue_.push_back(std::move(event));
+    max_size_ = std::max<uint64_t>(max_size_, queue_.size());
+}
+
+void EventQueue::push(nlohmann::json &&event) {
+    const std::string &type = event.at("type").get_ref<const std::string &>();
+    if (type == "LOG") {
+        push_log(event.at("verbosity").get<std::string>(),
+                 event.at("message").get_ref<const std::string &>().c_str());
+        return;
+    }
+    if (type == "PROGRESS") {
+        // Only the latest progress matters, so there is at most one in the
+        // queue and there is no need to ever drop it
+        if (has_progress_ && is_queued_(progress_seqno_)) {
+            queue_[progress_seqno_ - popped_] = std::move(event);
+            merged_ += 1;
+            return;
+        }
+        push_back_(std::move(event));
+        progress_seqno_ = popped_ + queue_.size() - 1;
+        has_progress_ = true;
+        return;
+    }
+    bool critical = type == "RESULT" || type == "FAILURE" ||
+                    type == "STATISTICS";
+    if (!critical && queue_.size() >= capacity_) {
+        dropped_ += 1;
+        return;
+    }
+    push_back_(std::move(event));
+}
+
+void EventQueue::push_log(const std::string &verbosity, const char *message) {
+    if (has_log_ && queue_.size() > 0 &&
+        log_seqno_ == popped_ + queue_.size() - 1 &&
+        log_lines_ < max_log_lines &&
+        queue_.back().at("verbosity").get_ref<const std::string &>() ==
+              verbosity) {
+        std::string &batch =
+              queue_.back().at("message").get_ref<std::string &>();
+        batch += "\n";
+        batch += message;
+        log_lines_ += 1;
+        merged_ += 1;
+        return;
+    }
+    bool critical = verbosity == "ERR" || verbosity == "WARNING";
+    if (!critical && queue_.size() >= capacity_) {
+        dropped_ += 1;
+        return;
+    }
+    push_back_(nlohmann::json{
+          {"type", "LOG"}, {"verbosity", verbosity}, {"message", message}});
+    log_seqno_ = popped_ + queue_.size() - 1;
+    log_lines_ = 1;
+    has_log_ = true;
+}
+
+bool EventQueue::pop(nlohmann::json &event) {
+    if (queue_.empty()) {
+        return false;
+    }
+    event = std::move(queue_.front());
+    queue_.pop_front();
+    popped_ += 1;
+    return true;
+}
+
+nlohmann::json EventQueue::make_statistics_event() const {
+    return nlohmann::json{{"type", "STATISTICS"},
+                          {"dropped_events", dropped_},
+                          {"merged_events", merged_},
+                          {"max_queued_events", max_size_}};
+}
+
+} // namespace engine
+} // namespace mk
@@ -0,0 +1,76 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+#ifndef SRC_LIBMEASUREMENT_KIT_ENGINE_EVENT_QUEUE_HPP
+#define SRC_LIBMEASUREMENT_KIT_ENGINE_EVENT_QUEUE_HPP
+
+#include <measurement_kit/common/nlohmann/json.hpp>
+#include <measurement_kit/common/non_copyable.hpp>
+#include <measurement_kit/common/non_movable.hpp>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+
+namespace mk {
+namespace engine {
+
+// Queue of the events of a task waiting to be consumed, which does not grow
+// beyond `capacity` events when the consumer is slower than the task:
+//
+// - a LOG event is coalesced with the last queued event, if that is also
+//   a LOG event with the same verbosity, by appending its message, after a
+//   newline, to the message of the queued event;
+//
+// - a PROGRESS event replaces the queued PROGRESS event, if any;
+//
+// - other events are dropped when the queue is full, unless they are
+//   critical (RESULT, FAILURE, STATISTICS and LOG events with ERR or
+//   WARNING verbosity), which are always queued.
+//
+// The queue is not thread safe.
+class EventQueue : public NonCopyable, public NonMovable {
+  public:
+    explicit EventQueue(size_t capacity = 1024);
+
+    void push(nlohmann::json &&event);
+
+    // Like push() for a LOG event, without creating it unless needed.
+    void push_log(const std::string &verbosity, const char *message);
+
+    // Returns false if the queue is empty.
+    bool pop(nlohmann::json &event);
+
+    bool empty() const { return queue_.empty(); }
+    size_t size() const { return queue_.size(); }
+
+    uint64_t dropped() const { return dropped_; }
+    uint64_t merged() const { return merged_; }
+
+    // The STATISTICS event describing what happened to the events.
+    nlohmann::json make_statistics_event() const;
+
+    ~EventQueue() = default;
+
+  private:
+    bool is_queued_(uint64_t seqno) const;
+    void push_back_(nlohmann::json &&event);
+
+    size_t capacity_ = 0;
+    uint64_t dropped_ = 0;
+    uint64_t log_lines_ = 0;    // Messages coalesced into the last LOG
+    uint64_t log_seqno_ = 0;    // Sequence number of the last LOG
+    uint64_t max_size_ = 0;
+    uint64_t merged_ = 0;
+    uint64_t popped_ = 0;       // Sequence number of the first event
+    uint64_t progress_seqno_ = 0;
+    bool has_log_ = false;
+    bool has_progress_ = false;
+    std::deque<nlohmann::json> queue_;
+};
+
+} // namespace engine
+} // namespace mk
+#endif
@@ -0,0 +1,115 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/engine/scheduler.hpp"
+
+#include "src/libmeasurement_kit/common/utils.hpp"
+#include "src/libmeasurement_kit/nettests/parallelism.hpp"
+
+#include <algorithm>
+
+namespace mk {
+namespace engine {
+
+// Tasks that run at the same time when they fit the sockets budget
+static const size_t default_max_tasks = 4;
+
+// Sockets available to the tasks when there is no limit on open files
+static const size_t default_max_sockets = 1024;
+
+static size_t max_sockets() {
+    size_t sockets = nettests::ParallelismController::socket_limit();
+    return (sockets > 0) ? sockets : default_max_sockets;
+}
+
+Scheduler::Scheduler(size_t max_tasks, size_t max_sockets)
+    : max_sockets_{std::max<size_t>(1, max_sockets)},
+      max_tasks_{std::max<size_t>(1, max_tasks)} {}
+
+/* static */ Scheduler &Scheduler::global() {
+    static Scheduler singleton{default_max_tasks, max_sockets()};
+    return singleton;
+}
+
+bool Scheduler::fits_(const TaskBudget &budget) const {
+    if (running_ <= 0) {
+        return true;
+    }
+    if (exclusive_ || budget.bandwidth_sensitive) {
+        return false;
+    }
+    return running_ < max_tasks_ && sockets_ + budget.sockets <= max_sockets_;
+}
+
+bool Scheduler::acquire(const TaskBudget &budget,
+                        std::function<bool()> &&interrupted,
+                        std::function<void(size_t, double)> &&on_wait) {
+    std::unique_lock<std::mutex> lock{mutex_};
+    uint64_t ticket = next_ticket_++;
+    queue_.push_back(ticket);
+    double begin = monotonic_time_now();
+    size_t reported = 0;
+    for (;;) {
+        if (interrupted()) {
+            queue_.remove(ticket);
+            lock.unlock();
+            cond_.notify_all(); // the task behind us may now be the first
+            return false;
+        }
+        size_t position = 1 + (size_t)std::distance(
+              queue_.begin(), std::find(queue_.begin(), queue_.end(), ticket));
+        if (position == 1 && fits_(budget)) {
+            break;
+        }
+        if (position != reported) {
+            reported = position;
+            // Unlock such that we do not call the user with the lock held,
+            // then check again, since meanwhile the queue may have changed
+            lock.unlock();
+            on_wait(position, monotonic_time_now() - begin);
+            lock.lock();
+            continue;
+        }
+        cond_.wait(lock);
+    }
+    queue_.pop_front();
+    running_ += 1;
+    sockets_ += budget.sockets;
+    exclusive_ = exclusive_ || budget.bandwidth_sensitive;
+    lock.unlock();
+    cond_.notify_all(); // the task behind us may also fit
+    if (reported > 0) {
+        on_wait(0, monotonic_time_now() - begin);
+    }
+    return true;
+}
+
+void Scheduler::release(const TaskBudget &budget) {
+    {
+        std::unique_lock<std::mutex> _{mutex_};
+        running_ -= 1;
+        sockets_ -= budget.sockets;
+        if (budget.bandwidth_sensitive) {
+            exclusive_ = false;
+        }
+    }
+    cond_.notify_all();
+}
+
+void Scheduler::wakeup() {
+    {
+        // Such that a task cannot miss the wakeup between checking whether
+        // it was interrupted and waiting on the condition variable
+        std::unique_lock<std::mutex> _{mutex_};
+    }
+    cond_.notify_all();
+}
+
+size_t Scheduler::running() const {
+    std::unique_lock<std::mutex> _{mutex_};
+    return running_;
+}
+
+} // namespace engine
+} // namespace mk
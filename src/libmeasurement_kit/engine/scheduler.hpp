@@ -0,0 +1,83 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+#ifndef SRC_LIBMEASUREMENT_KIT_ENGINE_SCHEDULER_HPP
+#define SRC_LIBMEASUREMENT_KIT_ENGINE_SCHEDULER_HPP
+
+#include <measurement_kit/common/non_copyable.hpp>
+#include <measurement_kit/common/non_movable.hpp>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+
+namespace mk {
+namespace engine {
+
+// Resources that a task needs while it runs.
+class TaskBudget {
+  public:
+    // Sockets that the task may keep open at the same time
+    size_t sockets = 1;
+
+    // Whether the task measures the bandwidth, such that it must not run
+    // along with other tasks that would skew its results
+    bool bandwidth_sensitive = false;
+};
+
+// Decides when the tasks run. Up to `max_tasks` tasks may run at the same
+// time, as long as the sum of their socket budgets does not exceed
+// `max_sockets`, while a bandwidth sensitive task only runs alone. A task
+// whose budget is larger than `max_sockets` also runs alone.
+//
+// Tasks are admitted in the order in which they arrived: a task that does
+// not fit blocks the tasks behind it, such that a bandwidth sensitive task
+// is not starved by a stream of smaller tasks.
+class Scheduler : public NonCopyable, public NonMovable {
+  public:
+    Scheduler(size_t max_tasks, size_t max_sockets);
+
+    // The scheduler shared by all the tasks of the engine, which runs up to
+    // four tasks, within the limit on open files (RLIMIT_NOFILE)
+    static Scheduler &global();
+
+    // Blocks until the task with the specified budget may run. While the
+    // task is waiting, `on_wait` is called with its position in the queue
+    // (starting from one) and the seconds it waited whenever the position
+    // changes, and, if it waited, with position zero right before it runs.
+    // Returns false, without running the task, if `interrupted` returns
+    // true, which is checked again whenever wakeup() is called.
+    bool acquire(const TaskBudget &budget, std::function<bool()> &&interrupted,
+                 std::function<void(size_t, double)> &&on_wait);
+
+    // Must be called when a task admitted by acquire() has finished.
+    void release(const TaskBudget &budget);
+
+    // Makes the waiting tasks check whether they were interrupted.
+    void wakeup();
+
+    size_t running() const;
+
+    ~Scheduler() = default;
+
+  private:
+    bool fits_(const TaskBudget &budget) const;
+
+    std::condition_variable cond_;
+    bool exclusive_ = false;
+    size_t max_sockets_ = 0;
+    size_t max_tasks_ = 0;
+    mutable std::mutex mutex_;
+    uint64_t next_ticket_ = 0;
+    std::list<uint64_t> queue_;
+    size_t running_ = 0;
+    size_t sockets_ = 0;
+};
+
+} // namespace engine
+} // namespace mk
+#endif
@@ -11,16 +11,23 @@
 
 #include <exception>
 #include <string>
+#include <vector>
 
 #include <measurement_kit/common/nlohmann/json.hpp>
 #include <measurement_kit/engine.h>
 
+#include "src/libmeasurement_kit/common/json_writer.hpp"
+
 struct mk_event_ : public std::string {
     using std::string::string;
 };
 
 static mk_event_t *mk_event_create(const nlohmann::json &json) noexcept {
-    return new mk_event_t{json.dump().data()};
+    // Serialize directly into the event, which may contain a large entry
+    mk_event_t *event = new mk_event_t;
+    mk::StringSink sink{*event};
+    (void)mk::write_json(json, sink); // Cannot fail
+    return event;
 }
 
 const char *mk_event_serialize(mk_event_t *event) noexcept {
@@ -31,6 +38,25 @@ void mk_event_destroy(mk_event_t *event) noexcept {
     delete event; // handles nullptr
 }
 
+struct mk_events_ {
+    std::string serialization;
+    std::vector<nlohmann::json> events; // Reused to avoid allocations
+};
+
+mk_events_t *mk_events_create() noexcept { return new mk_events_t; }
+
+const char *mk_events_serialize(mk_events_t *events) noexcept {
+    return (events) ? events->serialization.data() : nullptr;
+}
+
+size_t mk_events_size(mk_events_t *events) noexcept {
+    return (events) ? events->serialization.size() : 0;
+}
+
+void mk_events_destroy(mk_events_t *events) noexcept {
+    delete events; // handles nullptr
+}
+
 struct mk_task_ : mk::engine::Task {
     using mk::engine::Task::Task;
 };
@@ -64,6 +90,33 @@ mk_event_t *mk_task_wait_for_next_event(mk_task_t *task) noexcept {
     return (task) ? mk_event_create(task->wait_for_next_event()) : nullptr;
 }
 
+size_t mk_task_wait_for_events(mk_task_t *task, mk_events_t *events,
+                               size_t max_events, double timeout,
+                               int *terminated) noexcept {
+    if (terminated != nullptr) {
+        *terminated = 0;
+    }
+    if (task == nullptr || events == nullptr) {
+        return 0;
+    }
+    events->serialization.clear();
+    events->events.clear();
+    bool done = false;
+    size_t count = task->wait_for_next_events(events->events, max_events,
+                                              timeout, &done);
+    if (terminated != nullptr) {
+        *terminated = done;
+    }
+    // Serialize directly into the buffer, whose capacity is reused
+    mk::StringSink sink{events->serialization};
+    for (auto &event : events->events) {
+        (void)mk::write_json(event, sink); // Cannot fail
+        events->serialization += "\n";
+    }
+    events->events.clear();
+    return count;
+}
+
 int mk_task_is_running(mk_task_t *task) noexcept {
     return (task) ? task->is_running() : 0;
 }
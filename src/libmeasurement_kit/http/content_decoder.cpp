@@ -0,0 +1,129 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/http/content_decoder.hpp"
+#include "src/libmeasurement_kit/common/utils.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+namespace mk {
+namespace http {
+
+// Size of the buffer into which zlib writes decoded data.
+constexpr size_t window_size = 16384;
+
+static std::string canonicalize(std::string s) {
+    s.erase(std::remove_if(s.begin(), s.end(),
+                           [](unsigned char c) { return isspace(c); }),
+            s.end());
+    std::transform(s.begin(), s.end(), s.begin(),
+                   [](unsigned char c) { return tolower(c); });
+    if (s == "x-gzip") {
+        s = "gzip";
+    }
+    return s;
+}
+
+bool is_decodable_content_encoding(const std::string &encoding) {
+    std::string s = canonicalize(encoding);
+    return s == "gzip" || s == "deflate";
+}
+
+ContentDecoder::ContentDecoder(std::string encoding, size_t max_size)
+    : encoding_{canonicalize(encoding)}, max_size_{max_size},
+      window_(window_size) {}
+
+ContentDecoder::~ContentDecoder() {
+    if (initialized_) {
+        inflateEnd(&stream_);
+    }
+}
+
+Error ContentDecoder::init_() {
+    int window_bits = 15;
+    if (encoding_ == "gzip") {
+        window_bits += 16;
+    } else if (encoding_ == "deflate") {
+        // RFC 7230 says `deflate` is zlib wrapped but some servers send
+        // raw deflate. A zlib header is two bytes, where the low nibble of
+        // the first is 8 and both bytes, as a big endian number, are a
+        // multiple of 31 (see RFC 1950 Sect. 2.2).
+        unsigned cmf = (unsigned char)head_[0], flg = (unsigned char)head_[1];
+        if ((cmf & 0x0f) != 8 || ((cmf << 8) | flg) % 31 != 0) {
+            window_bits = -window_bits;
+        }
+    } else {
+        return ContentDecodingError();
+    }
+    if (inflateInit2(&stream_, window_bits) != Z_OK) {
+        return ContentDecodingError();
+    }
+    initialized_ = true;
+    return NoError();
+}
+
+Error ContentDecoder::feed(const char *p, size_t n,
+                           const std::function<void(std::string)> &cb) {
+    if (!initialized_) {
+        // Buffer the first two bytes so that init_() can sniff the format
+        head_.append(p, n);
+        if (head_.size() < 2) {
+            return NoError();
+        }
+        Error err = init_();
+        if (err) {
+            return err;
+        }
+        std::string head = std::move(head_);
+        return inflate_(head.data(), head.size(), cb);
+    }
+    return inflate_(p, n, cb);
+}
+
+Error ContentDecoder::inflate_(const char *p, size_t n,
+                               const std::function<void(std::string)> &cb) {
+    if (stream_end_) {
+        return NoError(); // Ignore trailing garbage like browsers do
+    }
+    stream_.next_in = (Bytef *)p;
+    stream_.avail_in = (uInt)n;
+    do {
+        stream_.next_out = (Bytef *)window_.data();
+        stream_.avail_out = (uInt)window_.size();
+        int ret = inflate(&stream_, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            return ContentDecodingError();
+        }
+        size_t count = window_.size() - stream_.avail_out;
+        if (count > max_size_ - total_) {
+            return MaxDecompressedSizeExceededError();
+        }
+        total_ += count;
+        if (count > 0 && cb) {
+            cb(std::string{window_.data(), count});
+        }
+        if (ret == Z_STREAM_END) {
+            stream_end_ = true;
+            break;
+        }
+        if (ret == Z_BUF_ERROR) {
+            break; // Needs more input to make progress
+        }
+    } while (stream_.avail_in > 0 || stream_.avail_out == 0);
+    return NoError();
+}
+
+Error ContentDecoder::finish() {
+    if (!initialized_ && head_.empty()) {
+        return NoError(); // Empty body, e.g. because the method was HEAD
+    }
+    if (!stream_end_) {
+        return ContentDecodingError(); // Truncated or empty encoded body
+    }
+    return NoError();
+}
+
+} // namespace http
+} // namespace mk
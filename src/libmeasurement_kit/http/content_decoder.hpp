@@ -0,0 +1,58 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+#ifndef SRC_LIBMEASUREMENT_KIT_HTTP_CONTENT_DECODER_HPP
+#define SRC_LIBMEASUREMENT_KIT_HTTP_CONTENT_DECODER_HPP
+
+#include <measurement_kit/http.hpp>
+
+#include <functional>
+#include <vector>
+
+#include <zlib.h>
+
+namespace mk {
+namespace http {
+
+// Default value of the `http/max_decompressed_size` setting.
+constexpr size_t default_max_decompressed_size = 64 * 1024 * 1024;
+
+// Returns true if `encoding` (i.e. the value of a `Content-Encoding` header)
+// is one of the encodings that ContentDecoder is able to decode.
+bool is_decodable_content_encoding(const std::string &encoding);
+
+// Streaming decoder for gzip and deflate encoded bodies. Decoded data is
+// produced in chunks no bigger than the output window, which bounds the
+// amount of memory used for decoding regardless of the compression ratio,
+// and the total is checked against `max_size` to defeat decompression bombs.
+class ContentDecoder : public NonCopyable, public NonMovable {
+  public:
+    ContentDecoder(std::string encoding, size_t max_size);
+    ~ContentDecoder();
+
+    Error feed(const char *p, size_t n,
+               const std::function<void(std::string)> &cb);
+
+    // Call when the encoded body is over to make sure it was not truncated.
+    Error finish();
+
+    size_t decoded_size() const { return total_; }
+
+  private:
+    Error init_();
+    Error inflate_(const char *p, size_t n,
+                   const std::function<void(std::string)> &cb);
+
+    std::string encoding_;
+    std::string head_;
+    bool initialized_ = false;
+    size_t max_size_ = default_max_decompressed_size;
+    bool stream_end_ = false;
+    z_stream stream_{};
+    size_t total_ = 0;
+    std::vector<char> window_;
+};
+
+} // namespace http
+} // namespace mk
+#endif
@@ -0,0 +1,141 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/http/pipeline.hpp"
+#include "src/libmeasurement_kit/common/utils.hpp"
+
+namespace mk {
+namespace http {
+
+using namespace mk::net;
+
+Pipeline::Pipeline(SharedPtr<Transport> txp, size_t depth,
+                   SharedPtr<Reactor> reactor, SharedPtr<Logger> logger)
+    : depth_{(depth > 0) ? depth : 1}, logger_{std::move(logger)},
+      reactor_{std::move(reactor)}, txp_{std::move(txp)} {}
+
+void Pipeline::submit(Settings settings, Headers headers, std::string body,
+                      Callback<Error, SharedPtr<Response>> cb) {
+    if (error_) {
+        Error error = error_;
+        reactor_->call_soon([cb, error]() { cb(error, {}); });
+        return;
+    }
+    Item item;
+    item.settings = std::move(settings);
+    item.headers = std::move(headers);
+    item.body = std::move(body);
+    item.cb = std::move(cb);
+    pending_.push_back(std::move(item));
+    pump_();
+}
+
+void Pipeline::fail_all_(Error error) {
+    error_ = error;
+    // Move out all callbacks first, since they may call submit()
+    std::deque<Item> items;
+    items.swap(in_flight_);
+    for (auto &item : pending_) {
+        items.push_back(std::move(item));
+    }
+    pending_.clear();
+    for (auto &item : items) {
+        SharedPtr<Response> response{std::make_shared<Response>()};
+        response->request = item.request;
+        item.cb(error, response);
+    }
+}
+
+void Pipeline::pump_() {
+    if (busy_ || error_) {
+        return;
+    }
+    SharedPtr<Pipeline> self = shared_from_this();
+
+    // Write as many requests as we are allowed before reading
+    if (!pending_.empty() && in_flight_.size() < effective_depth_) {
+        busy_ = true;
+        Item item = std::move(pending_.front());
+        pending_.pop_front();
+        logger_->debug("http: pipeline: sending request (in flight: %zu)",
+                       in_flight_.size());
+        send_(txp_, item.settings, item.headers, item.body, logger_,
+              [self, item](Error error, SharedPtr<Request> request) {
+            self->busy_ = false;
+            Item copy = item;
+            copy.request = request;
+            copy.request_written = mk::monotonic_time_now();
+            self->in_flight_.push_back(std::move(copy));
+            if (error) {
+                self->fail_all_(error);
+                return;
+            }
+            self->pump_();
+        });
+        return;
+    }
+
+    if (in_flight_.empty()) {
+        return;
+    }
+    busy_ = true;
+    recv_(txp_, buff_,
+            [self](Error error, SharedPtr<Response> response) {
+        self->busy_ = false;
+        Item item = std::move(self->in_flight_.front());
+        self->in_flight_.pop_front();
+        if (!response) {
+            response = SharedPtr<Response>::make();
+        }
+        response->request = item.request;
+        response->timings.request_written = item.request_written;
+        if (error) {
+            if (!self->in_flight_.empty()) {
+                self->logger_->warn("http: pipeline: broken by %s",
+                                    error.what());
+                self->broken_ = true;
+            }
+            // Set the error before calling back, so that the requests the
+            // callback may submit fail instead of using a broken transport
+            self->error_ = self->broken_ ? Error{PipeliningBrokenError()}
+                                         : error;
+            item.cb(error, response);
+            self->fail_all_(self->error_);
+            return;
+        }
+        bool closing =
+              header_has_token(response->headers, "Connection", "close");
+        if (!self->probed_) {
+            self->probed_ = true;
+            if (response->http_major == 1 && response->http_minor >= 1 &&
+                !closing) {
+                self->effective_depth_ = self->depth_;
+            } else if (self->depth_ > 1) {
+                self->logger_->warn("http: pipeline: server does not seem "
+                                    "to support pipelining; disabling it");
+                self->broken_ = true;
+            }
+        }
+        if (closing) {
+            if (!self->in_flight_.empty()) {
+                self->logger_->warn("http: pipeline: connection closed with "
+                                    "requests in flight");
+                self->broken_ = true;
+            }
+            // The server will not process any further request: fail them
+            // (including those submitted by the callback) so that they can
+            // be retried on another connection
+            self->error_ = PipeliningBrokenError();
+        }
+        item.cb(NoError(), response);
+        if (self->error_) {
+            self->fail_all_(self->error_);
+            return;
+        }
+        self->pump_();
+    }, in_flight_.front().settings, reactor_, logger_);
+}
+
+} // namespace http
+} // namespace mk
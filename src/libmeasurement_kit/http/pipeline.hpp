@@ -0,0 +1,107 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+#ifndef SRC_LIBMEASUREMENT_KIT_HTTP_PIPELINE_HPP
+#define SRC_LIBMEASUREMENT_KIT_HTTP_PIPELINE_HPP
+
+#include "src/libmeasurement_kit/common/mock.hpp"
+
+#include <measurement_kit/http.hpp>
+
+#include <deque>
+
+namespace mk {
+namespace http {
+
+// HTTP/1.1 pipelining over a single transport, implemented on top of
+// request_send() and request_recv_pipelined_response().
+//
+// Up to `depth` requests are written before their responses are read, and
+// responses are matched with requests in order. To avoid overlapping reads
+// and writes, which would compete for the transport's error handler, the
+// pipeline alternates between writing a request (which only takes the time
+// to flush it) and reading a response.
+//
+// The first request is always sent alone. Pipelining is only enabled if its
+// response is HTTP/1.1 and does not contain `Connection: close`; otherwise
+// we fall back to sending one request at a time and broken() is true. Also
+// broken() becomes true if the connection fails while more than a request
+// is in flight, in which case the requests following the failed one are
+// completed with PipeliningBrokenError, so the caller can reconnect and
+// retry without pipelining. Likewise, after a response containing
+// `Connection: close`, all the requests not answered yet (including the ones
+// submitted from that response's callback) fail with PipeliningBrokenError.
+// After any error, the pipeline is not usable.
+class Pipeline : public EnableSharedFromThis<Pipeline>,
+                 public NonCopyable,
+                 public NonMovable {
+  public:
+    // Use make() to construct, because we need to be owned by a SharedPtr
+    Pipeline(SharedPtr<net::Transport> txp, size_t depth,
+             SharedPtr<Reactor> reactor, SharedPtr<Logger> logger);
+
+    // The functions used to send and receive are template parameters, such
+    // that the code using a pipeline can be tested with mocks
+    template <MK_MOCK_AS(request_send, http_request_send),
+              MK_MOCK_AS(request_recv_pipelined_response,
+                         http_request_recv_pipelined_response)>
+    static SharedPtr<Pipeline> make(SharedPtr<net::Transport> txp,
+                                    size_t depth,
+                                    SharedPtr<Reactor> reactor =
+                                          Reactor::global(),
+                                    SharedPtr<Logger> logger =
+                                          Logger::global()) {
+        SharedPtr<Pipeline> pipeline{std::make_shared<Pipeline>(
+              std::move(txp), depth, std::move(reactor), std::move(logger))};
+        pipeline->send_ = http_request_send;
+        pipeline->recv_ = http_request_recv_pipelined_response;
+        return pipeline;
+    }
+
+    // The settings are passed to both request_send() and the function that
+    // receives the response; `cb` is called in submission order.
+    void submit(Settings settings, Headers headers, std::string body,
+                Callback<Error, SharedPtr<Response>> cb);
+
+    bool broken() const { return broken_; }
+
+    // Number of requests that may be in flight at this moment
+    size_t depth() const { return effective_depth_; }
+
+    // Number of requests submitted whose response was not received yet
+    size_t outstanding() const { return pending_.size() + in_flight_.size(); }
+
+  private:
+    class Item {
+      public:
+        Settings settings;
+        Headers headers;
+        std::string body;
+        Callback<Error, SharedPtr<Response>> cb;
+        SharedPtr<Request> request;
+        double request_written = 0.0;
+    };
+
+    void pump_();
+    void fail_all_(Error error);
+
+    SharedPtr<net::Buffer> buff_ = SharedPtr<net::Buffer>::make();
+    bool broken_ = false;
+    bool busy_ = false;
+    size_t depth_ = 1;
+    size_t effective_depth_ = 1;
+    Error error_;
+    std::deque<Item> in_flight_;
+    SharedPtr<Logger> logger_;
+    std::deque<Item> pending_;
+    bool probed_ = false;
+    SharedPtr<Reactor> reactor_;
+    decltype(request_recv_pipelined_response) *recv_ =
+          request_recv_pipelined_response;
+    decltype(request_send) *send_ = request_send;
+    SharedPtr<net::Transport> txp_;
+};
+
+} // namespace http
+} // namespace mk
+#endif
@@ -5,6 +5,8 @@
 #include "src/libmeasurement_kit/http/request_impl.hpp"
 #include "src/libmeasurement_kit/common/utils.hpp"
 
+#include <sstream>
+
 namespace mk {
 namespace http {
 
@@ -51,6 +53,13 @@ Error Request::init(Settings settings, Headers hdrs, std::string bd) {
     if (url_path != "" && url_path[0] != '/') {
         url_path = "/" + url_path;
     }
+    // Note: not using get() because the value may contain spaces. Also,
+    // explicitly passed headers win, so measurements keep full control.
+    auto accept_encoding = settings.find("http/accept_encoding");
+    if (accept_encoding != settings.end() && accept_encoding->second != "" &&
+        headers.find("Accept-Encoding") == headers.end()) {
+        headers["Accept-Encoding"] = accept_encoding->second;
+    }
     return NoError();
 }
 
@@ -132,6 +141,7 @@ class RequestRecvResponse {
     Callback<Error, SharedPtr<Response>> cb;
     SharedPtr<Logger> logger;
     SharedPtr<ResponseParserNg> parser;
+    bool pipelined = false;
     bool reached_end = false;
     SharedPtr<Reactor> reactor;
     SharedPtr<Response> response;
@@ -163,6 +173,22 @@ void request_recv_response(SharedPtr<Transport> txp,
     request_recv_response_start(std::move(ctx));
 }
 
+void request_recv_pipelined_response(SharedPtr<Transport> txp,
+        SharedPtr<Buffer> buff, Callback<Error, SharedPtr<Response>> cb,
+        Settings settings, SharedPtr<Reactor> reactor,
+        SharedPtr<Logger> logger) {
+    SharedPtr<RequestRecvResponse> ctx{std::make_shared<RequestRecvResponse>(
+        std::move(txp), std::move(cb), std::move(settings), std::move(reactor),
+        std::move(logger)
+    )};
+    // Note: since `buff` is shared with the caller, whatever follows the
+    // response is left inside it for reading the next pipelined response
+    ctx->buff = std::move(buff);
+    ctx->pipelined = true;
+    ctx->parser->allow_pipelining();
+    request_recv_response_start(std::move(ctx));
+}
+
 static void request_recv_response_start(SharedPtr<RequestRecvResponse> ctx) {
 
     ErrorOr<bool> ignore_body = ctx->settings.get_noexcept(
@@ -175,14 +201,33 @@ static void request_recv_response_start(SharedPtr<RequestRecvResponse> ctx) {
         ctx->parser->on_body([ctx](std::string s) {
             ctx->response->body += s;
         });
+        ctx->parser->on_raw_body([ctx](std::string s) {
+            ctx->response->raw_body += s;
+        });
+    }
+
+    ErrorOr<int> max_decompressed_size = ctx->settings.get_noexcept(
+            "http/max_decompressed_size", (int)default_max_decompressed_size);
+    if (!max_decompressed_size || *max_decompressed_size < 0) {
+        ctx->cb(ValueError(), ctx->response);
+        return;
+    }
+    auto accept_encoding = ctx->settings.find("http/accept_encoding");
+    if (accept_encoding != ctx->settings.end() &&
+        accept_encoding->second != "") {
+        ctx->parser->enable_content_decoding((size_t)*max_decompressed_size);
     }
 
     ctx->parser->on_response([ctx](Response r) {
+        auto timings = ctx->response->timings;
         *ctx->response = r;
+        ctx->response->timings = timings;
+        ctx->response->timings.headers_complete = mk::monotonic_time_now();
         ctx->valid_response = true;
     });
 
     ctx->parser->on_end([ctx]() {
+        ctx->response->timings.body_complete = mk::monotonic_time_now();
         ctx->reached_end = true;
         if (ctx->response->body.size() > 0) {
             ctx->logger->debug2("%s", ctx->response->body.c_str());
@@ -196,6 +241,9 @@ static void request_recv_response_start(SharedPtr<RequestRecvResponse> ctx) {
 static void request_recv_response_loop(SharedPtr<RequestRecvResponse> ctx) {
     net::read(ctx->txp, ctx->buff, [ctx](Error err) {
         if (err == NoError() && ctx->buff->length() > 0) {
+            if (ctx->response->timings.first_byte == 0.0) {
+                ctx->response->timings.first_byte = mk::monotonic_time_now();
+            }
             ctx->logger->debug("http: passing read data to parser");
             try {
                 ctx->parser->feed(*ctx->buff);
@@ -223,6 +271,9 @@ static void request_recv_response_loop(SharedPtr<RequestRecvResponse> ctx) {
                 // FALLTHRU
             }
         }
+        if (ctx->pipelined) {
+            ctx->parser->move_remaining_to(*ctx->buff);
+        }
         ctx->reactor->call_soon([ctx, err]() {
             ctx->logger->debug2("http: end of closure");
             // Completely reset all fields of the context, moving out all that
@@ -261,7 +312,9 @@ void request_maybe_sendrecv(ErrorOr<SharedPtr<Request>> request, SharedPtr<Trans
             callback(error, response);
             return;
         }
+        double request_written = mk::monotonic_time_now();
         request_recv_response(txp, [=](Error error, SharedPtr<Response> response) {
+            response->timings.request_written = request_written;
             if (error) {
                 callback(error, response);
                 return;
@@ -330,6 +383,9 @@ void request(Settings settings, Headers headers, std::string body,
             request_sendrecv(
                 txp, settings, headers, body,
                 [=](Error error, SharedPtr<Response> response) {
+                    if (!!response) {
+                        response->timings.connect = txp->connect_timings();
+                    }
                     txp->close([=]() {
                         if (error) {
                             callback(error, response);
@@ -379,6 +435,28 @@ bool HeadersComparator::operator() (
     return strcasecmp(l.c_str(), r.c_str()) < 0;
 }
 
+bool header_has_token(const Headers &headers, const std::string &name,
+                      const std::string &token) {
+    auto it = headers.find(name);
+    if (it == headers.end()) {
+        return false;
+    }
+    std::stringstream ss{it->second};
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t first = item.find_first_not_of(" \t");
+        if (first == std::string::npos) {
+            continue;
+        }
+        size_t last = item.find_last_not_of(" \t");
+        if (strcasecmp(item.substr(first, last - first + 1).c_str(),
+                       token.c_str()) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void request_json_string(
       std::string method, std::string url, std::string data,
       http::Headers headers,
@@ -55,6 +55,9 @@ void request_json_string_impl(
       Settings settings, SharedPtr<Reactor> reactor, SharedPtr<Logger> logger) {
     settings["http/url"] = url;
     settings["http/method"] = method;
+    if (settings.find("http/accept_encoding") == settings.end()) {
+        settings["http/accept_encoding"] = "gzip, deflate";
+    }
     headers["Content-Type"] = "application/json";
     logger->debug("%s to %s (body: '%s')", method.c_str(), url.c_str(),
                   data.c_str());
@@ -7,6 +7,7 @@
 #include "../ext/http_parser.h"
 
 #include "src/libmeasurement_kit/common/delegate.hpp"
+#include "src/libmeasurement_kit/http/content_decoder.hpp"
 #include <measurement_kit/http.hpp>
 
 #include <type_traits>
@@ -33,6 +34,23 @@ class ResponseParserNg : public NonCopyable, public NonMovable {
 
     void on_end(std::function<void()> fn) { end_fn_ = fn; }
 
+    // Called with the still-encoded body when content decoding is active,
+    // in which case on_body() receives the decoded body instead.
+    void on_raw_body(std::function<void(std::string)> fn) { raw_body_fn_ = fn; }
+
+    // Stop after the first message without complaining if more data follows,
+    // which is what happens with pipelined responses. Such extra data can then
+    // be retrieved using move_remaining_to().
+    void allow_pipelining() { allow_pipelining_ = true; }
+
+    void move_remaining_to(Buffer &buff) { buff << buffer_; }
+
+    // Decode gzip and deflate bodies emitting at most `max_size` bytes.
+    void enable_content_decoding(size_t max_size) {
+        decoding_enabled_ = true;
+        max_decompressed_size_ = max_size;
+    }
+
     void feed(Buffer &data) {
         buffer_ << data;
         parse();
@@ -53,6 +71,8 @@ class ResponseParserNg : public NonCopyable, public NonMovable {
     int do_message_begin_() {
         logger_->debug2("http: BEGIN");
         response_ = Response();
+        decoder_.reset();
+        decoding_error_ = NoError();
         prev_ = HeaderParserState::NOTHING;
         field_ = "";
         value_ = "";
@@ -97,6 +117,14 @@ class ResponseParserNg : public NonCopyable, public NonMovable {
             logger_->debug("< %s: %s", kv.first.c_str(), kv.second.c_str());
         }
         logger_->debug("<");
+        auto encoding = response_.headers.find("Content-Encoding");
+        if (decoding_enabled_ && body_fn_ &&
+            encoding != response_.headers.end() &&
+            is_decodable_content_encoding(encoding->second)) {
+            logger_->debug("http: decoding %s body", encoding->second.c_str());
+            decoder_.reset(new ContentDecoder(encoding->second,
+                                              max_decompressed_size_));
+        }
         if (response_fn_) {
             response_fn_(response_);
         }
@@ -105,6 +133,16 @@ class ResponseParserNg : public NonCopyable, public NonMovable {
 
     int do_body_(const char *s, size_t n) {
         logger_->debug2("http: BODY");
+        if (decoder_) {
+            if (raw_body_fn_) {
+                raw_body_fn_(std::string(s, n));
+            }
+            // Note: we cannot throw here because we're called by C code
+            decoding_error_ = decoder_->feed(s, n, [this](std::string d) {
+                body_fn_(std::move(d));
+            });
+            return (decoding_error_) ? -1 : 0;
+        }
         if (body_fn_) {
             body_fn_(std::string(s, n));
         }
@@ -113,7 +151,10 @@ class ResponseParserNg : public NonCopyable, public NonMovable {
 
     int do_message_complete_() {
         logger_->debug2("http: END");
-        if (end_fn_) {
+        if (decoder_) {
+            decoding_error_ = decoder_->finish();
+        }
+        if (end_fn_ && !decoding_error_) {
             end_fn_();
         }
         // Rationale: we want to pause the parser after the first message
@@ -132,12 +173,21 @@ class ResponseParserNg : public NonCopyable, public NonMovable {
     Delegate<Response> response_fn_;
     Delegate<std::string> body_fn_;
     Delegate<> end_fn_;
+    Delegate<std::string> raw_body_fn_;
 
     SharedPtr<Logger> logger_ = Logger::global();
     http_parser parser_;
     http_parser_settings settings_;
     Buffer buffer_;
 
+    bool allow_pipelining_ = false;
+
+    // Variables used for decoding the body
+    bool decoding_enabled_ = false;
+    size_t max_decompressed_size_ = default_max_decompressed_size;
+    UniquePtr<ContentDecoder> decoder_;
+    Error decoding_error_;
+
     // Variables used during parsing
     Response response_;
     HeaderParserState prev_ = HeaderParserState::NOTHING;
@@ -172,8 +222,9 @@ class ResponseParserNg : public NonCopyable, public NonMovable {
     void parse() {
         size_t total = 0;
         buffer_.for_each([&](const void *p, size_t n) {
-            total += parser_execute(p, n);
-            return true;
+            size_t x = parser_execute(p, n);
+            total += x;
+            return x == n; // Not equal only if paused after a message
         });
         buffer_.discard(total);
     }
@@ -200,7 +251,13 @@ class ResponseParserNg : public NonCopyable, public NonMovable {
         //    throw UpgradeError();
         // }
         //
+        if (decoding_error_) {
+            throw decoding_error_;
+        }
         if (x != n) {
+            if (allow_pipelining_ && HTTP_PARSER_ERRNO(&parser_) == HPE_PAUSED) {
+                return x;
+            }
             throw ParserError(map_parser_error_());
         }
         return n;
@@ -272,12 +272,10 @@ inline void log_speed(SharedPtr<Logger> logger, std::string type, int num_stream
            << speed << " kbit/s " << "(num_streams " << num_streams << ")";
         logger->progress_relative(0.025, ss.str().c_str());
     }
-    logger->log(MK_LOG_EVENT | MK_LOG_INFO, R"xx({
-            "type": "%s",
-            "elapsed": [%lf, "s"],
-            "num_streams": %d,
-            "speed": [%lf, "kbit/s"]
-        })xx", type.c_str(), elapsed, num_streams, speed);
+    logger->emit_event(Json{{"type", type},
+                            {"elapsed", {elapsed, "s"}},
+                            {"num_streams", num_streams},
+                            {"speed", {speed, "kbit/s"}}});
 }
 
 } // namespace mk
@@ -9,6 +9,7 @@
 #error "MK_CA_BUNDLE is not set."
 #endif
 
+#include "src/libmeasurement_kit/common/deadline.hpp"
 #include "src/libmeasurement_kit/net/connect_impl.hpp"
 #include "src/libmeasurement_kit/net/emitter.hpp"
 #include "src/libmeasurement_kit/net/socks5.hpp"
@@ -72,9 +73,13 @@ void connect_first_of(SharedPtr<ConnectResult> result, int port,
         return;
     }
     double timeout = settings.get("net/timeout", 30.0);
+    result->timings.connect_attempts.push_back({});
+    result->timings.connect_attempts.back().start = mk::monotonic_time_now();
     connect_base(result->resolve_result.addresses[index], port,
                  timeout, reactor, logger,
                  [=](Error err, bufferevent *bev, double connect_time) {
+                     result->timings.connect_attempts.back().end =
+                           mk::monotonic_time_now();
                      errors->push_back(err);
                      if (err) {
                          logger->debug2("connect_first_of failure");
@@ -93,9 +98,11 @@ void connect_logic(std::string hostname, int port,
                    SharedPtr<Reactor> reactor, SharedPtr<Logger> logger) {
 
     SharedPtr<ConnectResult> result(new ConnectResult);
+    result->timings.dns_start = mk::monotonic_time_now();
     dns::resolve_hostname(hostname,
                      [=](dns::ResolveHostnameResult r) {
 
+                         result->timings.dns_end = mk::monotonic_time_now();
                          result->resolve_result = r;
                          if (result->resolve_result.addresses.size() <= 0) {
                              cb(DnsGenericError(), result);
@@ -174,11 +181,16 @@ void connect_ssl(bufferevent *orig_bev, ssl_st *ssl, std::string hostname,
                     return;
                 }
 
+                libssl::SessionCache::verified(ssl, logger);
                 logger->debug("ssl: handshake... complete");
                 cb(err, bev);
             }));
 }
 
+SslSessionCacheStats ssl_session_cache_stats() {
+    return libssl::SessionCache::global()->stats();
+}
+
 void connect_many(std::string address, int port, int num,
                   ConnectManyCb callback, Settings settings,
                   SharedPtr<Reactor> reactor, SharedPtr<Logger> logger) {
@@ -189,6 +201,28 @@ void connect_many(std::string address, int port, int num,
 void connect(std::string address, int port,
              Callback<Error, SharedPtr<Transport>> callback, Settings settings,
              SharedPtr<Reactor> reactor, SharedPtr<Logger> logger) {
+    if (has_deadline(settings)) {
+        if (deadline_expired(settings)) {
+            reactor->call_soon([=]() {
+                callback(DeadlineExceededError(),
+                         make_txp<Emitter>(0.0, nullptr, reactor, logger));
+            });
+            return;
+        }
+        settings["net/timeout"] = timeout_before_deadline(
+              settings, settings.get("net/timeout", 30.0));
+        // The timeout only bounds each I/O operation, so also bound the
+        // lifetime of the transport, such that a slow transfer cannot
+        // keep the measurement running after its deadline
+        Callback<Error, SharedPtr<Transport>> cb = callback;
+        callback = [=](Error err, SharedPtr<Transport> txp) {
+            SharedPtr<EmitterBase> emitter = txp.as<EmitterBase>();
+            if (!err && !!emitter) {
+                emitter->set_deadline(timeout_before_deadline(settings, -1.0));
+            }
+            cb(err, txp);
+        };
+    }
     if (settings.find("net/dumb_transport") != settings.end()) {
         callback(NoError(), make_txp<Emitter>(
             0.0, nullptr, reactor, logger));
@@ -237,9 +271,27 @@ void connect(std::string address, int port,
                     logger->info("Re-enabling SSLv2 and SSLv3");
                     libssl::enable_v23(*cssl);
                 }
+                ErrorOr<bool> session_cache =
+                    settings.get_noexcept("net/ssl_session_cache", true);
+                if (!session_cache) {
+                    Error err = ValueError();
+                    bufferevent_free(r->connected_bev);
+                    SSL_free(*cssl);
+                    callback(err, make_txp<Emitter>(
+                        timeout, r, reactor, logger));
+                    return;
+                }
+                if (*session_cache == true) {
+                    libssl::SessionCache::global()->resume(*cssl,
+                        libssl::SessionCache::make_key(cbp, address, port),
+                        logger);
+                }
+                r->timings.tls_handshake_start = mk::monotonic_time_now();
                 connect_ssl(r->connected_bev, *cssl, address,
                             [r, callback, timeout, reactor,
                              logger, settings](Error err, bufferevent *bev) {
+                                r->timings.tls_handshake_end =
+                                      mk::monotonic_time_now();
                                 if (err) {
                                     callback(err, make_txp<Emitter>(
                                             timeout, r, reactor, logger));
@@ -28,6 +28,7 @@ class ConnectResult {
     dns::ResolveHostnameResult resolve_result;
     std::vector<Error> connect_result;
     double connect_time = 0.0;
+    ConnectTimings timings;
     bufferevent *connected_bev = nullptr;
 };
 
@@ -160,6 +160,7 @@ static inline SharedPtr<Transport> make_txp(SharedPtr<Transport> txp, double tim
         txp->set_connect_time_(r->connect_time);
         txp->set_connect_errors_(r->connect_result);
         txp->set_dns_result_(r->resolve_result);
+        txp->set_connect_timings_(r->timings);
     }
     return txp;
 }
@@ -27,6 +27,9 @@ void EmitterBase::close(Callback<> cb) {
         throw std::runtime_error("close already pending");
     }
     close_pending = true;
+    if (deadline_timer) {
+        deadline_timer->cancel();
+    }
     shutdown();
     on_connect(nullptr);
     on_data(nullptr);
@@ -35,6 +38,14 @@ void EmitterBase::close(Callback<> cb) {
     close_cb = cb;
 }
 
+void EmitterBase::set_deadline(double timeout) {
+    // The timer is owned by us, hence it cannot outlive `this`
+    deadline_timer = Timer::make(reactor, timeout, [this]() {
+        logger->debug("emitter: deadline exceeded");
+        emit_error(DeadlineExceededError());
+    });
+}
+
 Emitter::~Emitter() {}
 
 } // namespace net
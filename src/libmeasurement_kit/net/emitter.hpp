@@ -5,6 +5,7 @@
 #define SRC_LIBMEASUREMENT_KIT_NET_EMITTER_HPP
 
 #include "src/libmeasurement_kit/common/delegate.hpp"
+#include "src/libmeasurement_kit/common/timer.hpp"
 #include <measurement_kit/net.hpp>
 #include <measurement_kit/dns.hpp>
 
@@ -230,9 +231,24 @@ class EmitterBase : public Transport {
         saved_dns_result = x;
     }
 
+    ConnectTimings connect_timings() override {
+        return saved_connect_timings;
+    }
+    void set_connect_timings_(ConnectTimings x) override {
+        saved_connect_timings = x;
+    }
+
     Endpoint sockname() override { return {}; }
     Endpoint peername() override { return {}; }
 
+    /*
+     * Deadline (see common/deadline.hpp)
+     */
+
+    // Emits DeadlineExceededError after `timeout` seconds, unless closed
+    // before, so that a slow transfer cannot outlive its measurement
+    void set_deadline(double timeout);
+
   protected:
     // TODO: it would probably better to have accessors
     SharedPtr<Reactor> reactor = Reactor::global();
@@ -253,6 +269,8 @@ class EmitterBase : public Transport {
     double saved_connect_time = 0.0;
     std::vector<Error> saved_connect_errors;
     dns::ResolveHostnameResult saved_dns_result;
+    ConnectTimings saved_connect_timings;
+    SharedPtr<Timer> deadline_timer;
 };
 
 class Emitter : public EmitterBase {
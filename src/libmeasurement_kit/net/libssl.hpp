@@ -20,14 +20,19 @@
 #include "src/libmeasurement_kit/ext/tls_internal.h"
 #include "src/libmeasurement_kit/net/builtin_ca_bundle.hpp"
 #include <cassert>
+#include <ctime>
 #include <map>
+#include <measurement_kit/common/enable_shared_from_this.hpp>
 #include <measurement_kit/common/logger.hpp>
 #include <measurement_kit/common/non_copyable.hpp>
 #include <measurement_kit/common/non_movable.hpp>
+#include <measurement_kit/net/connect.hpp>
 #include <measurement_kit/net/error.hpp>
+#include <mutex>
 #include <openssl/err.h>
 #include <openssl/ssl.h>
 #include <string>
+#include <sys/stat.h>
 
 namespace mk {
 namespace net {
@@ -48,6 +53,359 @@ static inline void libssl_init_once(SharedPtr<Logger> logger) {
     });
 }
 
+/*!
+    \brief Thread-safe cache of TLS sessions used to resume connections.
+
+    Sessions are indexed by CA bundle path, hostname and port, and the cache
+    holds at most one session per key (the most recent one) and at most
+    `max_size` sessions overall, evicting the least recently used one when
+    full. A session is used until it expires, i.e. until its own lifetime (as
+    set by the server, when using tickets) or `max_lifetime` seconds elapse,
+    whichever comes first.
+*/
+class SessionCache : public EnableSharedFromThis<SessionCache>,
+                     public NonCopyable,
+                     public NonMovable {
+  public:
+    /*
+        Implementation notes
+        --------------------
+
+        1. unlike `Cache` (below), this cache is shared by all threads
+        because the sessions we want to resume are typically the ones of the
+        connections to the collector, bouncer and test helpers, which are
+        run from many threads. For this reason, it is protected by a mutex.
+        `SSL_SESSION *` reference counting is thread safe.
+
+        2. we only save sessions after we have verified the peer, so that we
+        never resume a session with a peer we did not verify. To this end,
+        resume() attaches to the `SSL *` the key and the cache to use and
+        verified() marks the connection as verified and saves its session.
+
+        3. with TLS v1.3, the session tickets are sent after the handshake,
+        so we also save sessions using the new session callback of the
+        `SSL_CTX *`, set by `Context::make()`.
+    */
+
+    /// Constructor. The cache MUST be owned by a `SharedPtr`.
+    explicit SessionCache(size_t max_size = 128, long max_lifetime = 3600)
+        : max_size_{max_size}, max_lifetime_{max_lifetime} {}
+
+    /// Destructor.
+    ~SessionCache() {
+        for (auto &kv : all_) {
+            SSL_SESSION_free(kv.second.session);
+        }
+    }
+
+    /// Return the cache shared by all threads.
+    static SharedPtr<SessionCache> global() {
+        static SharedPtr<SessionCache> instance{new SessionCache};
+        return instance;
+    }
+
+    /// Return the key used to index sessions.
+    static std::string make_key(std::string ca_bundle_path,
+            std::string hostname, int port) {
+        return ca_bundle_path + " " + hostname + " " + std::to_string(port);
+    }
+
+    /// Return a new reference to the session saved for `key`, or nullptr.
+    SSL_SESSION *get(const std::string &key) {
+        std::lock_guard<std::mutex> guard{mutex_};
+        stats_.lookups += 1;
+        auto it = all_.find(key);
+        if (it == all_.end()) {
+            return nullptr;
+        }
+        SSL_SESSION *session = it->second.session;
+        long lifetime = SSL_SESSION_get_timeout(session);
+        if (lifetime > max_lifetime_) {
+            lifetime = max_lifetime_;
+        }
+        if (time(nullptr) >= SSL_SESSION_get_time(session) + lifetime) {
+            SSL_SESSION_free(session);
+            all_.erase(it);
+            stats_.expired += 1;
+            return nullptr;
+        }
+        it->second.last_used = ++clock_;
+        stats_.hits += 1;
+        SSL_SESSION_up_ref(session);
+        return session;
+    }
+
+    /// Save a new reference to `session` for `key`.
+    void put(const std::string &key, SSL_SESSION *session) {
+        std::lock_guard<std::mutex> guard{mutex_};
+        auto it = all_.find(key);
+        if (it != all_.end()) {
+            SSL_SESSION_free(it->second.session);
+            all_.erase(it);
+        } else if (all_.size() >= max_size_ && !all_.empty()) {
+            auto lru = all_.begin();
+            for (auto cur = all_.begin(); cur != all_.end(); ++cur) {
+                if (cur->second.last_used < lru->second.last_used) {
+                    lru = cur;
+                }
+            }
+            SSL_SESSION_free(lru->second.session);
+            all_.erase(lru);
+            stats_.evicted += 1;
+        }
+        SSL_SESSION_up_ref(session);
+        all_[key] = Entry{session, ++clock_};
+        stats_.stored += 1;
+    }
+
+    /*!
+        \brief Prepare `ssl` for resuming the session saved for `key`.
+
+        Also arrange for the session of `ssl` to be saved for `key` once
+        verified() has been called. This is a no-op if you don't call it.
+    */
+    void resume(SSL *ssl, std::string key, SharedPtr<Logger> logger) {
+        SSL_set_ex_data(ssl, ex_data_index(),
+                        new ExData{shared_from_this(), key, false});
+        SSL_SESSION *session = get(key);
+        if (session != nullptr) {
+            logger->debug("ssl: attempting to resume session");
+            SSL_set_session(ssl, session);
+            SSL_SESSION_free(session);
+        }
+    }
+
+    /// Tell the cache that the peer of `ssl` was verified.
+    static void verified(SSL *ssl, SharedPtr<Logger> logger) {
+        auto ex_data = (ExData *)SSL_get_ex_data(ssl, ex_data_index());
+        if (ex_data == nullptr) {
+            return; // Session cache not enabled for this connection
+        }
+        ex_data->verified = true;
+        if (SSL_session_reused(ssl)) {
+            logger->debug("ssl: session resumed");
+            std::lock_guard<std::mutex> guard{ex_data->cache->mutex_};
+            ex_data->cache->stats_.resumed += 1;
+        }
+        SSL_SESSION *session = SSL_get1_session(ssl);
+        if (session != nullptr) {
+            ex_data->cache->maybe_put_(ex_data->key, session);
+            SSL_SESSION_free(session);
+        }
+    }
+
+    /// New session callback to be installed in a `SSL_CTX *`.
+    static int on_new_session(SSL *ssl, SSL_SESSION *session) {
+        auto ex_data = (ExData *)SSL_get_ex_data(ssl, ex_data_index());
+        if (ex_data != nullptr && ex_data->verified) {
+            ex_data->cache->maybe_put_(ex_data->key, session);
+        }
+        return 0; // We did not take ownership of `session`
+    }
+
+    /// Return the statistics of this cache.
+    SslSessionCacheStats stats() {
+        std::lock_guard<std::mutex> guard{mutex_};
+        return stats_;
+    }
+
+    /// Return number of cached sessions.
+    size_t size() {
+        std::lock_guard<std::mutex> guard{mutex_};
+        return all_.size();
+    }
+
+  private:
+    class Entry {
+      public:
+        SSL_SESSION *session = nullptr;
+        unsigned long long last_used = 0;
+    };
+
+    class ExData {
+      public:
+        SharedPtr<SessionCache> cache;
+        std::string key;
+        bool verified = false;
+    };
+
+    static void free_ex_data_(void *, void *ptr, CRYPTO_EX_DATA *, int, long,
+            void *) {
+        delete (ExData *)ptr;
+    }
+
+    static int ex_data_index() {
+        static int index = SSL_get_ex_new_index(
+              0, nullptr, nullptr, nullptr, free_ex_data_);
+        return index;
+    }
+
+    void maybe_put_(const std::string &key, SSL_SESSION *session) {
+#if (!defined LIBRESSL_VERSION_NUMBER && OPENSSL_VERSION_NUMBER >= 0x10101000L)
+        if (!SSL_SESSION_is_resumable(session)) {
+            return; // E.g., with TLS v1.3 before the ticket is received
+        }
+#endif
+        put(key, session);
+    }
+
+    std::map<std::string, Entry> all_;
+    unsigned long long clock_ = 0;
+    size_t max_size_;
+    long max_lifetime_;
+    std::mutex mutex_;
+    SslSessionCacheStats stats_;
+};
+
+/*!
+    \brief Immutable, reference counted, set of trusted CA certificates.
+
+    This class wraps a `X509_STORE *` that is filled once, when the object is
+    created, and then only read by OpenSSL when verifying peers. The same
+    store is attached to all the `SSL_CTX *` using the same CA bundle, so we
+    parse the CA bundle once per process rather than once per thread.
+*/
+class TrustStore : public NonCopyable, public NonMovable {
+  public:
+    /*
+        Implementation notes
+        --------------------
+
+        1. the concerns about OpenSSL in a MT environment expressed below for
+        `Context` and `Cache` are about mutable objects. Instead, after make()
+        returns, nobody modifies the `X509_STORE *`, which is only read while
+        verifying certificates. OpenSSL >= 1.1.0 protects the store's internal
+        lookup cache and its reference count with its own lock (and the
+        reference count is also atomic), and we never use the store's lookup
+        methods that load files lazily, since all certificates are loaded when
+        the store is created. So, sharing the store among the `SSL_CTX *` of
+        different threads is safe, while each thread keeps its own `SSL_CTX *`.
+
+        2. shared() keeps a process-wide cache indexed by CA bundle path and,
+        for files, by their modification time and size, so that a bundle
+        that is updated on disk is parsed again. Because the cache is static
+        inside a function template, there is a distinct cache for each set of
+        mocks, which prevents tests from interfering with each other.
+
+        3. to reuse the loading code of OpenSSL (and the mocks), we load
+        the certificates into a temporary `SSL_CTX *` and then we steal its
+        `X509_STORE *` by incrementing its reference count.
+    */
+
+    /// Attach this store to `ctx`, which will keep a reference to it.
+    void attach(SSL_CTX *ctx) {
+        X509_STORE_up_ref(store_);
+        SSL_CTX_set_cert_store(ctx, store_);
+    }
+
+    /// Destructor.
+    ~TrustStore() {
+        assert(store_ != nullptr);
+        X509_STORE_free(store_);
+    }
+
+    /*!
+        \brief Factory that parses the CA bundle into a new store.
+
+        \param ca_bundle_path Path to the CA bundle. If it is empty and we're
+        linking with libressl, we will use the builtin CA bundle that is
+        shipped along with measurement-kit. Otherwise, we will fail.
+
+        \param logger Logger for printing log messages.
+
+        \return An error on failure or the store on success.
+    */
+    template <MK_MOCK(SSL_CTX_new), MK_MOCK(SSL_CTX_load_verify_locations)
+#if (defined LIBRESSL_VERSION_NUMBER && LIBRESSL_VERSION_NUMBER >= 0x2010400fL)
+                                            ,
+            MK_MOCK(SSL_CTX_load_verify_mem)
+#endif
+            >
+    static ErrorOr<SharedPtr<TrustStore>> make(
+            std::string ca_bundle_path, SharedPtr<Logger> logger) {
+        logger->debug("ssl: parsing CA bundle: '%s'", ca_bundle_path.c_str());
+        SSL_CTX *ctx = SSL_CTX_new(SSLv23_client_method());
+        if (ctx == nullptr) {
+            logger->warn("ssl: failed to create SSL_CTX");
+            return {SslCtxNewError(), {}};
+        }
+        if (ca_bundle_path != "") {
+            if (!SSL_CTX_load_verify_locations(
+                        ctx, ca_bundle_path.c_str(), nullptr)) {
+                logger->warn("ssl: failed to load verify location");
+                SSL_CTX_free(ctx);
+                return {SslCtxLoadVerifyLocationsError(), {}};
+            }
+        } else {
+#if (defined LIBRESSL_VERSION_NUMBER &&                                        \
+        LIBRESSL_VERSION_NUMBER >= 0x2010400fL && !defined _MSC_VER)
+            // Note: we disable the CA bundle on Windows where the compiler
+            // fails with internal error when compiling the builtin vector that
+            // contains the bytes of the CA file.
+            std::vector<uint8_t> bundle = builtin_ca_bundle();
+            logger->debug("ssl: using builtin libressl's ca bundle");
+            if (!SSL_CTX_load_verify_mem(ctx, bundle.data(), bundle.size())) {
+                logger->warn("ssl: failed to load default ca bundle");
+                SSL_CTX_free(ctx);
+                return {SslCtxLoadVerifyMemError(), {}};
+            }
+#else
+            SSL_CTX_free(ctx);
+            return {MissingCaBundlePathError(), {}};
+#endif
+        }
+        SharedPtr<TrustStore> store{new TrustStore};
+        store->store_ = SSL_CTX_get_cert_store(ctx);
+        X509_STORE_up_ref(store->store_);
+        SSL_CTX_free(ctx);
+        return {NoError(), store};
+    }
+
+    /// Like make() but return the store already parsed by this process
+    /// for `ca_bundle_path`, if any and if the file did not change.
+    template <MK_MOCK(SSL_CTX_new), MK_MOCK(SSL_CTX_load_verify_locations)
+#if (defined LIBRESSL_VERSION_NUMBER && LIBRESSL_VERSION_NUMBER >= 0x2010400fL)
+                                            ,
+            MK_MOCK(SSL_CTX_load_verify_mem)
+#endif
+            >
+    static ErrorOr<SharedPtr<TrustStore>> shared(
+            std::string ca_bundle_path, SharedPtr<Logger> logger) {
+        static std::mutex mutex;
+        static std::map<std::string, SharedPtr<TrustStore>> all;
+        std::string version;
+        struct stat sb = {};
+        if (ca_bundle_path != "" && stat(ca_bundle_path.c_str(), &sb) == 0) {
+            version = std::to_string((long long)sb.st_mtime) + " " +
+                      std::to_string((long long)sb.st_size);
+        }
+        // Note: the lock is held while parsing such that, when many threads
+        // start at the same time, only one of them parses the bundle.
+        std::lock_guard<std::mutex> guard{mutex};
+        auto it = all.find(ca_bundle_path);
+        if (it != all.end() && it->second->version_ == version) {
+            return {NoError(), it->second};
+        }
+        ErrorOr<SharedPtr<TrustStore>> store =
+                make<SSL_CTX_new, SSL_CTX_load_verify_locations
+#if (defined LIBRESSL_VERSION_NUMBER && LIBRESSL_VERSION_NUMBER >= 0x2010400fL)
+                     ,
+                     SSL_CTX_load_verify_mem
+#endif
+                     >(ca_bundle_path, logger);
+        if (!!store) {
+            (*store)->version_ = version;
+            all[ca_bundle_path] = *store;
+        }
+        return store;
+    }
+
+  private:
+    TrustStore() {}
+    X509_STORE *store_ = nullptr;
+    std::string version_;
+};
+
 /*!
     \brief Wrapper for SSL context (`SSL_CTX *`).
 
@@ -153,32 +511,23 @@ class Context : public NonCopyable, public NonMovable {
          * [1] https://wiki.openssl.org/index.php/Manual:SSL_CTX_new(3)
          */
         SSL_CTX_set_options(ctx, SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3);
-        if (ca_bundle_path != "") {
-            if (!SSL_CTX_load_verify_locations(
-                        ctx, ca_bundle_path.c_str(), nullptr)) {
-                logger->warn("ssl: failed to load verify location");
-                SSL_CTX_free(ctx);
-                return {SslCtxLoadVerifyLocationsError(), {}};
-            }
-        } else {
-#if (defined LIBRESSL_VERSION_NUMBER &&                                        \
-        LIBRESSL_VERSION_NUMBER >= 0x2010400fL && !defined _MSC_VER)
-            // Note: we disable the CA bundle on Windows where the compiler
-            // fails with internal error when compiling the builtin vector that
-            // contains the bytes of the CA file.
-            std::vector<uint8_t> bundle = builtin_ca_bundle();
-            logger->debug("ssl: using builtin libressl's ca bundle");
-            if (!SSL_CTX_load_verify_mem(ctx, bundle.data(), bundle.size())) {
-                logger->warn("ssl: failed to load default ca bundle");
-                SSL_CTX_free(ctx);
-                return {SslCtxLoadVerifyMemError(), {}};
-            }
-#else
-            SSL_CTX_free(ctx);
-            return {MissingCaBundlePathError(), {}};
+        ErrorOr<SharedPtr<TrustStore>> store =
+                TrustStore::shared<SSL_CTX_new, SSL_CTX_load_verify_locations
+#if (defined LIBRESSL_VERSION_NUMBER && LIBRESSL_VERSION_NUMBER >= 0x2010400fL)
+                                   ,
+                                   SSL_CTX_load_verify_mem
 #endif
+                                   >(ca_bundle_path, logger);
+        if (!store) {
+            SSL_CTX_free(ctx);
+            return {store.as_error(), {}};
         }
+        (*store)->attach(ctx);
         SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, nullptr);
+        // Sessions are saved by SessionCache, not by the SSL_CTX
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT |
+                SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(ctx, SessionCache::on_new_session);
         SharedPtr<Context> context{new Context};
         context->ctx_ = ctx;
         return {NoError(), context};
@@ -221,6 +570,10 @@ template <size_t max_cache_size = 64> class Cache {
         Overall, this choice is a bit more defensive than needed, perhaps, but
         I do also see some advantages in not keeping `SSL_CTX *` - and hence
         all related caching - alive "forever". So I think it's okay.
+
+        3. creating a `SSL_CTX *` per thread is cheap because the expensive
+        part, i.e. parsing the CA bundle, is done once per process by the
+        `TrustStore` (see above), whose store is shared by all contexts.
     */
 
     /// Return thread local instance of the cache.
@@ -0,0 +1,94 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/nettests/checkpoint.hpp"
+
+#include "src/libmeasurement_kit/common/json_writer.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace mk {
+namespace nettests {
+
+void Checkpoint::mark_done(uint64_t index) {
+    if (index < done_below) {
+        return;
+    }
+    done.insert(index);
+    // Keep the set small by moving its contiguous prefix into `done_below`
+    auto it = done.begin();
+    while (it != done.end() && *it == done_below) {
+        it = done.erase(it);
+        done_below += 1;
+    }
+}
+
+bool Checkpoint::is_done(uint64_t index) const {
+    return index < done_below || done.count(index) != 0;
+}
+
+Error Checkpoint::save(const std::string &path,
+                       SharedPtr<Logger> logger) const {
+    Json json{{"output_filepath", output_filepath},
+              {"report_offset", report_offset},
+              {"report_id", report_id},
+              {"randomized", randomized},
+              // As a string, because not all JSON parsers handle 64 bits
+              {"seed", std::to_string(seed)},
+              {"done_below", done_below},
+              {"done", done}};
+    // Write a temporary file and then atomically replace the old one, so
+    // that a crash never leaves us with a truncated checkpoint
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream temp(temp_path, std::ios::trunc);
+        OstreamSink sink{temp};
+        Error err = write_json(json, sink);
+        temp.flush();
+        if (err || !temp.good()) {
+            logger->warn("checkpoint: cannot write '%s'", temp_path.c_str());
+            return FileIoError();
+        }
+    }
+    if (::rename(temp_path.c_str(), path.c_str()) != 0) {
+        logger->warn("checkpoint: cannot replace '%s': %s", path.c_str(),
+                     strerror(errno));
+        return FileIoError();
+    }
+    return NoError();
+}
+
+/* static */ ErrorOr<Checkpoint>
+Checkpoint::load(const std::string &path, SharedPtr<Logger> logger) {
+    std::ifstream file(path);
+    if (!file.good()) {
+        return {FileIoError(), {}};
+    }
+    std::stringstream ss;
+    ss << file.rdbuf();
+    Checkpoint checkpoint;
+    try {
+        Json json = Json::parse(ss.str());
+        checkpoint.output_filepath =
+              json.at("output_filepath").get<std::string>();
+        checkpoint.report_offset = json.at("report_offset").get<uint64_t>();
+        checkpoint.report_id = json.at("report_id").get<std::string>();
+        checkpoint.randomized = json.at("randomized").get<bool>();
+        checkpoint.seed = std::stoull(json.at("seed").get<std::string>());
+        checkpoint.done_below = json.at("done_below").get<uint64_t>();
+        checkpoint.done = json.at("done").get<std::set<uint64_t>>();
+    } catch (const std::exception &exc) {
+        logger->warn("checkpoint: cannot parse '%s': %s", path.c_str(),
+                     exc.what());
+        return {JsonParseError(), {}};
+    }
+    return {NoError(), checkpoint};
+}
+
+} // namespace nettests
+} // namespace mk
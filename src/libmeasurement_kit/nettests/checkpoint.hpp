@@ -0,0 +1,47 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+#ifndef SRC_LIBMEASUREMENT_KIT_NETTESTS_CHECKPOINT_HPP
+#define SRC_LIBMEASUREMENT_KIT_NETTESTS_CHECKPOINT_HPP
+
+#include <measurement_kit/common.hpp>
+
+#include <set>
+
+namespace mk {
+namespace nettests {
+
+// Progress of a test, saved from time to time when `checkpoint_filepath`
+// is set, such that a test that was killed can be resumed (see `resume`).
+//
+// Inputs are identified by their index in the input source. Since inputs
+// are shuffled within a window, the inputs that are done are represented
+// as all the inputs below `done_below` plus the set of the other ones.
+//
+// A checkpoint is always consistent with the report file: the inputs that
+// are done are exactly the ones whose entries are in the first
+// `report_offset` bytes of `output_filepath`.
+class Checkpoint {
+  public:
+    std::string output_filepath;
+    uint64_t report_offset = 0;
+    std::string report_id;
+    bool randomized = false;
+    uint64_t seed = 0;
+    uint64_t done_below = 0;
+    std::set<uint64_t> done;
+
+    void mark_done(uint64_t index);
+    bool is_done(uint64_t index) const;
+
+    // Atomically replaces the file at `path`
+    Error save(const std::string &path, SharedPtr<Logger> logger) const;
+
+    // Fails with FileIoError if `path` cannot be read
+    static ErrorOr<Checkpoint> load(const std::string &path,
+                                    SharedPtr<Logger> logger);
+};
+
+} // namespace nettests
+} // namespace mk
+#endif
@@ -0,0 +1,108 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/nettests/host_scheduler.hpp"
+
+#include <measurement_kit/http.hpp>
+
+#include <algorithm>
+#include <cctype>
+
+namespace mk {
+namespace nettests {
+
+HostScheduler::HostScheduler(SharedPtr<InputSource> source, size_t per_host,
+                             size_t lookahead)
+    : source_{source}, per_host_{std::max<size_t>(1, per_host)},
+      lookahead_{std::max<size_t>(1, lookahead)} {}
+
+/* static */ ErrorOr<SharedPtr<HostScheduler>>
+HostScheduler::make(SharedPtr<InputSource> source, const Settings &options,
+                    SharedPtr<Logger> logger) {
+    ErrorOr<size_t> per_host =
+          options.get_noexcept<size_t>("max_parallelism_per_host", 1);
+    ErrorOr<size_t> lookahead =
+          options.get_noexcept<size_t>("input_host_lookahead", 1024);
+    if (!per_host || *per_host <= 0 || !lookahead || *lookahead <= 0) {
+        logger->warn("invalid 'max_parallelism_per_host' or "
+                     "'input_host_lookahead' option");
+        return {ValueError(), {}};
+    }
+    return {NoError(), SharedPtr<HostScheduler>{
+                             new HostScheduler{source, *per_host,
+                                               *lookahead}}};
+}
+
+/* static */ std::string HostScheduler::host_of(const std::string &input) {
+    std::string host = input;
+    ErrorOr<http::Url> url = http::parse_url_noexcept(input);
+    if (!!url) {
+        host = url->address;
+    } else if (std::count(input.begin(), input.end(), ':') == 1) {
+        host = input.substr(0, input.find(':')); // Strip the port
+    }
+    for (auto &c : host) {
+        c = (char)std::tolower((unsigned char)c);
+    }
+    return host;
+}
+
+void HostScheduler::fill_() {
+    std::string input;
+    uint64_t index = 0;
+    while (!eof_ && buffered_ < lookahead_) {
+        if (!source_->next(input, index)) {
+            eof_ = true;
+            break;
+        }
+        std::string host = host_of(input);
+        Bucket &bucket = buckets_[host];
+        if (bucket.inputs.size() <= 0) {
+            order_.push_back(host);
+        }
+        bucket.inputs.push_back({index, std::move(input)});
+        buffered_ += 1;
+    }
+}
+
+bool HostScheduler::next(std::string &input, uint64_t &index, bool &wait) {
+    fill_();
+    wait = false;
+    for (auto it = order_.begin(); it != order_.end(); ++it) {
+        Bucket &bucket = buckets_[*it];
+        if (bucket.active >= per_host_) {
+            continue;
+        }
+        index = bucket.inputs.front().first;
+        input = std::move(bucket.inputs.front().second);
+        bucket.inputs.pop_front();
+        bucket.active += 1;
+        buffered_ -= 1;
+        if (bucket.inputs.size() <= 0) {
+            order_.erase(it);
+        }
+        return true;
+    }
+    wait = (buffered_ > 0);
+    return false;
+}
+
+void HostScheduler::done(const std::string &input) {
+    std::string host = host_of(input);
+    auto it = buckets_.find(host);
+    if (it == buckets_.end() || it->second.active <= 0) {
+        return; // Not an input returned by us
+    }
+    it->second.active -= 1;
+    if (it->second.inputs.size() > 0) {
+        // Serve it next, while its TLS sessions etc. are warm
+        order_.remove(host);
+        order_.push_front(host);
+    } else if (it->second.active <= 0) {
+        buckets_.erase(it);
+    }
+}
+
+} // namespace nettests
+} // namespace mk
@@ -0,0 +1,69 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+#ifndef SRC_LIBMEASUREMENT_KIT_NETTESTS_HOST_SCHEDULER_HPP
+#define SRC_LIBMEASUREMENT_KIT_NETTESTS_HOST_SCHEDULER_HPP
+
+#include "src/libmeasurement_kit/nettests/input_source.hpp"
+
+#include <deque>
+#include <list>
+#include <map>
+
+namespace mk {
+namespace nettests {
+
+// Reorders the input of a test such that the inputs with the same host are
+// measured one after the other, and thus can reuse the TLS sessions (and
+// whatever else is cached per host) of the previous measurements.
+//
+// Up to `lookahead` inputs are read from the InputSource and bucketed by
+// host. Hosts are served in the order in which they first appear in the
+// (possibly shuffled) input, except that a host whose measurement just
+// finished is served next, while it is warm. No more than `per_host`
+// measurements of the same host run at the same time, so that a host with
+// many inputs is not hammered, and other hosts are served in the meantime.
+class HostScheduler : public NonCopyable, public NonMovable {
+  public:
+    HostScheduler(SharedPtr<InputSource> source, size_t per_host,
+                  size_t lookahead);
+
+    // Reads `per_host` and `lookahead` from the "max_parallelism_per_host"
+    // and "input_host_lookahead" options; returns ValueError if invalid
+    static ErrorOr<SharedPtr<HostScheduler>>
+    make(SharedPtr<InputSource> source, const Settings &options,
+         SharedPtr<Logger> logger);
+
+    // Returns false if there is no input available. In such case, `wait`
+    // is true if there is more input, but all its hosts are busy, such
+    // that the caller should retry after calling done().
+    bool next(std::string &input, uint64_t &index, bool &wait);
+
+    // Must be called when the measurement of `input` is complete
+    void done(const std::string &input);
+
+    // Host name of `input`, which is either an URL or an endpoint (e.g.
+    // "example.com:80"), or a domain name, in lowercase
+    static std::string host_of(const std::string &input);
+
+  private:
+    class Bucket {
+      public:
+        std::deque<std::pair<uint64_t, std::string>> inputs;
+        size_t active = 0;
+    };
+
+    void fill_();
+
+    SharedPtr<InputSource> source_;
+    size_t per_host_ = 1;
+    size_t lookahead_ = 1;
+    size_t buffered_ = 0;
+    bool eof_ = false;
+    std::map<std::string, Bucket> buckets_;
+    std::list<std::string> order_; // Hosts with buffered input
+};
+
+} // namespace nettests
+} // namespace mk
+#endif
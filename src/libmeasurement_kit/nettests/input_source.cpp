@@ -0,0 +1,190 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/nettests/input_source.hpp"
+
+#include <measurement_kit/ooni.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <regex>
+
+#include <sys/stat.h>
+
+namespace mk {
+namespace nettests {
+
+/* static */ ErrorOr<SharedPtr<InputSource>>
+InputSource::open(std::deque<std::string> inputs, bool needs_input,
+                  const std::list<std::string> &input_filepaths,
+                  const std::string &probe_cc, const Settings &options,
+                  SharedPtr<Logger> logger,
+                  std::function<bool(uint64_t)> skip) {
+    SharedPtr<InputSource> source{new InputSource};
+    source->logger_ = logger;
+    source->skip_ = skip;
+    if (!needs_input) {
+        // Add empty string to call main just once. Due to the way in which
+        // we work, we clear the input if it's not empty, otherwise input-less
+        // tests are going to run more than once.
+        if (inputs.size() != 0) {
+            logger->warn("Manually passed input for a test that requires no "
+                         "input; fixing by clearing the input vector");
+        }
+        source->total_bytes_ = 1;
+        source->push_("");
+        return {NoError(), source};
+    }
+    if (input_filepaths.size() <= 0 && inputs.size() == 0) {
+        logger->warn("at least an input file is required");
+        return {ooni::MissingRequiredInputFileError(), {}};
+    }
+
+    ErrorOr<bool> shuffle = options.get_noexcept<bool>("randomize_input", true);
+    if (!shuffle) {
+        logger->warn("invalid 'randomize_input' option");
+        return {shuffle.as_error(), {}};
+    }
+    if (*shuffle) {
+        ErrorOr<size_t> window_size =
+              options.get_noexcept<size_t>("input_shuffle_window", 65536);
+        if (!window_size || *window_size <= 0) {
+            logger->warn("invalid 'input_shuffle_window' option");
+            return {ValueError(), {}};
+        }
+        std::random_device rd;
+        uint64_t seed = ((uint64_t)rd() << 32) | rd();
+        if (options.find("input_shuffle_seed") != options.end()) {
+            ErrorOr<uint64_t> maybe_seed =
+                  options.get_noexcept<uint64_t>("input_shuffle_seed", 0);
+            if (!maybe_seed) {
+                logger->warn("invalid 'input_shuffle_seed' option");
+                return {maybe_seed.as_error(), {}};
+            }
+            seed = *maybe_seed;
+        }
+        source->randomized_ = true;
+        source->window_size_ = *window_size;
+        source->seed_ = seed;
+        source->generator_.seed(seed);
+    }
+
+    for (auto &input : inputs) {
+        source->total_bytes_ += input.size() + 1;
+    }
+    source->manual_ = std::move(inputs);
+
+    /*
+     * Note: in general the snippet below is not
+     * so good because it does not work for UTF-8
+     * and the like but here we are converting
+     * country codes which are always ASCII.
+     */
+    std::string probe_cc_lowercase = "";
+    for (auto c : probe_cc) {
+        probe_cc_lowercase += std::tolower(c);
+    }
+    for (auto input_filepath : input_filepaths) {
+        input_filepath = std::regex_replace(input_filepath,
+                                            std::regex{R"(\$\{probe_cc\})"},
+                                            probe_cc_lowercase);
+        // The size is only used to estimate the progress
+        struct stat sb{};
+        if (stat(input_filepath.c_str(), &sb) == 0) {
+            source->total_bytes_ += (uint64_t)sb.st_size;
+        }
+        source->filepaths_.push_back(input_filepath);
+    }
+
+    source->fill_();
+    if (source->window_.size() <= 0 && source->skipped_ <= 0) {
+        logger->warn("no specified input file could be read");
+        return {ooni::CannotReadAnyInputFileError(), {}};
+    }
+    return {NoError(), source};
+}
+
+bool InputSource::next(std::string &input, uint64_t &index) {
+    fill_();
+    if (window_.size() <= 0) {
+        return false;
+    }
+    if (randomized_) {
+        std::uniform_int_distribution<size_t> dist{0, window_.size() - 1};
+        std::swap(window_[dist(generator_)], window_.back());
+        index = window_.back().first;
+        input = std::move(window_.back().second);
+        window_.pop_back();
+    } else {
+        index = window_.front().first;
+        input = std::move(window_.front().second);
+        window_.pop_front();
+    }
+    returned_bytes_ += input.size() + 1;
+    return true;
+}
+
+bool InputSource::next(std::string &input) {
+    uint64_t index = 0;
+    return next(input, index);
+}
+
+double InputSource::progress() const {
+    if (total_bytes_ <= 0) {
+        return 0.0;
+    }
+    return std::min(1.0, returned_bytes_ / (double)total_bytes_);
+}
+
+void InputSource::fill_() {
+    std::string input;
+    while (window_.size() < window_size_ && read_(input)) {
+        push_(std::move(input));
+    }
+}
+
+void InputSource::push_(std::string input) {
+    uint64_t index = read_count_++;
+    if (skip_ && skip_(index)) {
+        // Account for it, such that the progress is still correct
+        returned_bytes_ += input.size() + 1;
+        skipped_ += 1;
+        return;
+    }
+    window_.push_back({index, std::move(input)});
+}
+
+bool InputSource::read_(std::string &input) {
+    if (manual_.size() > 0) {
+        input = std::move(manual_.front());
+        manual_.pop_front();
+        return true;
+    }
+    for (;;) {
+        if (file_) {
+            if (std::getline(*file_, input)) {
+                return true;
+            }
+            if (!file_->eof()) {
+                logger_->warn("I/O error reading input file: %s",
+                              filepath_.c_str());
+            }
+            file_ = {};
+        }
+        if (filepaths_.size() <= 0) {
+            return false;
+        }
+        filepath_ = filepaths_.front();
+        filepaths_.pop_front();
+        SharedPtr<std::istream> file{new std::ifstream{filepath_}};
+        if (!file->good()) {
+            logger_->warn("cannot open input file: %s", filepath_.c_str());
+            continue;
+        }
+        file_ = file;
+    }
+}
+
+} // namespace nettests
+} // namespace mk
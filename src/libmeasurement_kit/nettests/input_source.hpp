@@ -0,0 +1,80 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+#ifndef SRC_LIBMEASUREMENT_KIT_NETTESTS_INPUT_SOURCE_HPP
+#define SRC_LIBMEASUREMENT_KIT_NETTESTS_INPUT_SOURCE_HPP
+
+#include <measurement_kit/common.hpp>
+
+#include <deque>
+#include <functional>
+#include <istream>
+#include <list>
+#include <random>
+
+namespace mk {
+namespace nettests {
+
+// Streams the input of a test: first the input added manually, then the
+// lines of the input files, which are read only when the measurements need
+// more input, so that memory usage does not depend on the input size.
+//
+// If the "randomize_input" option is true (the default), each input is
+// drawn at random from a window containing the next "input_shuffle_window"
+// inputs, which is refilled as input is drawn. If the whole input fits
+// into the window, the result is a uniform random permutation. The random
+// generator is seeded with "input_shuffle_seed", if set, and otherwise
+// with a random seed, such that a run can be reproduced given its seed.
+//
+// Each input is identified by its index in the above order, before being
+// shuffled, and the inputs for which `skip` returns true are not returned.
+class InputSource : public NonCopyable, public NonMovable {
+  public:
+    // Returns the same errors of process_input_filepaths() (see utils.hpp),
+    // except that having skipped all the inputs is not an error
+    static ErrorOr<SharedPtr<InputSource>>
+    open(std::deque<std::string> inputs, bool needs_input,
+         const std::list<std::string> &input_filepaths,
+         const std::string &probe_cc, const Settings &options,
+         SharedPtr<Logger> logger,
+         std::function<bool(uint64_t)> skip = nullptr);
+
+    // Returns false when there is no more input
+    bool next(std::string &input, uint64_t &index);
+    bool next(std::string &input);
+
+    // Fraction of the input bytes returned so far
+    double progress() const;
+
+    bool randomized() const { return randomized_; }
+    uint64_t seed() const { return seed_; }
+
+  private:
+    InputSource() {}
+
+    bool read_(std::string &input);
+    void fill_();
+    void push_(std::string input);
+
+    std::deque<std::string> manual_;
+    std::list<std::string> filepaths_; // Still to be opened
+    SharedPtr<std::istream> file_;     // Being read, or null
+    std::string filepath_;
+    SharedPtr<Logger> logger_;
+
+    std::function<bool(uint64_t)> skip_;
+    uint64_t read_count_ = 0;
+    uint64_t skipped_ = 0;
+    std::deque<std::pair<uint64_t, std::string>> window_;
+    size_t window_size_ = 1;
+    bool randomized_ = false;
+    uint64_t seed_ = 0;
+    std::mt19937_64 generator_;
+
+    uint64_t total_bytes_ = 0;
+    uint64_t returned_bytes_ = 0;
+};
+
+} // namespace nettests
+} // namespace mk
+#endif
@@ -0,0 +1,148 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/nettests/parallelism.hpp"
+
+#include <measurement_kit/net.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace mk {
+namespace nettests {
+
+// Weight of the last measurement in the moving averages
+static const double alpha = 0.125;
+
+// Number of successful measurements before we trust the lowest latency
+static const uint64_t latency_warmup = 8;
+
+// File descriptors not available to measurements (report, logs, the
+// reactor, the input file, the connection with the collector, ...)
+static const uint64_t fd_reserve = 64;
+
+const size_t ParallelismController::sockets_per_measurement;
+
+static bool is_congestion(const std::string &failure) {
+    return failure == TimeoutError().reason ||
+           failure == DeadlineExceededError().reason ||
+           failure == net::TimedOutError().reason ||
+           failure == net::TooManyFilesOpenError().reason ||
+           failure == net::TooManyFilesOpenInSystemError().reason;
+}
+
+/* static */ size_t ParallelismController::socket_limit() {
+#ifndef _WIN32
+    struct rlimit rl{};
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY) {
+        uint64_t fds = (uint64_t)rl.rlim_cur;
+        return (size_t)std::max<uint64_t>(
+              1, fds > fd_reserve ? fds - fd_reserve : 0);
+    }
+#endif
+    return 0;
+}
+
+/* static */ size_t ParallelismController::fd_limit() {
+    size_t sockets = socket_limit();
+    if (sockets <= 0) {
+        return 0;
+    }
+    return std::max<size_t>(1, sockets / sockets_per_measurement);
+}
+
+/* static */ ErrorOr<SharedPtr<ParallelismController>>
+ParallelismController::make(const Settings &options,
+                            SharedPtr<Logger> logger) {
+    SharedPtr<ParallelismController> pc{new ParallelismController};
+    ErrorOr<size_t> parallelism =
+          options.get_noexcept<size_t>("parallelism", 3);
+    ErrorOr<bool> adaptive =
+          options.get_noexcept<bool>("adaptive_parallelism", false);
+    if (!parallelism || *parallelism <= 0 || !adaptive) {
+        logger->warn("invalid 'parallelism' or 'adaptive_parallelism' option");
+        return {ValueError(), {}};
+    }
+    pc->adaptive_ = *adaptive;
+    pc->window_ = pc->min_ = pc->max_ = *parallelism;
+    if (!pc->adaptive_) {
+        return {NoError(), pc};
+    }
+
+    ErrorOr<size_t> min = options.get_noexcept<size_t>("parallelism_min", 1);
+    ErrorOr<size_t> max = options.get_noexcept<size_t>("parallelism_max", 64);
+    ErrorOr<double> latency_ratio =
+          options.get_noexcept<double>("parallelism_latency_ratio", 2.0);
+    ErrorOr<double> error_rate =
+          options.get_noexcept<double>("parallelism_error_rate", 0.1);
+    if (!min || !max || *min <= 0 || *max < *min || !latency_ratio ||
+        *latency_ratio < 1.0 || !error_rate || *error_rate < 0.0) {
+        logger->warn("invalid adaptive parallelism options");
+        return {ValueError(), {}};
+    }
+    pc->min_ = *min;
+    pc->max_ = *max;
+    size_t limit = fd_limit();
+    if (limit > 0 && limit < pc->max_) {
+        logger->info("Not running more than %llu measurements in parallel "
+                     "because of the limit on open files",
+                     (unsigned long long)limit);
+        pc->max_ = limit;
+        pc->min_ = std::min(pc->min_, limit);
+    }
+    pc->window_ = std::min<double>(std::max<double>(pc->window_, pc->min_),
+                                   pc->max_);
+    pc->latency_ratio_ = *latency_ratio;
+    pc->max_error_rate_ = *error_rate;
+    return {NoError(), pc};
+}
+
+size_t ParallelismController::window() const {
+    return std::max<size_t>(min_, (size_t)std::floor(window_));
+}
+
+bool ParallelismController::on_measurement(double runtime,
+                                           const std::string &failure) {
+    if (!adaptive_) {
+        return false;
+    }
+    size_t before = window();
+    measurements_ += 1;
+    error_rate_ += alpha * ((failure != "" ? 1.0 : 0.0) - error_rate_);
+
+    if (is_congestion(failure)) {
+        if (!decreased_ || measurements_ - last_decrease_ >= before) {
+            window_ = std::max<double>(min_, window_ / 2.0);
+            last_decrease_ = measurements_;
+            decreased_ = true;
+        }
+        return window() != before;
+    }
+
+    // The runtime of failed measurements says little about the latency,
+    // since they may have failed early (e.g. because of a DNS error)
+    if (failure == "") {
+        latency_samples_ += 1;
+        latency_ = (latency_samples_ == 1)
+                         ? runtime
+                         : latency_ + alpha * (runtime - latency_);
+        if (latency_samples_ == latency_warmup ||
+            (latency_samples_ > latency_warmup && latency_ < base_latency_)) {
+            base_latency_ = latency_;
+        }
+    }
+    bool latency_ok = latency_samples_ < latency_warmup ||
+                      latency_ <= latency_ratio_ * base_latency_;
+    if (latency_ok && error_rate_ <= max_error_rate_) {
+        window_ = std::min<double>(max_, window_ + 1.0 / window_);
+    }
+    return window() != before;
+}
+
+} // namespace nettests
+} // namespace mk
@@ -0,0 +1,84 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+#ifndef SRC_LIBMEASUREMENT_KIT_NETTESTS_PARALLELISM_HPP
+#define SRC_LIBMEASUREMENT_KIT_NETTESTS_PARALLELISM_HPP
+
+#include <measurement_kit/common.hpp>
+
+namespace mk {
+namespace nettests {
+
+// Decides how many measurements of a test run in parallel.
+//
+// Unless the "adaptive_parallelism" option is true, this is always the
+// value of the "parallelism" option (3 by default). Otherwise, that is the
+// initial window, which is adapted using AIMD, like TCP does:
+//
+// - after each measurement, the window grows by 1/window (i.e. by one
+//   every window measurements), as long as the average runtime of the
+//   successful measurements is not larger than "parallelism_latency_ratio"
+//   times the lowest average seen so far, and the average fraction of
+//   failed measurements is not larger than "parallelism_error_rate";
+//
+// - a measurement that failed because of a timeout (including exceeding
+//   its deadline), or because we ran out of file descriptors, halves the
+//   window, at most once every window measurements, since the measurements
+//   that were already running when the window was cut are likely to fail
+//   for the same reason.
+//
+// The window is kept between "parallelism_min" and "parallelism_max", and
+// below a maximum derived from the RLIMIT_NOFILE limit.
+class ParallelismController : public NonCopyable, public NonMovable {
+  public:
+    // Returns ValueError if the options are not valid
+    static ErrorOr<SharedPtr<ParallelismController>>
+    make(const Settings &options, SharedPtr<Logger> logger);
+
+    // Number of measurements that should be running
+    size_t window() const;
+
+    // Accounts for a measurement that took `runtime` seconds and whose
+    // failure is `failure` (empty if it did not fail). Returns true if the
+    // window changed as a result.
+    bool on_measurement(double runtime, const std::string &failure);
+
+    bool adaptive() const { return adaptive_; }
+    size_t minimum() const { return min_; }
+    size_t maximum() const { return max_; }
+
+    // Sockets that a single measurement may keep open at the same time; for
+    // example, web_connectivity has DNS, TCP connect and HTTP sockets
+    static const size_t sockets_per_measurement = 4;
+
+    // File descriptors that measurements can use, i.e. the RLIMIT_NOFILE
+    // limit minus those reserved for reports, logs, etc., or zero if there
+    // is no such limit
+    static size_t socket_limit();
+
+    // Max parallelism such that the measurements do not run out of file
+    // descriptors, or zero if there is no such limit
+    static size_t fd_limit();
+
+  private:
+    ParallelismController() {}
+
+    bool adaptive_ = false;
+    double window_ = 1.0;
+    size_t min_ = 1;
+    size_t max_ = 1;
+    double latency_ratio_ = 2.0;
+    double max_error_rate_ = 0.1;
+
+    uint64_t measurements_ = 0;
+    uint64_t last_decrease_ = 0;
+    bool decreased_ = false;
+    uint64_t latency_samples_ = 0;
+    double latency_ = 0.0;      // Moving average of the successful runtimes
+    double base_latency_ = 0.0; // Lowest `latency_` after warming up
+    double error_rate_ = 0.0;   // Moving average of the failures
+};
+
+} // namespace nettests
+} // namespace mk
+#endif
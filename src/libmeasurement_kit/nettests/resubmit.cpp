@@ -0,0 +1,49 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/nettests/runnable.hpp"
+#include "src/libmeasurement_kit/ooni/resubmitter.hpp"
+
+namespace mk {
+namespace nettests {
+
+void ResubmitRunnable::begin(Callback<Error> cb) {
+    if (begin_cb) {
+        begin_cb();
+    }
+    auto spool_dir = options.find("spool_dir");
+    if (spool_dir == options.end() || spool_dir->second == "") {
+        logger->warn("resubmit: the spool_dir option is not set");
+        error_ = ValueError();
+        cb(error_);
+        return;
+    }
+    ooni::collector::resubmit_spool(
+          spool_dir->second,
+          [=](Error error, ooni::collector::ResubmitStats stats) {
+              logger->info("resubmit: %llu entries in %llu reports (%llu "
+                           "retries)",
+                           (unsigned long long)stats.submitted,
+                           (unsigned long long)stats.reports,
+                           (unsigned long long)stats.retries);
+              error_ = error;
+              cb(error);
+          },
+          options, reactor, logger);
+}
+
+void ResubmitRunnable::end(Callback<Error> cb) {
+    for (auto fn : end_cbs) {
+        try {
+            fn();
+        } catch (const std::exception &) {
+            /* Suppress */ ;
+        }
+    }
+    logger->progress(1.00, "resubmission complete");
+    reactor->call_soon([=]() { cb(error_); });
+}
+
+} // namespace nettests
+} // namespace mk
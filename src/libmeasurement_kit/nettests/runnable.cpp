@@ -2,11 +2,14 @@
 // Measurement Kit is free software under the BSD license. See AUTHORS
 // and LICENSE for more information on the copying conditions.
 
-#include "src/libmeasurement_kit/common/fmap.hpp"
-#include "src/libmeasurement_kit/common/parallel.hpp"
-#include "src/libmeasurement_kit/common/range.hpp"
+#include "src/libmeasurement_kit/nettests/checkpoint.hpp"
+#include "src/libmeasurement_kit/nettests/host_scheduler.hpp"
+#include "src/libmeasurement_kit/nettests/input_source.hpp"
+#include "src/libmeasurement_kit/nettests/parallelism.hpp"
 #include "src/libmeasurement_kit/nettests/runnable.hpp"
 
+#include "src/libmeasurement_kit/common/deadline.hpp"
+#include "src/libmeasurement_kit/common/timer.hpp"
 #include "src/libmeasurement_kit/common/utils.hpp"
 #include "src/libmeasurement_kit/ooni/utils.hpp"
 #include "src/libmeasurement_kit/nettests/utils.hpp"
@@ -37,9 +40,63 @@ void Runnable::main(std::string, Settings, Callback<SharedPtr<report::Entry>> cb
 }
 void Runnable::fixup_entry(report::Entry &) {}
 
-void Runnable::run_next_measurement(size_t thread_id, Callback<Error> cb,
-                                    size_t num_entries,
-                                    SharedPtr<size_t> current_entry) {
+void Runnable::start_measurements_() {
+    while (!measurements_done && running < parallelism->window()) {
+        // Reuse the slots that ended, such that `slot_errors` does not grow
+        // beyond the maximum number of slots running at the same time
+        size_t slot = slot_errors.size();
+        if (!free_slots.empty()) {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        } else {
+            slot_errors.push_back(NoError());
+        }
+        running += 1;
+        run_next_measurement(slot, [=](Error error) {
+            end_slot_(slot, error);
+        });
+    }
+}
+
+void Runnable::end_slot_(size_t slot, Error error) {
+    running -= 1;
+    if (error) {
+        slot_errors[slot] = error;
+        measurements_done = true;
+    } else {
+        free_slots.push_back(slot);
+    }
+    if (running > 0 || !measurements_done) {
+        return;
+    }
+    // Like mk::parallel(), which we used when the parallelism was fixed
+    Error overall = NoError();
+    for (auto &e : slot_errors) {
+        if (e) {
+            overall = ParallelOperationError();
+            break;
+        }
+    }
+    overall.child_errors = slot_errors;
+    Callback<Error> cb = measurements_cb;
+    measurements_cb = nullptr;
+    cb(overall);
+}
+
+void Runnable::emit_parallelism_() {
+    logger->emit_event(Json{{"type", "parallelism"},
+                            {"elapsed", {mk::time_now() - beginning, "s"}},
+                            {"window", parallelism->window()},
+                            {"running", running}});
+}
+
+void Runnable::run_next_measurement(size_t thread_id, Callback<Error> cb) {
+    if (running > parallelism->window()) {
+        logger->debug("net_test: window shrunk; stopping slot %llu",
+                      (unsigned long long)thread_id);
+        cb(NoError());
+        return;
+    }
     logger->debug("net_test: running next measurement");
 
     double max_rt = options.get("max_runtime", -1.0);
@@ -47,25 +104,34 @@ void Runnable::run_next_measurement(size_t thread_id, Callback<Error> cb,
     double delta = mk::time_now() - beginning;
     if (max_rt >= 0.0 && delta > max_rt - max_rt_tolerance) {
         logger->info("Exceeded test maximum runtime");
+        measurements_done = true;
         cb(NoError());
         return;
     }
 
-    if (inputs.size() <= 0) {
+    double prog = input_source->progress();
+    if (max_rt > 0.0) {
+        prog = delta / max_rt;
+    }
+    std::string next_input;
+    uint64_t next_index = 0;
+    bool wait = false;
+    if (!(host_scheduler
+                ? host_scheduler->next(next_input, next_index, wait)
+                : input_source->next(next_input, next_index))) {
+        if (wait) {
+            // Retried when a measurement completes (see below)
+            logger->debug("net_test: all hosts with input are busy");
+            waiting_slots.push_back([=]() {
+                run_next_measurement(thread_id, cb);
+            });
+            return;
+        }
         logger->debug("net_test: reached end of input");
+        measurements_done = true;
         cb(NoError());
         return;
     }
-    std::string next_input = inputs.front();
-    inputs.pop_front();
-
-    double prog = 0.0;
-    if (max_rt > 0.0) {
-        prog = delta / max_rt;
-    } else if (num_entries > 0) {
-        prog = *current_entry / (double)num_entries;
-    }
-    *current_entry += 1;
     if (next_input != "") {
         std::string description;
         description += "Processing input: ";
@@ -82,19 +148,44 @@ void Runnable::run_next_measurement(size_t thread_id, Callback<Error> cb,
     logger->debug("net_test: calling setup");
     setup(next_input);
 
-    logger->debug("net_test: running with input %s", next_input.c_str());
-    main(next_input, options, [=](SharedPtr<report::Entry> test_keys) {
+    auto complete = [=](SharedPtr<report::Entry> test_keys) {
         report::Entry entry;
         entry["input"] = next_input;
         // Make sure the input is `null` rather than empty string
         if (entry["input"] == "") {
             entry["input"] = nullptr;
         }
-        entry["test_keys"] = *test_keys;
+        // Move rather than copy, because the tree may be large and the
+        // test does not need it anymore
+        entry["test_keys"] = std::move(*test_keys);
         entry["test_keys"]["client_resolver"] = resolver_ip;
         entry["measurement_start_time"] =
             *mk::timestamp(&measurement_start_time);
-        entry["test_runtime"] = mk::time_now() - start_time;
+        double runtime = mk::time_now() - start_time;
+        entry["test_runtime"] = runtime;
+
+        if (host_scheduler) {
+            host_scheduler->done(next_input);
+            // Its host may now be available to the waiting slots
+            std::deque<std::function<void()>> waiting;
+            std::swap(waiting, waiting_slots);
+            for (auto &fn : waiting) {
+                reactor->call_soon(std::move(fn));
+            }
+        }
+
+        // Let the outcome of the measurement drive the parallelism
+        std::string failure;
+        if (entry["test_keys"].count("failure") != 0 &&
+            entry["test_keys"]["failure"].is_string()) {
+            failure = entry["test_keys"]["failure"].get<std::string>();
+        }
+        if (parallelism->on_measurement(runtime, failure)) {
+            logger->debug("net_test: parallelism is now %llu",
+                          (unsigned long long)parallelism->window());
+            emit_parallelism_();
+            start_measurements_();
+        }
         entry["id"] = mk::sole::uuid4().str();
 
         // Until we have support for passing options, leave it empty
@@ -122,30 +213,198 @@ void Runnable::run_next_measurement(size_t thread_id, Callback<Error> cb,
         entry["annotations"] = annotations;
         report.fill_entry(entry);
         fixup_entry(entry); // Let drivers possibly fix-up the entry
-        if (entry_cb) {
+
+        // Last line of defense against leaking the probe IP through fields
+        // that the test itself did not redact
+        scrubber.scrub_entry(entry);
+
+        // Serialize the entry only once and share the result between the
+        // entry callbacks and all the reporters. We move the entry, which
+        // may be a large tree, into the result rather than copying it. The
+        // callbacks only see entries that can be written, which have the
+        // report ID filled by serialize_entry().
+        ErrorOr<SerializedEntry> serialized =
+              report.serialize_entry(std::move(entry), logger);
+        if (entry_json_cb && !!serialized) {
+            try {
+                entry_json_cb(serialized->entry());
+            } catch (const std::exception &exc) {
+                logger->warn("Unhandled exception in entry_json_cb(): %s",
+                             exc.what());
+                /* FALLTHROUGH */
+            }
+        }
+        if (entry_cb && !!serialized) {
             try {
-                entry_cb(entry.dump());
+                entry_cb(serialized->str());
             } catch (const std::exception &exc) {
                 logger->warn("Unhandled exception in entry_cb(): %s",
                              exc.what());
                 /* FALLTHROUGH */
             }
         }
-        report.write_entry(entry, [=](Error error) {
-            if (error) {
-                logger->warn("cannot write entry");
-                if (not options.get("ignore_write_entry_error", true)) {
-                    cb(error);
-                    return;
-                }
-            } else {
-                logger->debug("net_test: written entry");
+        if (!serialized) {
+            logger->warn("cannot write entry");
+            if (not options.get("ignore_write_entry_error", true)) {
+                cb(serialized.as_error());
+                return;
             }
             reactor->call_soon([=]() {
-                run_next_measurement(thread_id, cb, num_entries, current_entry);
+                run_next_measurement(thread_id, cb);
             });
-        }, logger);
+            return;
+        }
+        // Entries are written in the order in which they are pushed, which
+        // is how we know which inputs are done (see update_checkpoint_())
+        if (checkpoint) {
+            unwritten.push_back(next_index);
+        }
+        // Do not wait for the entry to be written, unless the queue of
+        // entries waiting to be written is full (see write_entry_())
+        submissions->push(*serialized, [=](Error error) {
+            if (error) {
+                cb(error);
+                return;
+            }
+            run_next_measurement(thread_id, cb);
+        });
+    };
+
+    logger->debug("net_test: running with input %s", next_input.c_str());
+    double max_measurement_runtime =
+          options.get("max_measurement_runtime", -1.0);
+    if (max_measurement_runtime > 0.0) {
+        run_with_deadline_(next_input, max_measurement_runtime, complete);
+        return;
+    }
+    main(next_input, options, complete);
+}
+
+// Time that a measurement that exceeded its deadline has to return what it
+// measured so far, after its transports have been interrupted
+static const double deadline_grace_time = 1.0;
+
+void Runnable::run_with_deadline_(std::string input, double timeout,
+                                  Callback<SharedPtr<report::Entry>> cb) {
+    class State {
+      public:
+        bool expired = false;
+        bool done = false;
+        SharedPtr<Timer> timer;
+    };
+    SharedPtr<State> state{new State};
+    auto done = [=](SharedPtr<report::Entry> test_keys) {
+        if (state->done) {
+            logger->debug("net_test: ignoring late result for '%s'",
+                          input.c_str());
+            return;
+        }
+        state->done = true;
+        state->timer = {}; // Cancels it
+        if (state->expired) {
+            (*test_keys)["failure"] = DeadlineExceededError().reason;
+        }
+        cb(test_keys);
+    };
+    state->timer = Timer::make(reactor, timeout, [=]() {
+        logger->warn("Measurement of '%s' exceeded its deadline",
+                     input.c_str());
+        // By now, the I/O of the measurement is being interrupted (see
+        // common/deadline.hpp), such that it should soon return what it
+        // measured so far; if it does not, we give up on it
+        state->expired = true;
+        state->timer = Timer::make(reactor, deadline_grace_time, [=]() {
+            logger->warn("Measurement of '%s' did not stop at its deadline",
+                         input.c_str());
+            done(SharedPtr<report::Entry>{new report::Entry});
+        });
     });
+    main(input, with_deadline(options, timeout), done);
+}
+
+void Runnable::write_entry_(SerializedEntry entry, Callback<Error> cb) {
+    report.write_entry(entry, [=](Error error) {
+        if (error) {
+            logger->warn("cannot write entry");
+            if (not options.get("ignore_write_entry_error", true)) {
+                cb(error);
+                return;
+            }
+        } else {
+            logger->debug("net_test: written entry");
+        }
+        update_checkpoint_(false);
+        cb(NoError());
+    }, logger);
+}
+
+Error Runnable::load_checkpoint_() {
+    std::string path = options.get("checkpoint_filepath", std::string{});
+    if (path == "") {
+        if (options.get("resume", false)) {
+            logger->warn("Cannot resume without 'checkpoint_filepath'");
+            return ValueError();
+        }
+        return NoError();
+    }
+    if (options.get("no_file_report", false)) {
+        logger->warn("Checkpoints require the report file");
+        return ValueError();
+    }
+    checkpoint = SharedPtr<Checkpoint>::make();
+    if (!options.get("resume", false)) {
+        return NoError();
+    }
+    ErrorOr<Checkpoint> loaded = Checkpoint::load(path, logger);
+    if (!loaded) {
+        if (loaded.as_error() != FileIoError()) {
+            return loaded.as_error();
+        }
+        logger->info("No checkpoint to resume from; starting from scratch");
+        return NoError();
+    }
+    *checkpoint = *loaded;
+    logger->info("Resuming '%s' after its first %llu bytes",
+                 checkpoint->output_filepath.c_str(),
+                 (unsigned long long)checkpoint->report_offset);
+    // Keep writing the same report, with the same input order
+    output_filepath = checkpoint->output_filepath;
+    resume_offset = checkpoint->report_offset;
+    options["file_report_resume_offset"] = checkpoint->report_offset;
+    if (checkpoint->randomized) {
+        options["input_shuffle_seed"] = std::to_string(checkpoint->seed);
+    }
+    if (checkpoint->report_id != "") {
+        options["collector_report_id"] = checkpoint->report_id;
+    }
+    return NoError();
+}
+
+void Runnable::update_checkpoint_(bool force) {
+    if (!checkpoint || !file_reporter) {
+        return;
+    }
+    // Since the entries are appended to the report in the same order in
+    // which we pushed them, the first `stats.entries` ones are done, and
+    // they end exactly at `stats.bytes`. Note that FileReporter write errors
+    // are sticky, also when compressing, so a failed entry is never followed
+    // by a written one.
+    FileReporterStats stats = file_reporter->stats();
+    while (written < stats.entries && unwritten.size() > 0) {
+        checkpoint->mark_done(unwritten.front());
+        unwritten.pop_front();
+        written += 1;
+    }
+    checkpoint->report_offset = resume_offset + stats.bytes;
+    checkpoint->report_id = report.report_id;
+    double now = mk::time_now();
+    if (!force && now - checkpoint_time < options.get("checkpoint_interval",
+                                                      10.0)) {
+        return;
+    }
+    checkpoint_time = now;
+    (void)checkpoint->save(options.get("checkpoint_filepath", std::string{}),
+                           logger);
 }
 
 void Runnable::geoip_lookup(Callback<> cb) {
@@ -155,6 +414,7 @@ void Runnable::geoip_lookup(Callback<> cb) {
     probe_ip = "127.0.0.1";
     probe_asn = "AS0";
     probe_cc = "ZZ";
+    scrubber = {};
 
     auto save_ip = options.get("save_real_probe_ip", false);
     auto save_asn = options.get("save_real_probe_asn", true);
@@ -203,6 +463,9 @@ void Runnable::geoip_lookup(Callback<> cb) {
              * See also measurement-kit/measurement-kit#1110.
              */
             options["real_probe_ip_"] = ip;
+            if (!options.get("save_real_probe_ip", false)) {
+                scrubber = Scrubber::for_probe_ip(ip);
+            }
 
             auto country_path = options.get("geoip_country_path",
                                             std::string{});
@@ -259,11 +522,26 @@ void Runnable::open_report(Callback<Error> callback) {
         output_filepath = generate_output_filepath();
     }
     if (!options.get("no_file_report", false)) {
-        report.add_reporter(FileReporter::make(output_filepath));
+        file_reporter = FileReporter::make(output_filepath, options, reactor,
+                                           logger).as<FileReporter>();
+        report.add_reporter(file_reporter.as<BaseReporter>());
+    }
+    // Useful along with `no_file_report` to pipe the (possibly compressed,
+    // see `file_report_compression`) report into another program
+    if (options.get("report_to_stdout", false)) {
+        report.add_reporter(FileReporter::make("-", options, reactor, logger));
     }
     if (!options.get("no_collector", false)) {
         report.add_reporter(OoniReporter::make(options, reactor, logger));
     }
+    submissions = SubmissionQueue::make(
+          options.get("report_queue_size", 64),
+          options.get("report_queue_concurrency",
+                      options.get("parallelism", 3)),
+          [=](SerializedEntry entry, Callback<Error> cb) {
+              write_entry_(entry, cb);
+          },
+          reactor);
     report.open(callback);
 }
 
@@ -278,6 +556,9 @@ std::string Runnable::generate_output_filepath() {
         strftime(timestamp, sizeof(timestamp), "%FT%H%M%SZ", &test_start_time);
         filename << "report-" << test_name << "-";
         filename << timestamp << "-" << idx << ".njson";
+        if (options.get("file_report_compression", std::string{}) == "gzip") {
+            filename << ".gz";
+        }
 
         std::ifstream output_file(filename.str().c_str());
         // If a file called this way already exists we increment the counter
@@ -350,6 +631,11 @@ void Runnable::begin(Callback<Error> cb) {
     }
     mk::utc_time_now(&test_start_time);
     beginning = mk::time_now();
+    Error err = load_checkpoint_();
+    if (err) {
+        cb(err);
+        return;
+    }
     query_bouncer([=](Error error) {
         if (error) {
             cb(error);
@@ -380,28 +666,62 @@ void Runnable::begin(Callback<Error> cb) {
                         logger->set_progress_offset(0.1);
                         logger->set_progress_scale(0.8);
 
-                        error = process_input_filepaths(inputs,
-                                needs_input, input_filepaths, probe_cc, options,
-                                logger, nullptr, nullptr);
-                        if (error) {
-                            cb(error);
+                        // Input is read lazily, as the measurements
+                        // consume it, by the measurement slots below
+                        std::function<bool(uint64_t)> skip;
+                        if (checkpoint) {
+                            SharedPtr<Checkpoint> cp = checkpoint;
+                            skip = [cp](uint64_t index) {
+                                return cp->is_done(index);
+                            };
+                        }
+                        ErrorOr<SharedPtr<InputSource>> maybe_source =
+                              InputSource::open(std::move(inputs),
+                                                needs_input, input_filepaths,
+                                                probe_cc, options, logger,
+                                                skip);
+                        if (!maybe_source) {
+                            cb(maybe_source.as_error());
                             return;
                         }
-                        size_t num_entries = inputs.size();
-
-                        // Run `parallelism` measurements in parallel
-                        SharedPtr<size_t> current_entry(new size_t(0));
-                        mk::parallel(mk::fmap<size_t, Continuation<Error>>(
-                                         mk::range<size_t>(
-                                             options.get("parallelism", 3)),
-                                         [=](size_t thread_id) {
-                                             return [=](Callback<Error> cb) {
-                                                 run_next_measurement(
-                                                     thread_id, cb, num_entries,
-                                                     current_entry);
-                                             };
-                                         }),
-                                     cb);
+                        input_source = *maybe_source;
+                        if (options.get("schedule_input_by_host", false)) {
+                            ErrorOr<SharedPtr<HostScheduler>> hs =
+                                  HostScheduler::make(input_source, options,
+                                                      logger);
+                            if (!hs) {
+                                cb(hs.as_error());
+                                return;
+                            }
+                            host_scheduler = *hs;
+                        }
+                        if (input_source->randomized()) {
+                            // So that the input order can be reproduced
+                            annotations["input_shuffle_seed"] =
+                                  std::to_string(input_source->seed());
+                        }
+                        if (checkpoint) {
+                            checkpoint->output_filepath = output_filepath;
+                            checkpoint->randomized =
+                                  input_source->randomized();
+                            checkpoint->seed = input_source->seed();
+                            update_checkpoint_(true);
+                        }
+
+                        // Run measurements in parallel, in as many slots
+                        // as the parallelism controller wants
+                        ErrorOr<SharedPtr<ParallelismController>> pc =
+                              ParallelismController::make(options, logger);
+                        if (!pc) {
+                            cb(pc.as_error());
+                            return;
+                        }
+                        parallelism = *pc;
+                        measurements_cb = cb;
+                        if (parallelism->adaptive()) {
+                            emit_parallelism_();
+                        }
+                        start_measurements_();
 
                     });
                 },
@@ -421,6 +741,27 @@ void Runnable::end(Callback<Error> cb) {
     logger->set_progress_offset(0.0);
     logger->set_progress_scale(1.0);
     logger->progress(0.95, "ending the test");
+    if (!submissions) { // We did not reach open_report()
+        close_report_(cb);
+        return;
+    }
+    // Make sure that all the queued entries are written before closing
+    submissions->flush([=](Error error) {
+        SubmissionQueueStats stats = submissions->stats();
+        logger->debug("net_test: submitted %llu entries (max queued: %llu, "
+                      "max active: %llu, stalls: %llu)",
+                      (unsigned long long)stats.entries,
+                      (unsigned long long)stats.max_queued,
+                      (unsigned long long)stats.max_active,
+                      (unsigned long long)stats.stalls);
+        close_report_([=](Error err) {
+            update_checkpoint_(true); // Now that the report is complete
+            cb(err ? err : error);
+        });
+    });
+}
+
+void Runnable::close_report_(Callback<Error> cb) {
     report.close([=](Error err) {
         reactor->with_current_data_usage([=](DataUsage &du) {
             if (!!data_usage_cb) {
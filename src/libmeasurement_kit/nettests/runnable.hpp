@@ -5,20 +5,28 @@
 #define SRC_LIBMEASUREMENT_KIT_NETTESTS_RUNNABLE_HPP
 
 #include "src/libmeasurement_kit/common/delegate.hpp"
+#include "src/libmeasurement_kit/ooni/scrubber.hpp"
+#include "src/libmeasurement_kit/report/submission_queue.hpp"
 #include <measurement_kit/report.hpp>
 
 #include <ctime>
 #include <deque>
 #include <list>
 #include <sstream>
+#include <vector>
 
 namespace mk {
 namespace nettests {
 
+class Checkpoint;
+class HostScheduler;
+class InputSource;
+class ParallelismController;
+
 class Runnable : public NonCopyable, public NonMovable {
   public:
-    void begin(Callback<Error>);
-    void end(Callback<Error>);
+    virtual void begin(Callback<Error>);
+    virtual void end(Callback<Error>);
 
     virtual ~Runnable();
 
@@ -29,6 +37,7 @@ class Runnable : public NonCopyable, public NonMovable {
     std::deque<std::string> inputs;
     std::string output_filepath;
     Delegate<std::string> entry_cb;
+    Delegate<const report::Entry &> entry_json_cb; // Without serializing it
     Delegate<> begin_cb;
     std::list<Delegate<>> end_cbs;
     std::list<Delegate<>> destroy_cbs;
@@ -58,13 +67,39 @@ class Runnable : public NonCopyable, public NonMovable {
 
   private:
     report::Report report;
+    SharedPtr<report::SubmissionQueue> submissions;
+    ooni::Scrubber scrubber; // Empty unless we must scrub the probe IP
+    SharedPtr<InputSource> input_source;
+    SharedPtr<HostScheduler> host_scheduler; // Reorders `input_source`
+    std::deque<std::function<void()>> waiting_slots; // For a busy host
+    SharedPtr<ParallelismController> parallelism;
+    size_t running = 0;             // Measurement slots that are running
+    bool measurements_done = false; // Do not start more slots
+    std::vector<Error> slot_errors; // One for each slot running at once
+    std::vector<size_t> free_slots; // Slots that ended without errors
+    Callback<Error> measurements_cb;
+    SharedPtr<Checkpoint> checkpoint; // Only when `checkpoint_filepath` is set
+    SharedPtr<report::FileReporter> file_reporter;
+    std::deque<uint64_t> unwritten; // Input indices, in report writing order
+    uint64_t written = 0;           // Entries written according to the report
+    uint64_t resume_offset = 0;
+    double checkpoint_time = 0.0;
     tm test_start_time;
     double beginning = 0.0;
 
-    void run_next_measurement(size_t, Callback<Error>, size_t, SharedPtr<size_t>);
+    void run_next_measurement(size_t, Callback<Error>);
+    void run_with_deadline_(std::string, double,
+                            Callback<SharedPtr<report::Entry>>);
+    void start_measurements_();
+    void end_slot_(size_t, Error);
+    void emit_parallelism_();
     void query_bouncer(Callback<Error>);
     void geoip_lookup(Callback<>);
     void open_report(Callback<Error>);
+    void write_entry_(report::SerializedEntry, Callback<Error>);
+    Error load_checkpoint_();
+    void update_checkpoint_(bool force);
+    void close_report_(Callback<Error>);
     std::string generate_output_filepath();
 };
 
@@ -95,6 +130,17 @@ class WebConnectivityRunnable : public Runnable {
     void fixup_entry(report::Entry &) override;
 };
 
+// Separate definition because it does not run a network test; rather, it
+// resubmits the entries that could not be submitted (see `spool_dir`)
+class ResubmitRunnable : public Runnable {
+  public:
+    void begin(Callback<Error>) override;
+    void end(Callback<Error>) override;
+
+  private:
+    Error error_;
+};
+
 } // namespace nettests
 } // namespace mk
 #endif
@@ -50,11 +50,20 @@
  *    that bandwidth to stream in SD quality. (Bandwidth is, of course,
  *    different from the bitrate, but a number close to 3,000 kbit/s
  *    seems anyway to be a reasonable starting point.)
+ *
+ * 7. If the `pipeline_depth` option is greater than one, we keep up to
+ *    that many requests in flight using HTTP/1.1 pipelining, so that there
+ *    is no idle RTT between chunks. In such case, the download time of a
+ *    chunk starts when the previous chunk is complete (or when we sent the
+ *    request, if that happened later). If the server or a middlebox does
+ *    not handle pipelining, we reconnect and continue one request at a
+ *    time. The default is one, i.e. no pipelining.
  */
 
 #include "src/libmeasurement_kit/common/mock.hpp"
 #include "src/libmeasurement_kit/common/utils.hpp"
 #include "src/libmeasurement_kit/ext/sole.hpp"
+#include "src/libmeasurement_kit/http/pipeline.hpp"
 #include "src/libmeasurement_kit/mlabns/mlabns.hpp"
 
 #include <measurement_kit/common/json.hpp>
@@ -98,103 +107,129 @@ class DashLoopCtx {
     Settings settings;
     SharedPtr<net::Transport> txp;
     std::string uuid;
+
+    // Options, filled by parse_options_()
+    int constant_bitrate = 0;
+    int elapsed_target = DASH_SECONDS;
+    bool fast_scale_down = false;
+    int initial_rate = DASH_INITIAL_RATE;
+    int max_iterations = DASH_MAX_ITERATIONS;
+    int pipeline_depth = 1;
+    bool use_fixed_rates = false;
+
+    // State used when pipelining
+    bool pipeline_failed = false;
+    double last_completion = 0.0;
+    SharedPtr<http::Pipeline> pipeline;
+    int submitted = 0;
 };
 
-template <MK_MOCK_AS(http::request_send, http_request_send),
-          MK_MOCK_AS(http::request_recv_response, http_request_recv_response)>
-void run_loop_(SharedPtr<DashLoopCtx> ctx) {
-    // TODO: We may want to move this parsing of options in the setup
-    // phase of the test and store them inside `ctx`.
+static inline Error parse_options_(SharedPtr<DashLoopCtx> ctx) {
     ErrorOr<bool> fast_scale_down =
           ctx->settings.get_noexcept("fast_scale_down", false);
     if (!fast_scale_down) {
         ctx->logger->warn("dash: cannot parse `fast_scale_down' option");
-        ctx->cb(fast_scale_down.as_error());
-        return;
+        return fast_scale_down.as_error();
     }
     ErrorOr<int> constant_bitrate =
           ctx->settings.get_noexcept("constant_bitrate", 0);
     if (!constant_bitrate || *constant_bitrate < 0) {
         ctx->logger->warn("dash: cannot parse `constant_bitrate' option");
-        ctx->cb(ValueError());
-        return;
+        return ValueError();
     }
     ErrorOr<bool> use_fixed_rates =
           ctx->settings.get_noexcept("use_fixed_rates", false);
     if (!use_fixed_rates) {
         ctx->logger->warn("dash: cannot parse `use_fixed_rates' option");
-        ctx->cb(use_fixed_rates.as_error());
-        return;
+        return use_fixed_rates.as_error();
     }
     ErrorOr<int> elapsed_target =
           ctx->settings.get_noexcept("elapsed_target", DASH_SECONDS);
     if (!elapsed_target || *elapsed_target < 0) {
         ctx->logger->warn("dash: cannot parse `elapsed_target' option");
-        ctx->cb(ValueError());
-        return;
+        return ValueError();
     }
     ErrorOr<int> max_iterations =
           ctx->settings.get_noexcept("max_iteration", DASH_MAX_ITERATIONS);
     if (!max_iterations || *max_iterations < 0) {
         ctx->logger->warn("dash: cannot parse `max_iteration' option");
-        ctx->cb(ValueError());
-        return;
+        return ValueError();
     }
     ErrorOr<int> initial_rate =
           ctx->settings.get_noexcept("initial_rate", DASH_INITIAL_RATE);
     if (!initial_rate || *initial_rate < 0) {
         ctx->logger->warn("dash: cannot parse `initial_rate' option");
-        ctx->cb(ValueError());
-        return;
+        return ValueError();
+    }
+    ErrorOr<int> pipeline_depth =
+          ctx->settings.get_noexcept("pipeline_depth", 1);
+    if (!pipeline_depth || *pipeline_depth < 1) {
+        ctx->logger->warn("dash: cannot parse `pipeline_depth' option");
+        return ValueError();
     }
+    ctx->constant_bitrate = *constant_bitrate;
+    ctx->elapsed_target = *elapsed_target;
+    ctx->fast_scale_down = *fast_scale_down;
+    ctx->initial_rate = *initial_rate;
+    ctx->max_iterations = *max_iterations;
+    ctx->pipeline_depth = *pipeline_depth;
+    ctx->use_fixed_rates = *use_fixed_rates;
+    return NoError();
+}
 
-    if (ctx->iteration > *max_iterations) {
-        ctx->logger->debug("dash: completed all iterations");
-        try {
-            std::vector<double> rates;
-            std::vector<double> stalls;
-            double frame_ready_time = 0.0;
-            double play_time = 0.0;
-            double connect_latency = 0.0;
-            for (auto &e : (*ctx->entry)["receiver_data"]) {
-                if (connect_latency == 0.0) {
-                    // It is always equal for all the records
-                    connect_latency = e["connect_time"];
-                }
-                rates.push_back(e["rate"]);
-                /* The first chunk is played when it arrives. To have smooth
-                   video, we'd like to play each subsequent chunk within
-                   `elapsed_target` seconds. So, the player has always something
-                   to play and the user sees the video. If a chunk arrives
-                   earlier than the play deadline, good because we can request
-                   the next chunk also earlier. That is, we increase buffer
-                   time for slow delivery. On the contrary, if a chunk arrives
-                   later than the play deadline, we need to stop playing. The
-                   max(stalls) is the delay we would have needed to add at
-                   the beginning to make sure we had no player stalls. */
-                double elapsed = e["elapsed"];
-                frame_ready_time += elapsed;
-                double elapsed_target = e["elapsed_target"];
-                // Note: this says that the play time of the first frame is
-                // when we receive it. Subsequent frames must be played after
-                // `elapsed_target` seconds each to have smooth video.
-                play_time +=
-                      (play_time == 0) ? frame_ready_time : elapsed_target;
-                double stall = frame_ready_time - play_time;
-                stalls.push_back(stall);
+static inline void finish_(SharedPtr<DashLoopCtx> ctx) {
+    ctx->logger->debug("dash: completed all iterations");
+    try {
+        std::vector<double> rates;
+        std::vector<double> stalls;
+        double frame_ready_time = 0.0;
+        double play_time = 0.0;
+        double connect_latency = 0.0;
+        for (auto &e : (*ctx->entry)["receiver_data"]) {
+            if (connect_latency == 0.0) {
+                // It is always equal for all the records
+                connect_latency = e["connect_time"];
             }
-            (*ctx->entry)["simple"]["connect_latency"] = connect_latency;
-            (*ctx->entry)["simple"]["median_bitrate"] = mk::median(rates);
-            (*ctx->entry)["simple"]["min_playout_delay"] =
-                  (stalls.size() > 0)
-                        ? *std::max_element(stalls.begin(), stalls.end())
-                        : 0.0;
-        } catch (...) {
-            ctx->logger->warn("dash: cannot save summary information");
+            rates.push_back(e["rate"]);
+            /* The first chunk is played when it arrives. To have smooth
+               video, we'd like to play each subsequent chunk within
+               `elapsed_target` seconds. So, the player has always something
+               to play and the user sees the video. If a chunk arrives
+               earlier than the play deadline, good because we can request
+               the next chunk also earlier. That is, we increase buffer
+               time for slow delivery. On the contrary, if a chunk arrives
+               later than the play deadline, we need to stop playing. The
+               max(stalls) is the delay we would have needed to add at
+               the beginning to make sure we had no player stalls. */
+            double elapsed = e["elapsed"];
+            frame_ready_time += elapsed;
+            double elapsed_target = e["elapsed_target"];
+            // Note: this says that the play time of the first frame is
+            // when we receive it. Subsequent frames must be played after
+            // `elapsed_target` seconds each to have smooth video.
+            play_time +=
+                  (play_time == 0) ? frame_ready_time : elapsed_target;
+            double stall = frame_ready_time - play_time;
+            stalls.push_back(stall);
         }
-        ctx->cb(NoError());
-        return;
+        (*ctx->entry)["simple"]["connect_latency"] = connect_latency;
+        (*ctx->entry)["simple"]["median_bitrate"] = mk::median(rates);
+        (*ctx->entry)["simple"]["min_playout_delay"] =
+              (stalls.size() > 0)
+                    ? *std::max_element(stalls.begin(), stalls.end())
+                    : 0.0;
+    } catch (...) {
+        ctx->logger->warn("dash: cannot save summary information");
     }
+    ctx->cb(NoError());
+}
+
+/*
+ * Select the rate that is lower than the latest measured speed. The number
+ * of bytes to request is such that downloading with the selected rate
+ * takes `elapsed_target` (in theory).
+ */
+static inline int select_rate_kbit_(SharedPtr<DashLoopCtx> ctx) {
     if (ctx->speed_kbit < 0) {
         // Determine initial speed estimate. In legacy mode (i.e. when we use
         // a fixed vector of rates), we use the first entry. Otherwise, we use
@@ -203,19 +238,17 @@ void run_loop_(SharedPtr<DashLoopCtx> ctx) {
         // 2017. I though this would be a good starting point.
         //
         // See: <https://help.netflix.com/en/node/306>.
-        ctx->speed_kbit = (*use_fixed_rates == true)
-              ? dash_rates()[0] : *initial_rate;
+        ctx->speed_kbit = (ctx->use_fixed_rates == true)
+              ? dash_rates()[0] : ctx->initial_rate;
     }
-    /*
-     * Select the rate that is lower than the latest measured speed and
-     * compute the number of bytes to download such that downloading with
-     * the selected rate takes `elapsed_target` (in theory).
-     */
-    int rate_kbit =
-          (*use_fixed_rates == true)
+    return (ctx->use_fixed_rates == true)
                 ? dash_rates()[select_lower_rate_index(ctx->speed_kbit)]
-                : (*constant_bitrate > 0) ? *constant_bitrate : ctx->speed_kbit;
-    int count = ((rate_kbit * 1000) / 8) * (*elapsed_target);
+                : (ctx->constant_bitrate > 0) ? ctx->constant_bitrate
+                                              : ctx->speed_kbit;
+}
+
+static inline Settings make_request_settings_(SharedPtr<DashLoopCtx> ctx,
+                                              int count) {
     std::string path = "/dash/download/";
     path += std::to_string(count);
     Settings settings = ctx->settings; /* Make a local copy */
@@ -223,6 +256,111 @@ void run_loop_(SharedPtr<DashLoopCtx> ctx) {
     settings["http/path"] = path;
     settings["http/method"] = "GET";
     ctx->logger->debug("dash: requesting '%s'", path.c_str());
+    return settings;
+}
+
+static inline http::Headers make_request_headers_(SharedPtr<DashLoopCtx> ctx) {
+    return {
+          {"Authorization", ctx->auth_token},
+          {"Cache-Control", "no-cache, no-store, must-revalidate"},
+    };
+}
+
+// Accounts for a received response and prepares for the next iteration
+static inline Error process_response_(SharedPtr<DashLoopCtx> ctx,
+                                      SharedPtr<http::Response> res,
+                                      int rate_kbit, double saved_time,
+                                      double time_elapsed) {
+    assert(!!res);
+    if (res->status_code != 200) {
+        ctx->logger->warn("dash: invalid response code: %d",
+                          res->status_code);
+        return http::HttpRequestFailedError();
+    }
+    /*
+     * XXX: This test assumes that HTTP caches are not
+     * closing the connection after each request. But there
+     * are networks in which this happens, as documented
+     * in measurement-kit/measurement-kit#1322. In such case
+     * what we do is that we abort the test.
+     */
+    if (http::header_has_token(res->headers, "Connection", "close")) {
+        ctx->logger->warn("dash: middlebox detected error");
+        return MiddleboxDetectedError();
+    }
+    auto length = res->body.length();
+    if (time_elapsed <= 0) { // For robustness
+        ctx->logger->warn("dash: negative time error");
+        return GenericError("negative_time_error");
+    }
+    (*ctx->entry)["receiver_data"].push_back(report::Entry{
+          {"connect_time", ctx->txp->connect_time()},
+          {"constant_bitrate", ctx->constant_bitrate != 0},
+          {"delta_user_time", 0.0},
+          {"delta_sys_time", 0.0},
+          {"elapsed", time_elapsed},
+          {"elapsed_target", ctx->elapsed_target},
+          {"engine_name", "libmeasurement_kit"},
+          {"engine_version", MK_VERSION},
+          {"fast_scale_down", ctx->fast_scale_down},
+          {"internal_address", ctx->txp->sockname().hostname},
+          {"iteration", ctx->iteration},
+          {"platform", mk_platform()},
+          {"rate", rate_kbit},
+          {"real_address", ctx->real_address},
+          /*
+           * Note: here we're only concerned with the amount
+           * of useful data we received (we ignore overhead)
+           *
+           * This is different from the original
+           * implementation of DASH that is part of Neubot.
+           */
+          {"received", length},
+          {"remote_address", ctx->txp->peername().hostname},
+          {"request_ticks", saved_time},
+          {"timestamp", llround(saved_time)},
+          {"use_fixed_rates", ctx->use_fixed_rates},
+          {"uuid", ctx->uuid},
+          /*
+           * This version indicates measurement-kit.
+           */
+          {"version", "0.007000000"}});
+    double speed = length / time_elapsed;
+    double s_k = (speed * 8) / 1000;
+    std::stringstream ss;
+    ss << "rate: " << rate_kbit << " kbit/s, speed: " << std::fixed
+       << std::setprecision(2) << s_k << " kbit/s, elapsed: " << time_elapsed
+       << " s";
+    ctx->logger->progress(ctx->iteration / (double)ctx->max_iterations,
+                          ss.str().c_str());
+    if (ctx->fast_scale_down == true && time_elapsed > ctx->elapsed_target) {
+        // If the rate is too high, scale it down
+        double relerr = 1 - (time_elapsed / ctx->elapsed_target);
+        s_k *= relerr;
+        if (s_k <= 0) {
+            s_k = dash_rates()[0];
+        }
+    }
+    ctx->speed_kbit = (int)s_k;
+    ctx->iteration += 1;
+    return NoError();
+}
+
+template <MK_MOCK_AS(http::request_send, http_request_send),
+          MK_MOCK_AS(http::request_recv_response, http_request_recv_response)>
+void run_loop_(SharedPtr<DashLoopCtx> ctx) {
+    Error err = parse_options_(ctx);
+    if (err) {
+        ctx->cb(err);
+        return;
+    }
+    if (ctx->iteration > ctx->max_iterations) {
+        finish_(ctx);
+        return;
+    }
+    int rate_kbit = select_rate_kbit_(ctx);
+    int count = ((rate_kbit * 1000) / 8) * ctx->elapsed_target;
+    Settings settings = make_request_settings_(ctx, count);
     /*
      * Note: our accounting of time also includes the time to send the
      * request to the server (approximately one RTT).
@@ -232,12 +370,8 @@ void run_loop_(SharedPtr<DashLoopCtx> ctx) {
      */
     double saved_time = mk::time_now();
     http_request_send(
-          ctx->txp, settings,
-          {
-                {"Authorization", ctx->auth_token},
-                {"Cache-Control", "no-cache, no-store, must-revalidate"},
-          },
-          "", ctx->logger, [=](Error error, SharedPtr<http::Request> req) {
+          ctx->txp, settings, make_request_headers_(ctx), "", ctx->logger,
+          [=](Error error, SharedPtr<http::Request> req) {
               if (error) {
                   ctx->logger->warn("dash: request failed: %s", error.what());
                   ctx->cb(error);
@@ -254,88 +388,14 @@ void run_loop_(SharedPtr<DashLoopCtx> ctx) {
                             ctx->cb(error);
                             return;
                         }
-                        assert(!!res);
-                        if (res->status_code != 200) {
-                            ctx->logger->warn("dash: invalid response code: %s",
-                                              error.what());
-                            ctx->cb(http::HttpRequestFailedError());
-                            return;
-                        }
-                        /*
-                         * XXX: This test assumes that HTTP caches are not
-                         * closing the connection after each request. But there
-                         * are networks in which this happens, as documented
-                         * in measurement-kit/measurement-kit#1322. In such case
-                         * what we do is that we abort the test.
-                         */
-                        if (res->headers["connection"] == "close") {
-                            ctx->logger->warn("dash: middlebox detected error");
-                            ctx->cb(MiddleboxDetectedError());
-                            return;
-                        }
                         res->request = req;
-                        auto length = res->body.length();
-                        double time_elapsed = mk::time_now() - saved_time;
-                        if (time_elapsed <= 0) { // For robustness
-                            ctx->logger->warn("dash: negative time error");
-                            ctx->cb(GenericError("negative_time_error"));
+                        error = process_response_(
+                              ctx, res, rate_kbit, saved_time,
+                              mk::time_now() - saved_time);
+                        if (error) {
+                            ctx->cb(error);
                             return;
                         }
-                        (*ctx->entry)["receiver_data"].push_back(report::Entry{
-                              {"connect_time", ctx->txp->connect_time()},
-                              {"constant_bitrate", *constant_bitrate != 0},
-                              {"delta_user_time", 0.0},
-                              {"delta_sys_time", 0.0},
-                              {"elapsed", time_elapsed},
-                              {"elapsed_target", *elapsed_target},
-                              {"engine_name", "libmeasurement_kit"},
-                              {"engine_version", MK_VERSION},
-                              {"fast_scale_down", *fast_scale_down},
-                              {"internal_address",
-                               ctx->txp->sockname().hostname},
-                              {"iteration", ctx->iteration},
-                              {"platform", mk_platform()},
-                              {"rate", rate_kbit},
-                              {"real_address", ctx->real_address},
-                              /*
-                               * Note: here we're only concerned with the amount
-                               * of useful data we received (we ignore overhead)
-                               *
-                               * This is different from the original
-                               * implementation of DASH that is part of Neubot.
-                               */
-                              {"received", length},
-                              {"remote_address", ctx->txp->peername().hostname},
-                              {"request_ticks", saved_time},
-                              {"timestamp", llround(saved_time)},
-                              {"use_fixed_rates", *use_fixed_rates},
-                              {"uuid", ctx->uuid},
-                              /*
-                               * This version indicates measurement-kit.
-                               */
-                              {"version", "0.007000000"}});
-                        double speed = length / time_elapsed;
-                        double s_k = (speed * 8) / 1000;
-                        std::stringstream ss;
-                        ss << "rate: " << rate_kbit
-                           << " kbit/s, speed: " << std::fixed
-                           << std::setprecision(2) << s_k
-                           << " kbit/s, elapsed: " << time_elapsed << " s";
-                        ctx->logger->progress(ctx->iteration /
-                                                    (double)*max_iterations,
-                                              ss.str().c_str());
-                        if (*fast_scale_down == true &&
-                            time_elapsed > *elapsed_target) {
-                            // If the rate is too high, scale it down
-                            double relerr =
-                                  1 - (time_elapsed / *elapsed_target);
-                            s_k *= relerr;
-                            if (s_k <= 0) {
-                                s_k = dash_rates()[0];
-                            }
-                        }
-                        ctx->speed_kbit = (int)s_k;
-                        ctx->iteration += 1;
                         run_loop_<http_request_send,
                                   http_request_recv_response>(ctx);
                     },
@@ -343,28 +403,93 @@ void run_loop_(SharedPtr<DashLoopCtx> ctx) {
           });
 }
 
+/*
+ * Pipelined variant of run_loop_() that keeps up to `pipeline_depth`
+ * requests in flight, so that the link is not idle for one RTT between
+ * a response and the next request. Each new request uses the speed
+ * measured with the latest response, and the time to download a chunk
+ * is measured from when the request was sent or from when the previous
+ * response was complete, whichever happens later.
+ */
+static inline void run_pipelined_loop_(SharedPtr<DashLoopCtx> ctx) {
+    while (ctx->submitted < ctx->max_iterations &&
+           (int)ctx->pipeline->outstanding() < ctx->pipeline_depth) {
+        ctx->submitted += 1;
+        int rate_kbit = select_rate_kbit_(ctx);
+        int count = ((rate_kbit * 1000) / 8) * ctx->elapsed_target;
+        double saved_time = mk::time_now();
+        ctx->pipeline->submit(
+              make_request_settings_(ctx, count), make_request_headers_(ctx),
+              "", [=](Error error, SharedPtr<http::Response> res) {
+                  if (ctx->pipeline_failed) {
+                      return; // We already reported an error
+                  }
+                  // A response whose length is not what we asked for is
+                  // the response to another request: pipelining is broken
+                  if (!error && res->status_code == 200 &&
+                      res->body.length() != (size_t)count) {
+                      ctx->logger->warn("dash: unexpected response length");
+                      error = http::PipeliningBrokenError();
+                  }
+                  if (error) {
+                      ctx->logger->warn("dash: cannot receive response: %s",
+                                        error.what());
+                      ctx->pipeline_failed = true;
+                      ctx->cb(error);
+                      return;
+                  }
+                  double now = mk::time_now();
+                  double begin = std::max(saved_time, ctx->last_completion);
+                  ctx->last_completion = now;
+                  error = process_response_(ctx, res, rate_kbit, saved_time,
+                                            now - begin);
+                  if (error) {
+                      ctx->pipeline_failed = true;
+                      ctx->cb(error);
+                      return;
+                  }
+                  if (ctx->iteration > ctx->max_iterations) {
+                      finish_(ctx);
+                      return;
+                  }
+                  run_pipelined_loop_(ctx);
+              });
+    }
+}
+
 template <MK_MOCK_AS(http::request_connect, http_request_connect),
           MK_MOCK_AS(http::request_send, http_request_send),
-          MK_MOCK_AS(http::request_recv_response, http_request_recv_response)>
+          MK_MOCK_AS(http::request_recv_response, http_request_recv_response),
+          MK_MOCK_AS(http::request_recv_pipelined_response,
+                     http_request_recv_pipelined_response)>
 void run_impl(std::string url, std::string auth_token, std::string real_address,
               SharedPtr<report::Entry> entry, Settings settings, SharedPtr<Reactor> reactor,
-              SharedPtr<Logger> logger, Callback<Error> cb) {
-    SharedPtr<DashLoopCtx> ctx = SharedPtr<DashLoopCtx>::make();
-    ctx->auth_token = auth_token;
-    ctx->entry = entry;
-    ctx->logger = logger;
-    ctx->reactor = reactor;
-    ctx->real_address = real_address;
-    ctx->settings = settings;
-    //
-    // Neubot used to generate a random UUID for the probe and to keep it
-    // consistent over time to enable time series analyses. The problem of
-    // doing that on mobile is that it will most likely allow to identify
-    // and/or track people. For this reason, the code for allowing setting
-    // a specific UUID has been removed and we generate a random new UUID
-    // each time we run a new DASH test.
-    //
-    ctx->uuid = mk::sole::uuid4().str();
+              SharedPtr<Logger> logger, Callback<Error> cb,
+              SharedPtr<DashLoopCtx> ctx = {}) {
+    bool fallback = !!ctx; // Reconnecting after pipelining was broken
+    if (!fallback) {
+        ctx = SharedPtr<DashLoopCtx>::make();
+        ctx->auth_token = auth_token;
+        ctx->entry = entry;
+        ctx->logger = logger;
+        ctx->reactor = reactor;
+        ctx->real_address = real_address;
+        ctx->settings = settings;
+        //
+        // Neubot used to generate a random UUID for the probe and to keep it
+        // consistent over time to enable time series analyses. The problem of
+        // doing that on mobile is that it will most likely allow to identify
+        // and/or track people. For this reason, the code for allowing setting
+        // a specific UUID has been removed and we generate a random new UUID
+        // each time we run a new DASH test.
+        //
+        ctx->uuid = mk::sole::uuid4().str();
+        Error err = parse_options_(ctx);
+        if (err) {
+            cb(err);
+            return;
+        }
+    }
     settings["http/url"] = url;
     settings["http/method"] = "GET";
     logger->info("Start dash test with: %s", url.c_str());
@@ -382,11 +507,44 @@ void run_impl(std::string url, std::string auth_token, std::string real_address,
               logger->info("Connected to server (3WHS RTT = %f s); starting "
                            "the test", txp->connect_time());
               ctx->txp = txp;
+              bool pipelined = !fallback && ctx->pipeline_depth > 1;
               ctx->cb = [=](Error error) {
                   // Release the `txp` before continuing
                   logger->info("Test complete; closing connection");
+                  // Note: a middlebox closing the connection after each
+                  // response would also break the test without pipelining
+                  bool fall_back = error && pipelined &&
+                                   error != MiddleboxDetectedError() &&
+                                   (error == http::PipeliningBrokenError() ||
+                                    ctx->pipeline->broken());
+                  // The `txp` is closed when nobody references it anymore,
+                  // so break the reference cycles through `ctx`. We cannot
+                  // clear ourselves while running, hence the call_soon().
+                  ctx->txp = {};
+                  ctx->pipeline = {};
+                  reactor->call_soon([ctx]() { ctx->cb = nullptr; });
+                  if (fall_back) {
+                      // Like browsers do, retry without pipelining
+                      logger->warn("dash: pipelining broken; falling back");
+                      txp->close([=]() {
+                          run_impl<http_request_connect, http_request_send,
+                                   http_request_recv_response,
+                                   http_request_recv_pipelined_response>(
+                                url, auth_token, real_address, entry, settings,
+                                reactor, logger, cb, ctx);
+                      });
+                      return;
+                  }
                   txp->close([=]() { cb(error); });
               };
+              if (pipelined) {
+                  ctx->pipeline = http::Pipeline::make<
+                        http_request_send,
+                        http_request_recv_pipelined_response>(
+                        txp, ctx->pipeline_depth, reactor, logger);
+                  run_pipelined_loop_(ctx);
+                  return;
+              }
               run_loop_<http_request_send, http_request_recv_response>(ctx);
           },
           reactor, logger);
@@ -67,6 +67,9 @@ void post_net_tests_impl(std::string base_bouncer_url, std::string test_name,
     std::string bm = "POST";
     settings["http/url"] = bbu;
     settings["http/method"] = bm;
+    if (settings.find("http/accept_encoding") == settings.end()) {
+        settings["http/accept_encoding"] = "gzip, deflate";
+    }
 
     http_request(settings, {{"Content-Type", "application/json"}},
                  request.dump(),
@@ -2,6 +2,7 @@
 // Measurement Kit is free software under the BSD license. See AUTHORS
 // and LICENSE for more information on the copying conditions.
 
+#include "src/libmeasurement_kit/common/json_writer.hpp"
 #include "src/libmeasurement_kit/ooni/collector_client_impl.hpp"
 #include <regex>
 
@@ -45,20 +46,76 @@ static std::map<std::string, std::regex> mandatory_re{
      std::regex{R"(^[0-9]{4}-[0-9]{2}-[0-9]{2} [0-9]{2}:[0-9]{2}:[0-9]{2}$)"}},
 };
 
-Error valid_entry(Entry entry) {
+Error valid_entry(const Entry &entry) {
     // TODO: also validate the optional values
     for (auto pair : mandatory_re) {
-        ErrorOr<std::string> s = entry[pair.first];
-        if (!s) {
-            return MissingMandatoryKeyError(s.as_error());
+        // Note: `entry` may be large, so we avoid copying it
+        auto it = entry.find(pair.first);
+        if (it == entry.end() || !it->is_string()) {
+            return MissingMandatoryKeyError(JsonDomainError());
         }
-        if (!std::regex_match(*s, pair.second)) {
+        if (!std::regex_match(it->get<std::string>(), pair.second)) {
             return InvalidMandatoryValueError(pair.first);
         }
     }
     return NoError();
 }
 
+Error prepare_post(std::string append_to_url, const std::string &body,
+                   Settings &settings, Headers &headers) {
+    std::string url = "";
+    if (settings.find("collector_base_url") == settings.end()) {
+        return MissingCollectorBaseUrlError();
+    }
+    if (settings.find("collector_front_domain") != settings.end()) {
+        mk::http::Url base_url = mk::http::parse_url(settings["collector_base_url"]);
+        url = "https://";
+        url += settings["collector_front_domain"];
+        url += base_url.path; // XXX should we do more?
+        headers["Host"] = base_url.address; // XXX this is confusing that it's called address
+    } else {
+        url = settings["collector_base_url"];
+    }
+    url += append_to_url;
+    settings["http/url"] = url;
+    settings["http/method"] = "POST";
+    if (settings.find("http/accept_encoding") == settings.end()) {
+        settings["http/accept_encoding"] = "gzip, deflate";
+    }
+    if (body != "") {
+        headers["Content-Type"] = "application/json";
+    }
+    return NoError();
+}
+
+std::string make_update_report_body(const SerializedEntry &entry) {
+    std::string body = "{\"content\":";
+    StringSink sink{body};
+    (void)entry.write(sink); // Cannot fail
+    body += ",\"format\":\"json\"}";
+    return body;
+}
+
+ErrorOr<Json> process_post_response(Error err, SharedPtr<Response> response) {
+    if (err) {
+        return {err, nullptr};
+    }
+    if (response->status_code / 100 != 2) {
+        return {HttpRequestFailedError(), nullptr};
+    }
+    // If response is empty, don't parse it
+    if (response->body == "") {
+        return {NoError(), nullptr};
+    }
+    Json reply;
+    try {
+        reply = Json::parse(response->body);
+    } catch (const std::invalid_argument &) {
+        return {JsonParseError(), nullptr};
+    }
+    return {NoError(), reply};
+}
+
 void post(SharedPtr<Transport> transport, std::string url_extra, std::string body,
           Callback<Error, Json> callback, Settings conf,
           SharedPtr<Reactor> reactor, SharedPtr<Logger> logger) {
@@ -97,6 +154,25 @@ void connect_and_update_report(std::string report_id, report::Entry entry,
                                    reactor, logger);
 }
 
+void update_report_serialized(SharedPtr<Transport> transport,
+                              std::string report_id, SerializedEntry entry,
+                              Callback<Error> callback, Settings settings,
+                              SharedPtr<Reactor> reactor,
+                              SharedPtr<Logger> logger) {
+    update_report_serialized_impl(transport, report_id, entry, callback,
+                                  settings, reactor, logger);
+}
+
+void connect_and_update_report_serialized(std::string report_id,
+                                          SerializedEntry entry,
+                                          Callback<Error> callback,
+                                          Settings settings,
+                                          SharedPtr<Reactor> reactor,
+                                          SharedPtr<Logger> logger) {
+    connect_and_update_report_serialized_impl(report_id, entry, callback,
+                                              settings, reactor, logger);
+}
+
 void close_report(SharedPtr<Transport> transport, std::string report_id,
                   Callback<Error> callback, Settings settings,
                   SharedPtr<Reactor> reactor, SharedPtr<Logger> logger) {
@@ -34,59 +34,42 @@ void post(SharedPtr<Transport> transport, std::string url_extra, std::string bod
           Callback<Error, Json> callback, Settings conf = {},
           SharedPtr<Reactor> = Reactor::global(), SharedPtr<Logger> = Logger::global());
 
+// Fills `settings` and `headers` for POSTing `body` to `append_to_url`.
+Error prepare_post(std::string append_to_url, const std::string &body,
+                   Settings &settings, Headers &headers);
+
+// Returns the body for submitting `entry`, which is equal to the serialization
+// of the JSON object containing `content` and `format`, streaming the entry
+// into it rather than serializing it separately and then copying it.
+std::string make_update_report_body(const SerializedEntry &entry);
+
+// Processes the response to a POST, returning the JSON reply, if any.
+ErrorOr<Json> process_post_response(Error err, SharedPtr<Response> response);
+
 template <MK_MOCK_AS(http::request_sendrecv, http_request_sendrecv)>
 void post_impl(SharedPtr<Transport> transport, std::string append_to_url,
                std::string body, Callback<Error, Json> callback,
                Settings settings, SharedPtr<Reactor> reactor, SharedPtr<Logger> logger) {
-    std::string url = "";
     Headers headers;
-    if (settings.find("collector_base_url") == settings.end()) {
-        callback(MissingCollectorBaseUrlError(), nullptr);
+    Error err = prepare_post(append_to_url, body, settings, headers);
+    if (err) {
+        callback(err, nullptr);
         return;
     }
-    if (settings.find("collector_front_domain") != settings.end()) {
-        mk::http::Url base_url = mk::http::parse_url(settings["collector_base_url"]);
-        url = "https://";
-        url += settings["collector_front_domain"];
-        url += base_url.path; // XXX should we do more?
-        headers["Host"] = base_url.address; // XXX this is confusing that it's called address
-    } else {
-        url = settings["collector_base_url"];
-    }
-    url += append_to_url;
-    settings["http/url"] = url;
-    settings["http/method"] = "POST";
-    if (body != "") {
-        headers["Content-Type"] = "application/json";
-    }
     http_request_sendrecv(transport, settings, headers, body,
                           [=](Error err, SharedPtr<Response> response) {
-                              if (err) {
-                                  callback(err, nullptr);
+                              ErrorOr<Json> reply =
+                                    process_post_response(err, response);
+                              if (!reply) {
+                                  callback(reply.as_error(), nullptr);
                                   return;
                               }
-                              if (response->status_code / 100 != 2) {
-                                  callback(HttpRequestFailedError(), nullptr);
-                                  return;
-                              }
-                              // If response is empty, don't parse it
-                              if (response->body == "") {
-                                  callback(NoError(), nullptr);
-                                  return;
-                              }
-                              Json reply;
-                              try {
-                                  reply = Json::parse(response->body);
-                              } catch (const std::invalid_argument &) {
-                                  callback(JsonParseError(), nullptr);
-                                  return;
-                              }
-                              callback(NoError(), reply);
+                              callback(NoError(), *reply);
                           },
                           reactor, logger);
 }
 
-Error valid_entry(Entry entry);
+Error valid_entry(const Entry &entry);
 
 /*
              _
@@ -185,6 +168,25 @@ void connect_and_create_report_impl(report::Entry entry,
     }, reactor, logger);
 }
 
+template <MK_MOCK_AS(collector::post, collector_post)>
+void update_report_serialized_impl(SharedPtr<Transport> transport,
+                                   std::string report_id, SerializedEntry entry,
+                                   Callback<Error> callback, Settings settings,
+                                   SharedPtr<Reactor> reactor,
+                                   SharedPtr<Logger> logger) {
+    Error err = valid_entry(entry.entry());
+    if (err != NoError()) {
+        callback(err);
+        return;
+    }
+    collector_post(transport, "/report/" + report_id,
+                   make_update_report_body(entry),
+                   [=](Error err, Json) {
+                       callback(err);
+                   },
+                   settings, reactor, logger);
+}
+
 template <MK_MOCK_AS(collector::post, collector_post)>
 void update_report_impl(SharedPtr<Transport> transport, std::string report_id,
                         Entry entry, Callback<Error> callback,
@@ -209,19 +211,9 @@ void update_report_impl(SharedPtr<Transport> transport, std::string report_id,
         entry["report_id"] = report_id;
     }
 
-    Error err = valid_entry(entry);
-    if (err != NoError()) {
-        callback(err);
-        return;
-    }
-    Entry request{{"format", "json"}};
-    request["content"] = entry;
-    std::string body = request.dump();
-    collector_post(transport, "/report/" + report_id, body,
-                   [=](Error err, Json) {
-                       callback(err);
-                   },
-                   settings, reactor, logger);
+    update_report_serialized_impl<collector_post>(
+          transport, report_id, SerializedEntry::make(std::move(entry)),
+          callback, settings, reactor, logger);
 }
 
 template <MK_MOCK_AS(collector::connect, collector_connect),
@@ -243,6 +235,29 @@ void connect_and_update_report_impl(std::string report_id, report::Entry entry,
     }, reactor, logger);
 }
 
+template <MK_MOCK_AS(collector::connect, collector_connect),
+          MK_MOCK_AS(collector::update_report_serialized,
+                     collector_update_report_serialized)>
+void connect_and_update_report_serialized_impl(std::string report_id,
+                                               SerializedEntry entry,
+                                               Callback<Error> callback,
+                                               Settings settings,
+                                               SharedPtr<Reactor> reactor,
+                                               SharedPtr<Logger> logger) {
+    collector_connect(settings, [=](Error error, SharedPtr<Transport> txp) {
+        if (error) {
+            callback(error);
+            return;
+        }
+        collector_update_report_serialized(txp, report_id, entry,
+                                           [=](Error error) {
+            txp->close([=]() {
+                callback(error);
+            });
+        }, settings, reactor, logger);
+    }, reactor, logger);
+}
+
 template <MK_MOCK_AS(collector::post, collector_post)>
 void close_report_impl(SharedPtr<Transport> transport, std::string report_id,
                        Callback<Error> callback, Settings settings,
@@ -0,0 +1,178 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/ooni/collector_session.hpp"
+#include "src/libmeasurement_kit/ooni/collector_client_impl.hpp"
+
+namespace mk {
+namespace ooni {
+namespace collector {
+
+Session::Session(Settings settings, SharedPtr<Reactor> reactor,
+                 SharedPtr<Logger> logger)
+    : logger_{std::move(logger)}, reactor_{std::move(reactor)},
+      settings_{std::move(settings)} {
+    int depth = settings_.get("collector_pipeline_depth", 1);
+    depth_ = (depth > 0) ? depth : 1;
+}
+
+/* static */ SharedPtr<Session> Session::make(Settings settings,
+                                             SharedPtr<Reactor> reactor,
+                                             SharedPtr<Logger> logger) {
+    return SharedPtr<Session>{std::make_shared<Session>(
+          std::move(settings), std::move(reactor), std::move(logger))};
+}
+
+void Session::post(std::string append_to_url, std::string body,
+                   Callback<Error, Json> cb) {
+    Item item;
+    item.settings = settings_;
+    Error err = prepare_post(append_to_url, body, item.settings, item.headers);
+    if (err) {
+        cb(err, nullptr);
+        return;
+    }
+    item.body = std::move(body);
+    item.cb = std::move(cb);
+    queue_.push_back(std::move(item));
+    pump_();
+}
+
+void Session::update_report(std::string report_id,
+                            report::SerializedEntry entry, Callback<Error> cb) {
+    Error err = valid_entry(entry.entry());
+    if (err) {
+        cb(err);
+        return;
+    }
+    post("/report/" + report_id, make_update_report_body(entry),
+         [cb](Error err, Json) { cb(err); });
+}
+
+void Session::close_report(std::string report_id, Callback<Error> cb) {
+    post("/report/" + report_id + "/close", "",
+         [cb](Error err, Json) { cb(err); });
+}
+
+void Session::close(Callback<> cb) {
+    if (!conn_) {
+        reactor_->call_soon(std::move(cb));
+        return;
+    }
+    logger_->debug("collector: session used %llu connections for %llu "
+                   "requests (%llu retries)",
+                   (unsigned long long)stats_.connects,
+                   (unsigned long long)stats_.requests,
+                   (unsigned long long)stats_.retries);
+    retire_(conn_, std::move(cb));
+}
+
+void Session::pump_() {
+    if (connecting_ || queue_.empty()) {
+        return;
+    }
+    if (!conn_) {
+        SharedPtr<Session> self = shared_from_this();
+        connecting_ = true;
+        connect(settings_, [self](Error err, SharedPtr<net::Transport> txp) {
+            self->connecting_ = false;
+            if (err) {
+                std::deque<Item> items;
+                items.swap(self->queue_);
+                for (auto &item : items) {
+                    item.cb(err, nullptr);
+                }
+                return;
+            }
+            self->stats_.connects += 1;
+            auto conn = SharedPtr<Connection>::make();
+            conn->txp = txp;
+            conn->pipeline = http::Pipeline::make(txp, self->depth_,
+                                                  self->reactor_, self->logger_);
+            self->conn_ = conn;
+            self->pump_();
+        }, reactor_, logger_);
+        return;
+    }
+    while (conn_ && !queue_.empty()) {
+        Item item = std::move(queue_.front());
+        queue_.pop_front();
+        submit_(conn_, std::move(item));
+    }
+}
+
+void Session::submit_(SharedPtr<Connection> conn, Item item) {
+    SharedPtr<Session> self = shared_from_this();
+    bool reused = conn->requests > 0;
+    conn->requests += 1;
+    conn->outstanding += 1;
+    stats_.requests += 1;
+    Settings settings = item.settings;
+    http::Headers headers = item.headers;
+    std::string body = item.body;
+    conn->pipeline->submit(settings, headers, body,
+                           [self, conn, item, reused](
+                                 Error err, SharedPtr<http::Response> resp) {
+        conn->outstanding -= 1;
+        if (conn->pipeline && conn->pipeline->broken()) {
+            self->depth_ = 1; // Do not insist with a broken collector
+        }
+        if (!err && http::header_has_token(resp->headers, "Connection", "close")) {
+            conn->peer_closed = true;
+            self->retire_(conn);
+        } else if (err || (conn->dead && conn->outstanding == 0)) {
+            self->retire_(conn);
+        }
+        // Note: requests queued after a response saying that the connection
+        // will be closed have not been processed, hence they do not count
+        // as a failed attempt and they can always be sent again
+        if (err && (conn->peer_closed ||
+                    (item.attempt == 0 &&
+                     (reused || err == http::PipeliningBrokenError())))) {
+            self->logger_->debug("collector: retrying on a new connection "
+                                 "after: %s", err.what());
+            Item copy = item;
+            if (!conn->peer_closed) {
+                copy.attempt += 1;
+            }
+            self->stats_.retries += 1;
+            self->queue_.push_back(std::move(copy));
+            self->pump_();
+            return;
+        }
+        ErrorOr<Json> reply = process_post_response(err, resp);
+        if (!reply) {
+            item.cb(reply.as_error(), nullptr);
+            return;
+        }
+        item.cb(NoError(), *reply);
+    });
+}
+
+void Session::retire_(SharedPtr<Connection> conn, Callback<> cb) {
+    if (conn_ && conn_.get() == conn.get()) {
+        conn_ = {};
+    }
+    conn->dead = true;
+    if (conn->outstanding > 0 || conn->closed) {
+        if (cb) {
+            reactor_->call_soon(std::move(cb));
+        }
+        return;
+    }
+    conn->closed = true;
+    // Note: the transport close callback only runs once the transport is
+    // destroyed, so drop our references and do not wait for it
+    SharedPtr<net::Transport> txp = conn->txp;
+    conn->pipeline = {};
+    conn->txp = {};
+    txp->close([]() {});
+    if (cb) {
+        reactor_->call_soon(std::move(cb));
+    }
+}
+
+} // namespace collector
+} // namespace ooni
+} // namespace mk
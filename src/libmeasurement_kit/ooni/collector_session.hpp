@@ -0,0 +1,100 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+#ifndef SRC_LIBMEASUREMENT_KIT_OONI_COLLECTOR_SESSION_HPP
+#define SRC_LIBMEASUREMENT_KIT_OONI_COLLECTOR_SESSION_HPP
+
+#include "src/libmeasurement_kit/http/pipeline.hpp"
+
+#include <measurement_kit/ooni.hpp>
+
+#include <deque>
+
+namespace mk {
+namespace ooni {
+namespace collector {
+
+class SessionStats {
+  public:
+    uint64_t connects = 0;
+    uint64_t requests = 0;
+    uint64_t retries = 0;
+};
+
+// A long lived connection to the collector, used to submit many entries
+// without paying the cost of DNS, TCP and TLS setup for each of them.
+//
+// Requests are queued and sent over the current connection, which is
+// established on demand and replaced when it fails or the collector closes
+// it. Because a kept-alive connection may be closed by the collector while
+// idle, a request that fails for network reasons on a reused connection is
+// retried once on a new connection. With `collector_pipeline_depth` greater
+// than one, up to that many requests are pipelined, if the collector seems
+// to support HTTP/1.1 pipelining (see http::Pipeline).
+class Session : public EnableSharedFromThis<Session>,
+                public NonCopyable,
+                public NonMovable {
+  public:
+    // Use make() to construct, because we need to be owned by a SharedPtr
+    Session(Settings settings, SharedPtr<Reactor> reactor,
+            SharedPtr<Logger> logger);
+
+    static SharedPtr<Session> make(Settings settings,
+                                   SharedPtr<Reactor> = Reactor::global(),
+                                   SharedPtr<Logger> = Logger::global());
+
+    void post(std::string append_to_url, std::string body,
+              Callback<Error, Json> cb);
+
+    // Like update_report_serialized() but using this session
+    void update_report(std::string report_id, report::SerializedEntry entry,
+                       Callback<Error> cb);
+
+    // Like close_report() but using this session
+    void close_report(std::string report_id, Callback<Error> cb);
+
+    // Closes the connection, if any. If requests are still in flight, `cb`
+    // is called immediately and the connection is closed after them.
+    void close(Callback<> cb);
+
+    SessionStats stats() const { return stats_; }
+
+  private:
+    class Item {
+      public:
+        Settings settings;
+        http::Headers headers;
+        std::string body;
+        Callback<Error, Json> cb;
+        int attempt = 0;
+    };
+
+    class Connection {
+      public:
+        SharedPtr<net::Transport> txp;
+        SharedPtr<http::Pipeline> pipeline;
+        size_t outstanding = 0;
+        size_t requests = 0;
+        bool dead = false;
+        bool closed = false;
+        bool peer_closed = false;
+    };
+
+    void pump_();
+    void submit_(SharedPtr<Connection> conn, Item item);
+    void retire_(SharedPtr<Connection> conn, Callback<> cb = {});
+
+    bool connecting_ = false;
+    SharedPtr<Connection> conn_;
+    size_t depth_ = 1;
+    SharedPtr<Logger> logger_;
+    std::deque<Item> queue_;
+    SharedPtr<Reactor> reactor_;
+    Settings settings_;
+    SessionStats stats_;
+};
+
+} // namespace collector
+} // namespace ooni
+} // namespace mk
+#endif
@@ -34,6 +34,12 @@ static inline void set_max_redirects(Settings &settings) {
     }
 }
 
+static inline void set_accept_encoding(Settings &settings) {
+    if (settings.find("http/accept_encoding") == settings.end()) {
+        settings["http/accept_encoding"] = "gzip, deflate";
+    }
+}
+
 static inline std::string sanitize_version(const std::string &s) {
     return std::regex_replace(s, std::regex{R"xx([\ \t\r\n]+)xx"}, "");
 }
@@ -53,6 +59,7 @@ void get_latest_release_impl(Callback<Error, std::string> callback,
      *      - Simone (2016-12-06)
      */
     set_max_redirects(settings);
+    set_accept_encoding(settings);
     auto url = get_base_url(settings) + "download/latest/version";
     logger->info("Downloading latest version; please, be patient...");
     http_get(url, [=](Error error, SharedPtr<Response> response) {
@@ -79,6 +86,7 @@ void get_manifest_as_json_impl(
     url += latest;
     url += "/manifest.json";
     set_max_redirects(settings);
+    set_accept_encoding(settings);
     logger->info("Downloading manifest; please, be patient...");
     http_get(url, [=](Error error, SharedPtr<Response> response) {
         Json result;
@@ -123,6 +131,7 @@ void get_resources_for_country_impl(std::string latest, Json manifest,
         return;
     }
     set_max_redirects(settings);
+    set_accept_encoding(settings);
     // TODO: do we need to cross validate latest?
     std::vector<Continuation<Error>> input;
     /*
@@ -0,0 +1,209 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/ooni/resubmitter.hpp"
+#include "src/libmeasurement_kit/report/spool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <map>
+
+namespace mk {
+namespace ooni {
+namespace collector {
+
+using namespace mk::report;
+
+// The entries of a report that need to be resubmitted
+class SpoolGroup {
+  public:
+    std::string collector_base_url;
+    std::deque<SpoolRecord> records;
+    int attempt = 0;
+};
+
+class Resubmitter : public EnableSharedFromThis<Resubmitter>,
+                    public NonCopyable,
+                    public NonMovable {
+  public:
+    SharedPtr<Spool> spool;
+    std::deque<SharedPtr<SpoolGroup>> groups;
+    Settings settings;
+    SharedPtr<Reactor> reactor;
+    SharedPtr<Logger> logger;
+    Callback<Error, ResubmitStats> callback;
+    ResubmitStats stats;
+    Error error;
+    size_t active = 0;
+
+    void run() {
+        size_t concurrency = settings.get("spool_resubmit_concurrency", 2);
+        while (active < std::max(concurrency, (size_t)1) && !groups.empty()) {
+            SharedPtr<SpoolGroup> group = groups.front();
+            groups.pop_front();
+            active += 1;
+            submit(group);
+        }
+        if (active == 0 && groups.empty()) {
+            Error err = spool->compact();
+            if (!error) {
+                error = err;
+            }
+            logger->info("Resubmitted %llu out of %llu entries",
+                         (unsigned long long)stats.submitted,
+                         (unsigned long long)stats.entries);
+            // Note: move the callback out of self to break the cycle
+            Callback<Error, ResubmitStats> cb;
+            std::swap(cb, callback);
+            cb(error, stats);
+        }
+    }
+
+    void submit(SharedPtr<SpoolGroup> group) {
+        SharedPtr<Resubmitter> self = shared_from_this();
+        Settings group_settings = settings;
+        group_settings["collector_base_url"] = group->collector_base_url;
+        submit_group(group, group_settings, [self, group](Error err) {
+            if (!err) {
+                self->active -= 1;
+                self->run();
+                return;
+            }
+            int max_attempts = self->settings.get("spool_resubmit_attempts", 5);
+            if (++group->attempt >= max_attempts) {
+                self->logger->warn("spool: giving up after %d attempts: %s",
+                                   group->attempt, err.what());
+                if (!self->error) {
+                    self->error = err;
+                }
+                self->active -= 1;
+                self->run();
+                return;
+            }
+            double backoff = self->settings.get("spool_resubmit_backoff", 1.0);
+            double delay = std::min(backoff * std::pow(2, group->attempt - 1),
+                                    60.0);
+            self->logger->info("spool: retrying in %.1f seconds after: %s",
+                               delay, err.what());
+            self->stats.retries += 1;
+            self->reactor->call_later(delay, [self, group]() {
+                self->submit(group);
+            });
+        });
+    }
+
+    void submit_group(SharedPtr<SpoolGroup> group, Settings group_settings,
+                      Callback<Error> cb) {
+        SharedPtr<Resubmitter> self = shared_from_this();
+        connect(group_settings, [=](Error err, SharedPtr<net::Transport> txp) {
+            if (err) {
+                cb(err);
+                return;
+            }
+            // Note: the original report may have been closed, so we always
+            // create a new report to resubmit the entries
+            create_report(txp, group->records.front().entry,
+                          [=](Error err, std::string report_id) {
+                              if (err) {
+                                  txp->close([=]() { cb(err); });
+                                  return;
+                              }
+                              self->stats.reports += 1;
+                              self->submit_next(txp, report_id, group,
+                                                group_settings, cb);
+                          },
+                          group_settings, self->reactor, self->logger);
+        }, reactor, logger);
+    }
+
+    void submit_next(SharedPtr<net::Transport> txp, std::string report_id,
+                     SharedPtr<SpoolGroup> group, Settings group_settings,
+                     Callback<Error> cb) {
+        SharedPtr<Resubmitter> self = shared_from_this();
+        if (group->records.empty()) {
+            close_report(txp, report_id,
+                         [=](Error err) { txp->close([=]() { cb(err); }); },
+                         group_settings, reactor, logger);
+            return;
+        }
+        Entry entry = group->records.front().entry;
+        entry["report_id"] = report_id;
+        update_report(txp, report_id, entry, [=](Error err) {
+            if (err) {
+                txp->close([=]() { cb(err); });
+                return;
+            }
+            Error spool_err = self->spool->mark_submitted(
+                  group->records.front());
+            if (spool_err) {
+                // Not fatal: at worst the entry will be submitted twice
+                self->logger->warn("spool: cannot mark entry as submitted");
+            }
+            group->records.pop_front();
+            self->stats.submitted += 1;
+            self->logger->progress(
+                  self->stats.submitted / (double)self->stats.entries,
+                  "resubmitted entry");
+            self->reactor->call_soon([=]() {
+                self->submit_next(txp, report_id, group, group_settings, cb);
+            });
+        }, group_settings, reactor, logger);
+    }
+};
+
+// Entries belonging to the same report are resubmitted together; when the
+// original report could not be opened, use the test name and start time
+static std::string group_key(const SpoolRecord &record) {
+    const Json &entry = record.entry;
+    auto it = entry.find("report_id");
+    if (it != entry.end() && it->is_string() && *it != "") {
+        return record.collector_base_url + " " + it->get<std::string>();
+    }
+    return record.collector_base_url + " " +
+           entry.value("test_name", std::string{}) + " " +
+           entry.value("test_start_time", std::string{});
+}
+
+void resubmit_spool(std::string dirpath,
+                    Callback<Error, ResubmitStats> callback,
+                    Settings settings, SharedPtr<Reactor> reactor,
+                    SharedPtr<Logger> logger) {
+    ErrorOr<SharedPtr<Spool>> spool = Spool::open(dirpath, 1 << 20, logger);
+    if (!spool) {
+        callback(spool.as_error(), {});
+        return;
+    }
+    ErrorOr<std::vector<SpoolRecord>> records = (*spool)->pending();
+    if (!records) {
+        callback(records.as_error(), {});
+        return;
+    }
+    auto resubmitter = SharedPtr<Resubmitter>::make();
+    resubmitter->spool = *spool;
+    resubmitter->settings = settings;
+    resubmitter->reactor = reactor;
+    resubmitter->logger = logger;
+    resubmitter->callback = callback;
+    resubmitter->stats.entries = records->size();
+    std::map<std::string, SharedPtr<SpoolGroup>> groups;
+    for (auto &record : *records) {
+        std::string key = group_key(record);
+        SharedPtr<SpoolGroup> &group = groups[key];
+        if (!group) {
+            group = SharedPtr<SpoolGroup>::make();
+            group->collector_base_url = record.collector_base_url;
+            resubmitter->groups.push_back(group);
+        }
+        group->records.push_back(std::move(record));
+    }
+    logger->info("Found %llu entries to resubmit in %llu reports",
+                 (unsigned long long)records->size(),
+                 (unsigned long long)groups.size());
+    resubmitter->run();
+}
+
+} // namespace collector
+} // namespace ooni
+} // namespace mk
@@ -0,0 +1,40 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+#ifndef SRC_LIBMEASUREMENT_KIT_OONI_RESUBMITTER_HPP
+#define SRC_LIBMEASUREMENT_KIT_OONI_RESUBMITTER_HPP
+
+#include <measurement_kit/ooni.hpp>
+
+namespace mk {
+namespace ooni {
+namespace collector {
+
+class ResubmitStats {
+  public:
+    uint64_t entries = 0;   // Entries found in the spool
+    uint64_t submitted = 0; // Entries successfully resubmitted
+    uint64_t reports = 0;   // Reports created to resubmit entries
+    uint64_t retries = 0;   // Reports that we had to retry
+};
+
+// Resubmits the entries found in the spool at `dirpath` (see report::Spool).
+//
+// Since the original report may have been closed in the meanwhile, entries
+// are submitted into a new report, one for each original report. Up to
+// `spool_resubmit_concurrency` reports are submitted at the same time, and
+// a report that fails is retried after an exponentially growing delay that
+// starts from `spool_resubmit_backoff` seconds, for at most
+// `spool_resubmit_attempts` attempts. Entries that are submitted are marked
+// as such in the spool and are not submitted again, not even if we are
+// interrupted, while the others are left in the spool for later.
+void resubmit_spool(std::string dirpath,
+                    Callback<Error, ResubmitStats> callback,
+                    Settings settings = {},
+                    SharedPtr<Reactor> reactor = Reactor::global(),
+                    SharedPtr<Logger> logger = Logger::global());
+
+} // namespace collector
+} // namespace ooni
+} // namespace mk
+#endif
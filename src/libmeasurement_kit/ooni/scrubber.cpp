@@ -0,0 +1,180 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/ooni/scrubber.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <deque>
+
+#include <event2/util.h>
+
+namespace mk {
+namespace ooni {
+
+Scrubber::Scrubber(std::vector<std::string> patterns, std::string replacement)
+    : replacement_{std::move(replacement)} {
+    patterns.erase(std::remove(patterns.begin(), patterns.end(), ""),
+                   patterns.end());
+    patterns_ = patterns.size();
+    if (patterns_ == 0) {
+        return;
+    }
+    for (auto &pattern : patterns) {
+        for (unsigned char c : pattern) {
+            if (classes_[c] == 0) {
+                classes_[c] = (uint16_t)num_classes_++;
+            }
+        }
+    }
+
+    // Build the trie, where -1 means that there is no transition yet
+    std::vector<int> fail;
+    auto add_state = [&]() {
+        delta_.resize(delta_.size() + num_classes_, -1);
+        match_.push_back(0);
+        fail.push_back(0);
+        return (int)match_.size() - 1;
+    };
+    add_state(); // root
+    for (auto &pattern : patterns) {
+        int state = 0;
+        for (unsigned char c : pattern) {
+            int &next = delta_[state * num_classes_ + classes_[c]];
+            if (next == -1) {
+                int created = add_state(); // Note: invalidates `next`
+                delta_[state * num_classes_ + classes_[c]] = created;
+            }
+            state = delta_[state * num_classes_ + classes_[c]];
+        }
+        match_[state] = pattern.size();
+    }
+
+    // Turn the trie into a DFA by computing the failure links breadth first
+    // and replacing each missing transition with that of the failure state
+    std::deque<int> queue;
+    for (size_t c = 0; c < num_classes_; ++c) {
+        int &next = delta_[c];
+        if (next == -1) {
+            next = 0;
+        } else {
+            fail[next] = 0;
+            queue.push_back(next);
+        }
+    }
+    while (!queue.empty()) {
+        int state = queue.front();
+        queue.pop_front();
+        // A state matches its longest pattern or that of its failure state
+        match_[state] = std::max(match_[state], match_[fail[state]]);
+        for (size_t c = 0; c < num_classes_; ++c) {
+            int &next = delta_[state * num_classes_ + c];
+            int fallback = delta_[fail[state] * num_classes_ + c];
+            if (next == -1) {
+                next = fallback;
+            } else {
+                fail[next] = fallback;
+                queue.push_back(next);
+            }
+        }
+    }
+}
+
+/* static */ Scrubber Scrubber::for_probe_ip(std::string ip) {
+    std::vector<std::string> patterns{ip};
+    unsigned char addr[16];
+    if (evutil_inet_pton(AF_INET6, ip.c_str(), addr) == 1) {
+        char buf[64];
+        if (evutil_inet_ntop(AF_INET6, addr, buf, sizeof(buf)) != nullptr) {
+            patterns.push_back(buf); // Compressed form
+        }
+        std::string expanded, uncompressed;
+        for (size_t i = 0; i < sizeof(addr); i += 2) {
+            unsigned group = (addr[i] << 8) | addr[i + 1];
+            snprintf(buf, sizeof(buf), "%s%04x", (i > 0) ? ":" : "", group);
+            expanded += buf;
+            snprintf(buf, sizeof(buf), "%s%x", (i > 0) ? ":" : "", group);
+            uncompressed += buf;
+        }
+        patterns.push_back(expanded);
+        patterns.push_back(uncompressed);
+        for (size_t i = 0, n = patterns.size(); i < n; ++i) {
+            std::string upper = patterns[i];
+            std::transform(upper.begin(), upper.end(), upper.begin(),
+                           [](unsigned char c) { return toupper(c); });
+            std::string lower = patterns[i];
+            std::transform(lower.begin(), lower.end(), lower.begin(),
+                           [](unsigned char c) { return tolower(c); });
+            patterns.push_back(upper);
+            patterns.push_back(lower);
+        }
+        std::sort(patterns.begin(), patterns.end());
+        patterns.erase(std::unique(patterns.begin(), patterns.end()),
+                       patterns.end());
+    }
+    return Scrubber{patterns};
+}
+
+size_t Scrubber::scrub(const std::string &in, std::string &out) const {
+    if (empty()) {
+        return 0;
+    }
+    size_t count = 0;
+    size_t copied = 0; // Bytes of `in` already processed into `out`
+    int state = 0;
+    for (size_t i = 0; i < in.size(); ++i) {
+        state = delta_[state * num_classes_ + classes_[(unsigned char)in[i]]];
+        size_t length = match_[state];
+        if (length == 0) {
+            continue;
+        }
+        if (count++ == 0) {
+            out.clear();
+            out.reserve(in.size());
+        }
+        // Since we restart from the root after each match, the match cannot
+        // begin before the end of the previous one
+        out.append(in, copied, i + 1 - length - copied);
+        out.append(replacement_);
+        copied = i + 1;
+        state = 0;
+    }
+    if (count > 0) {
+        out.append(in, copied, std::string::npos);
+    }
+    return count;
+}
+
+std::string Scrubber::scrub(const std::string &in) const {
+    std::string out;
+    if (scrub(in, out) == 0) {
+        return in;
+    }
+    return out;
+}
+
+size_t Scrubber::scrub_entry(report::Entry &entry) const {
+    return scrub_json_(entry);
+}
+
+size_t Scrubber::scrub_json_(Json &json) const {
+    size_t count = 0;
+    if (json.is_string()) {
+        std::string &s = json.get_ref<std::string &>();
+        std::string out;
+        count = scrub(s, out);
+        if (count > 0) {
+            s.swap(out);
+        }
+    } else if (json.is_object() || json.is_array()) {
+        for (auto &value : json) {
+            count += scrub_json_(value);
+        }
+    }
+    return count;
+}
+
+} // namespace ooni
+} // namespace mk
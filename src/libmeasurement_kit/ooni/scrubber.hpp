@@ -0,0 +1,58 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+#ifndef SRC_LIBMEASUREMENT_KIT_OONI_SCRUBBER_HPP
+#define SRC_LIBMEASUREMENT_KIT_OONI_SCRUBBER_HPP
+
+#include <measurement_kit/report.hpp>
+
+#include <array>
+#include <vector>
+
+namespace mk {
+namespace ooni {
+
+// Replaces all the occurrences of a set of patterns with "[REDACTED]".
+//
+// The patterns are compiled into an Aho-Corasick automaton, such that a
+// string is scanned once regardless of the number of patterns, and it is
+// copied only if it contains at least one match. When matches overlap,
+// the match that ends first wins, and the scan restarts after it.
+class Scrubber {
+  public:
+    Scrubber() = default;
+
+    explicit Scrubber(std::vector<std::string> patterns,
+                      std::string replacement = "[REDACTED]");
+
+    // Builds a scrubber for `ip` and, if it is an IPv6 address, also for
+    // its other textual representations (compressed, expanded, uppercase).
+    static Scrubber for_probe_ip(std::string ip);
+
+    bool empty() const { return patterns_ == 0; }
+
+    // Returns the number of matches and, only if there were matches,
+    // writes into `out` the scrubbed copy of `in`.
+    size_t scrub(const std::string &in, std::string &out) const;
+
+    std::string scrub(const std::string &in) const;
+
+    // Scrubs all the strings, except object keys, inside `entry`.
+    size_t scrub_entry(report::Entry &entry) const;
+
+  private:
+    size_t scrub_json_(Json &json) const;
+
+    // Bytes are mapped to classes, where class zero means that the byte does
+    // not appear in any pattern, to keep the transition table small.
+    std::array<uint16_t, 256> classes_{};
+    size_t num_classes_ = 1;
+    std::vector<int> delta_;       // state * num_classes_ + class -> state
+    std::vector<size_t> match_;    // state -> length of match, or zero
+    size_t patterns_ = 0;
+    std::string replacement_;
+};
+
+} // namespace ooni
+} // namespace mk
+#endif
@@ -7,6 +7,7 @@
 #include <event2/dns.h>
 
 #include "src/libmeasurement_kit/net/emitter.hpp"
+#include "src/libmeasurement_kit/ooni/scrubber.hpp"
 #include "src/libmeasurement_kit/ooni/utils.hpp"
 
 namespace mk {
@@ -97,6 +98,37 @@ void dns_query(SharedPtr<Entry> entry, dns::QueryType query_type,
                options, reactor);
 }
 
+// Represent the timings of a request as seconds elapsed since the first event
+// we know about, because the absolute value of a monotonic clock is useless.
+static Entry represent_timings(const http::ResponseTimings &t) {
+    double origin = 0.0;
+    for (double x : {t.connect.dns_start, t.request_written}) {
+        if (x != 0.0) {
+            origin = x;
+            break;
+        }
+    }
+    auto rel = [&](double x) -> Entry {
+        if (x == 0.0) {
+            return nullptr;
+        }
+        return x - origin;
+    };
+    Entry attempts = Entry::array();
+    for (auto &a : t.connect.connect_attempts) {
+        attempts.push_back({{"start", rel(a.start)}, {"end", rel(a.end)}});
+    }
+    return Entry{{"dns_start", rel(t.connect.dns_start)},
+                 {"dns_end", rel(t.connect.dns_end)},
+                 {"connect_attempts", attempts},
+                 {"tls_handshake_start", rel(t.connect.tls_handshake_start)},
+                 {"tls_handshake_end", rel(t.connect.tls_handshake_end)},
+                 {"request_written", rel(t.request_written)},
+                 {"first_byte", rel(t.first_byte)},
+                 {"headers_complete", rel(t.headers_complete)},
+                 {"body_complete", rel(t.body_complete)}};
+}
+
 void http_request(SharedPtr<Entry> entry, Settings settings, http::Headers headers,
                   std::string body, Callback<Error, SharedPtr<http::Response>> cb,
                   SharedPtr<Reactor> reactor, SharedPtr<Logger> logger) {
@@ -119,12 +151,13 @@ void http_request(SharedPtr<Entry> entry, Settings settings, http::Headers heade
      * entry; see issue #1110 for plans to make this better.
      */
     std::string probe_ip = settings.get("real_probe_ip_", std::string{});
-    auto redact = [=](std::string s) {
-        if (probe_ip != "" && !settings.get("save_real_probe_ip", false)) {
-            s = mk::ooni::scrub(s, probe_ip);
-        }
-        return s;
-    };
+    bool save_timings = settings.get("save_http_timings", false);
+    // Compile the patterns once for all the fields of this request
+    Scrubber scrubber;
+    if (probe_ip != "" && !settings.get("save_real_probe_ip", false)) {
+        scrubber = Scrubber::for_probe_ip(probe_ip);
+    }
+    auto redact = [=](const std::string &s) { return scrubber.scrub(s); };
 
     http::request(
         settings, headers, body,
@@ -156,7 +189,7 @@ void http_request(SharedPtr<Entry> entry, Settings settings, http::Headers heade
                      * Note: `probe_ip` comes from an external service, hence
                      * we MUST call `represent_string` _after_ `redact()`.
                      */
-                    for (auto pair : response->headers) {
+                    for (auto &pair : response->headers) {
                         rr["response"]["headers"][pair.first] =
                             represent_string(redact(pair.second));
                     }
@@ -168,7 +201,7 @@ void http_request(SharedPtr<Entry> entry, Settings settings, http::Headers heade
 
                     auto request = response->request;
                     // Note: we checked above that we can deref `request`
-                    for (auto pair : request->headers) {
+                    for (auto &pair : request->headers) {
                         rr["request"]["headers"][pair.first] =
                             represent_string(redact(pair.second));
                     }
@@ -184,6 +217,9 @@ void http_request(SharedPtr<Entry> entry, Settings settings, http::Headers heade
                         "is_tor", false
                     }};
                 }
+                if (!!response && save_timings) {
+                    rr["timings"] = represent_timings(response->timings);
+                }
                 return rr;
             };
 
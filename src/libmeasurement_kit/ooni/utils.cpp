@@ -3,6 +3,7 @@
 // and LICENSE for more information on the copying conditions.
 
 #include <measurement_kit/ooni/orchestrate.hpp> // for orchestrate::Client
+#include "src/libmeasurement_kit/ooni/scrubber.hpp"
 #include "src/libmeasurement_kit/ooni/utils_impl.hpp"
 #include "src/libmeasurement_kit/common/utils.hpp"
 
@@ -176,11 +177,8 @@ report::Entry represent_string(const std::string &s) {
 }
 
 std::string scrub(std::string s, std::string real_probe_ip) {
-    size_t p = 0;
-    while ((p = s.find(real_probe_ip, p)) != std::string::npos) {
-        s = s.replace(p, real_probe_ip.size(), "[REDACTED]");
-    }
-    return s;
+    // Note: when scrubbing many strings, use a single Scrubber instead
+    return Scrubber::for_probe_ip(real_probe_ip).scrub(s);
 }
 
 } // namespace ooni
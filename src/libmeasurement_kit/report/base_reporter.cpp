@@ -36,6 +36,11 @@ Continuation<Error> BaseReporter::do_open_(Continuation<Error> cc) {
 
 Continuation<Error>
 BaseReporter::do_write_entry_(Entry entry, Continuation<Error> cc) {
+    return do_write_entry_(SerializedEntry::make(std::move(entry)), cc);
+}
+
+Continuation<Error>
+BaseReporter::do_write_entry_(SerializedEntry entry, Continuation<Error> cc) {
     return [=](Callback<Error> cb) {
         if (!openned_) {
             cb(ReportNotOpenError());
@@ -45,10 +50,10 @@ BaseReporter::do_write_entry_(Entry entry, Continuation<Error> cc) {
             cb(ReportAlreadyClosedError());
             return;
         }
-        // On success we save the serialization of the previous entry such
-        // that submitting more than once the same entry is idempontent
-        std::string serio = entry.dump();
-        if (serio == prev_entry_) {
+        // On success we save the hash of the previous entry such that
+        // submitting more than once the same entry is idempontent
+        std::string hash = entry.hash();
+        if (hash == prev_entry_hash_) {
             cb(NoError(DuplicateEntrySubmitError()));
             return;
         }
@@ -57,7 +62,7 @@ BaseReporter::do_write_entry_(Entry entry, Continuation<Error> cc) {
                 cb(error);
                 return;
             }
-            prev_entry_ = serio; // Only on success to allow resubmit
+            prev_entry_hash_ = hash; // Only on success to allow resubmit
             cb(NoError());
         });
     };
@@ -0,0 +1,260 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/report/buffered_file_writer.hpp"
+#include "src/libmeasurement_kit/common/utils.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace mk {
+namespace report {
+
+ErrorOr<Durability> parse_durability(std::string s) {
+    if (s == "none") {
+        return {NoError(), Durability::NONE};
+    }
+    if (s == "interval") {
+        return {NoError(), Durability::INTERVAL};
+    }
+    if (s == "entry") {
+        return {NoError(), Durability::ENTRY};
+    }
+    return {ValueError(), {}};
+}
+
+/* static */ SharedPtr<BufferedFileWriter>
+BufferedFileWriter::make(SharedPtr<Reactor> reactor, SharedPtr<Logger> logger) {
+    return SharedPtr<BufferedFileWriter>{
+          std::make_shared<BufferedFileWriter>(reactor, logger)};
+}
+
+BufferedFileWriter::BufferedFileWriter(SharedPtr<Reactor> reactor,
+                                       SharedPtr<Logger> logger)
+    : logger_{std::move(logger)}, reactor_{std::move(reactor)} {}
+
+BufferedFileWriter::~BufferedFileWriter() {
+    // Normally close() has already done this. If not, we still flush the
+    // buffer but we cannot invoke any callback, since we are going away.
+    if (thread_.joinable()) {
+        {
+            std::unique_lock<std::mutex> _{mutex_};
+            closing_ = true;
+            for (auto &w : waiters_) {
+                w.cb = nullptr;
+            }
+        }
+        cond_.notify_one();
+        thread_.join();
+    }
+    if (fd_ != -1) {
+        ::close(fd_);
+    }
+}
+
+Error BufferedFileWriter::open(std::string path, bool append) {
+    if (fd_ != -1 || closing_) {
+        return ReportAlreadyOpenError();
+    }
+#ifdef _WIN32
+    static const int flags = O_WRONLY | O_CREAT | O_BINARY;
+#else
+    static const int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+#endif
+    fd_ = ::open(path.c_str(), flags | (append ? O_APPEND : O_TRUNC), 0644);
+    if (fd_ == -1) {
+        logger_->warn("report: cannot open '%s': %s", path.c_str(),
+                      strerror(errno));
+        return ReportIoError();
+    }
+    thread_ = std::thread{[this]() { loop_(); }};
+    return NoError();
+}
+
+void BufferedFileWriter::write(std::string data, size_t entries,
+                               Callback<Error> &&cb) {
+    std::unique_lock<std::mutex> lock{mutex_};
+    if (error_ || closing_ || fd_ == -1) {
+        Error error = error_ ? error_ : Error{ReportNotOpenError()};
+        lock.unlock();
+        cb(error);
+        return;
+    }
+    buffer_ += data;
+    // Note: blocking the callback when the buffer is over its size provides
+    // backpressure to writers that are faster than the disk
+    bool blocks = durability == Durability::ENTRY ||
+                  buffer_.size() > buffer_size;
+    Waiter waiter;
+    waiter.queued = mk::monotonic_time_now();
+    waiter.entries = entries;
+    if (blocks) {
+        waiter.cb = std::move(cb);
+        ++blocked_;
+    }
+    waiters_.push_back(std::move(waiter));
+    if (blocks || buffer_.size() >= buffer_size) {
+        cond_.notify_one();
+    }
+    lock.unlock();
+    if (!blocks) {
+        cb(NoError());
+    }
+}
+
+void BufferedFileWriter::close(Callback<Error> &&cb) {
+    if (thread_.joinable()) {
+        {
+            std::unique_lock<std::mutex> _{mutex_};
+            closing_ = true;
+        }
+        cond_.notify_one();
+        thread_.join(); // Waits for the final commit
+    }
+    Error error;
+    {
+        std::unique_lock<std::mutex> _{mutex_};
+        closing_ = true;
+        error = error_;
+    }
+    if (fd_ != -1) {
+        if (::close(fd_) != 0 && !error) {
+            error = ReportIoError();
+        }
+        fd_ = -1;
+    }
+    // Use call_soon() so that the close callback is ordered after the write
+    // callbacks that the background thread has already scheduled
+    reactor_->call_soon([ cb = std::move(cb), error ]() { cb(error); });
+}
+
+FileReporterStats BufferedFileWriter::stats() {
+    std::unique_lock<std::mutex> _{mutex_};
+    return stats_;
+}
+
+void BufferedFileWriter::loop_() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    double last_commit = mk::monotonic_time_now();
+    for (;;) {
+        double remaining = last_commit + flush_interval - mk::monotonic_time_now();
+        cond_.wait_for(lock,
+                       std::chrono::duration<double>(std::max(remaining, 0.0)),
+                       [this]() {
+                           return closing_ || blocked_ > 0 ||
+                                  buffer_.size() >= buffer_size;
+                       });
+        double now = mk::monotonic_time_now();
+        bool expired = now >= last_commit + flush_interval;
+        bool sync = durability == Durability::ENTRY ||
+                    (durability == Durability::INTERVAL && (expired || closing_));
+        if (buffer_.empty() && !(sync && dirty_)) {
+            if (closing_) {
+                break;
+            }
+            if (expired) {
+                last_commit = now;
+            }
+            continue;
+        }
+        if (!expired && !closing_ && blocked_ == 0 &&
+            buffer_.size() < buffer_size) {
+            continue; // Spurious wakeup
+        }
+
+        // Group commit: take everything queued so far and write it
+        // with a single write() and (possibly) a single fsync()
+        std::string data;
+        data.swap(buffer_);
+        std::vector<Waiter> waiters;
+        waiters.swap(waiters_);
+        blocked_ = 0;
+        Error error = error_;
+        lock.unlock();
+        double elapsed = 0.0;
+        if (!error) {
+            error = commit_(data, sync, elapsed);
+        }
+        double done = mk::monotonic_time_now();
+        lock.lock();
+
+        if (error && !error_) {
+            error_ = error;
+        }
+        if (!error) {
+            stats_.bytes += data.size();
+            stats_.commits += 1;
+            stats_.fsyncs += sync ? 1 : 0;
+            stats_.commit_latency_total += elapsed;
+            stats_.commit_latency_max =
+                  std::max(stats_.commit_latency_max, elapsed);
+            for (auto &w : waiters) {
+                double latency = done - w.queued;
+                stats_.entries += w.entries;
+                stats_.entry_latency_total += latency;
+                stats_.entry_latency_max =
+                      std::max(stats_.entry_latency_max, latency);
+            }
+        }
+        dirty_ = !error && !sync;
+        last_commit = done;
+        for (auto &w : waiters) {
+            if (w.cb) {
+                reactor_->call_soon([ cb = std::move(w.cb), error ]() {
+                    cb(error);
+                });
+            }
+        }
+    }
+}
+
+Error BufferedFileWriter::commit_(const std::string &data, bool sync,
+                                  double &elapsed) {
+    double begin = mk::monotonic_time_now();
+    const char *base = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+#ifdef _WIN32
+        int n = ::_write(fd_, base, (unsigned int)std::min(left, (size_t)INT_MAX));
+#else
+        ssize_t n = ::write(fd_, base, left);
+#endif
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            logger_->warn("report: write() failed: %s", strerror(errno));
+            return ReportIoError();
+        }
+        base += n;
+        left -= (size_t)n;
+    }
+    if (sync) {
+#ifdef _WIN32
+        int rv = ::_commit(fd_);
+#else
+        int rv = ::fsync(fd_);
+#endif
+        if (rv != 0) {
+            logger_->warn("report: fsync() failed: %s", strerror(errno));
+            return ReportIoError();
+        }
+    }
+    elapsed = mk::monotonic_time_now() - begin;
+    return NoError();
+}
+
+} // namespace report
+} // namespace mk
@@ -0,0 +1,91 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+#ifndef SRC_LIBMEASUREMENT_KIT_REPORT_BUFFERED_FILE_WRITER_HPP
+#define SRC_LIBMEASUREMENT_KIT_REPORT_BUFFERED_FILE_WRITER_HPP
+
+#include <measurement_kit/report.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mk {
+namespace report {
+
+// How much a BufferedFileWriter cares about data hitting the disk.
+enum class Durability {
+    NONE,     // never fsync(), leave it to the kernel
+    INTERVAL, // fsync() every `flush_interval` seconds and at close
+    ENTRY     // fsync() before reporting each write as complete
+};
+
+ErrorOr<Durability> parse_durability(std::string s);
+
+// Appends data to a file using a large user-space buffer that is written
+// (and possibly fsync()ed) by a background thread. Writes queued while the
+// thread is busy are committed together with a single write() and fsync().
+//
+// Callbacks are always invoked in the reactor thread. With Durability::ENTRY,
+// or when the buffer is over `buffer_size`, a write completes only after its
+// data has been written (and synced); otherwise it completes immediately and
+// any error is reported by subsequent writes and by close().
+class BufferedFileWriter : public NonCopyable, public NonMovable {
+  public:
+    static SharedPtr<BufferedFileWriter> make(SharedPtr<Reactor> reactor,
+                                              SharedPtr<Logger> logger);
+
+    BufferedFileWriter(SharedPtr<Reactor> reactor, SharedPtr<Logger> logger);
+
+    ~BufferedFileWriter();
+
+    // If `append` is true, the file is not truncated
+    Error open(std::string path, bool append = false);
+
+    // `entries` is the number of entries in `data`, used for statistics
+    void write(std::string data, size_t entries, Callback<Error> &&cb);
+
+    void close(Callback<Error> &&cb);
+
+    FileReporterStats stats();
+
+    size_t buffer_size = 1 << 20;
+    double flush_interval = 1.0;
+    Durability durability = Durability::NONE;
+
+  private:
+    // One for each write; `cb` is empty when the write has already been
+    // reported as complete to the caller
+    class Waiter {
+      public:
+        double queued = 0.0;
+        size_t entries = 0;
+        Callback<Error> cb;
+    };
+
+    void loop_();
+    Error commit_(const std::string &data, bool sync, double &elapsed);
+
+    // Only accessed by the background thread (and by open/close when
+    // such thread is not running)
+    int fd_ = -1;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::string buffer_;
+    std::vector<Waiter> waiters_;
+    size_t blocked_ = 0; // waiters with a callback
+    Error error_;
+    bool closing_ = false;
+    bool dirty_ = false; // written but not yet synced
+    FileReporterStats stats_;
+
+    std::thread thread_;
+    SharedPtr<Logger> logger_;
+    SharedPtr<Reactor> reactor_;
+};
+
+} // namespace report
+} // namespace mk
+#endif
@@ -2,6 +2,9 @@
 // Measurement Kit is free software under the BSD license. See AUTHORS
 // and LICENSE for more information on the copying conditions.
 
+#include "src/libmeasurement_kit/common/json_writer.hpp"
+#include "src/libmeasurement_kit/common/utils.hpp"
+
 #include <measurement_kit/report.hpp>
 
 namespace mk {
@@ -32,7 +35,7 @@ Entry &Entry::operator=(std::initializer_list<Json> t) {
 
 void Entry::push_back(Entry value) {
     try {
-        Json::push_back(value);
+        Json::push_back(move_(value));
     } catch (const std::domain_error &) {
         throw JsonDomainError();
     }
@@ -62,5 +65,20 @@ bool Entry::operator!=(std::nullptr_t right) const noexcept {
     return static_cast<const Json &>(*this) != right;
 }
 
+/* static */ SerializedEntry SerializedEntry::make(Entry entry) {
+    SerializedEntry se;
+    StringSink sink{*se.data_};
+    (void)write_json(entry, sink); // Cannot fail
+    Sha256Sink hash;
+    (void)hash.write(*se.data_); // Cannot fail
+    se.hash_ = hash.hexdigest();
+    se.entry_ = SharedPtr<Entry>::make(std::move(entry));
+    return se;
+}
+
+Error SerializedEntry::write(JsonSink &sink) const {
+    return sink.write(*data_);
+}
+
 } // namespace report
 } // namespace mk
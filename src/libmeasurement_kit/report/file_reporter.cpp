@@ -2,11 +2,41 @@
 // Measurement Kit is free software under the BSD license. See AUTHORS
 // and LICENSE for more information on the copying conditions.
 
+#include "src/libmeasurement_kit/common/json_writer.hpp"
+#include "src/libmeasurement_kit/report/buffered_file_writer.hpp"
+#include "src/libmeasurement_kit/report/gzip_frame.hpp"
+
 #include <measurement_kit/report.hpp>
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 namespace mk {
 namespace report {
 
+// Counts the bytes written into another sink
+class CountingSink : public JsonSink {
+  public:
+    explicit CountingSink(JsonSink &sink) : sink_{sink} {}
+
+    using JsonSink::write;
+
+    Error write(const char *base, size_t count) override {
+        bytes += count;
+        return sink_.write(base, count);
+    }
+
+    uint64_t bytes = 0;
+
+  private:
+    JsonSink &sink_;
+};
+
 static Error map_error(std::ostream &file) {
     if (file.eof()) {
         return ReportEofError();
@@ -26,13 +56,119 @@ static Error map_error(std::ostream &file) {
     return reporter.as<BaseReporter>();
 }
 
+/* static */ SharedPtr<BaseReporter> FileReporter::make(
+      std::string s, Settings settings, SharedPtr<Reactor> reactor,
+      SharedPtr<Logger> logger) {
+    SharedPtr<FileReporter> reporter(new FileReporter);
+    reporter->filename = s;
+    reporter->settings = settings;
+    reporter->reactor = reactor;
+    reporter->logger = logger;
+    return reporter.as<BaseReporter>();
+}
+
+FileReporter::~FileReporter() {}
+
+FileReporterStats FileReporter::stats() const {
+    return writer ? writer->stats() : plain_stats;
+}
+
+// Truncates the report to `size` bytes, such that we can append entries
+// after the last one that was known to be written (see `resume`)
+static Error truncate_file(const std::string &path, uint64_t size,
+                           SharedPtr<Logger> logger) {
+    struct stat sb{};
+    if (stat(path.c_str(), &sb) != 0 || (uint64_t)sb.st_size < size) {
+        logger->warn("report: cannot resume '%s': missing or too short",
+                     path.c_str());
+        return ReportIoError();
+    }
+#ifdef _WIN32
+    int fd = ::_open(path.c_str(), _O_WRONLY | _O_BINARY);
+    int rv = (fd == -1) ? -1 : ::_chsize_s(fd, (__int64)size);
+    if (fd != -1) {
+        ::_close(fd);
+    }
+#else
+    int rv = ::truncate(path.c_str(), (off_t)size);
+#endif
+    if (rv != 0) {
+        logger->warn("report: cannot truncate '%s'", path.c_str());
+        return ReportIoError();
+    }
+    return NoError();
+}
+
+static bool ends_with(const std::string &s, const std::string &suffix) {
+    return s.size() >= suffix.size() &&
+           s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
 Continuation<Error> FileReporter::open(Report &) {
     return do_open_([=](Callback<Error> cb) {
+        std::string compression = settings.get(
+              "file_report_compression",
+              std::string{ends_with(filename, ".gz") ? "gzip" : "none"});
+        if (compression == "gzip") {
+            ErrorOr<size_t> n = settings.get_noexcept(
+                  "file_report_frame_entries", (size_t)100);
+            if (!n || *n <= 0) {
+                cb(ValueError());
+                return;
+            }
+            frame_entries = *n;
+        } else if (compression != "none") {
+            cb(ValueError());
+            return;
+        }
         if (filename == "-") {
             cb(NoError());
             return;
         }
-        file.open(filename);
+        bool append = settings.find("file_report_resume_offset") !=
+                      settings.end();
+        if (append) {
+            ErrorOr<uint64_t> offset = settings.get_noexcept(
+                  "file_report_resume_offset", (uint64_t)0);
+            if (!offset) {
+                cb(offset.as_error());
+                return;
+            }
+            Error err = truncate_file(filename, *offset, logger);
+            if (err) {
+                cb(err);
+                return;
+            }
+        }
+        ErrorOr<size_t> buffer_size = settings.get_noexcept(
+              "file_report_buffer_size", (size_t)0);
+        if (!buffer_size) {
+            cb(buffer_size.as_error());
+            return;
+        }
+        if (*buffer_size > 0) {
+            ErrorOr<Durability> durability = parse_durability(
+                  settings.get("file_report_durability", std::string{"none"}));
+            ErrorOr<double> interval = settings.get_noexcept(
+                  "file_report_flush_interval", 1.0);
+            if (!durability || !interval) {
+                cb(ValueError());
+                return;
+            }
+            auto w = BufferedFileWriter::make(reactor, logger);
+            w->buffer_size = *buffer_size;
+            w->durability = *durability;
+            w->flush_interval = *interval;
+            Error err = w->open(filename, append);
+            if (!err) {
+                writer = w;
+            }
+            cb(err);
+            return;
+        }
+        std::ios::openmode mode = (frame_entries > 0) ? std::ios::binary
+                                                      : std::ios::out;
+        file.open(filename, append ? (mode | std::ios::app) : mode);
         if (!file.good()) {
             cb(map_error(file));
             return;
@@ -42,31 +178,151 @@ Continuation<Error> FileReporter::open(Report &) {
 }
 
 Continuation<Error> FileReporter::write_entry(Entry entry) {
+    return write_entry(SerializedEntry::make(std::move(entry)));
+}
+
+Continuation<Error> FileReporter::write_entry(SerializedEntry entry) {
     return do_write_entry_(entry, [=](Callback<Error> cb) {
-        std::ostream &frf = (filename == "-") ? std::cout : file;
-        frf << entry.dump() << std::endl;
-        if (!frf.good()) {
-            cb(map_error(frf));
+        if (frame_entries <= 0) {
+            write_(entry, std::move(cb));
+            return;
+        }
+        // Entries are acked before being written, so, after an error, we
+        // refuse to write more, lest the report silently lacks entries
+        if (frame_error) {
+            cb(frame_error);
+            return;
+        }
+        // Stream the entry into the compressor, so that we only keep in
+        // memory the compressed frame
+        if (!frame) {
+            frame.reset(new GzipFrameWriter);
+        }
+        Error err = entry.write(*frame);
+        if (!err) {
+            err = frame->write("\n");
+        }
+        if (err) {
+            frame.reset();
+            frame_count = 0;
+            frame_error = err;
+            cb(err);
+            return;
+        }
+        if (++frame_count < frame_entries) {
+            cb(NoError());
             return;
         }
+        flush_frame_(std::move(cb));
+    });
+}
+
+void FileReporter::write_(const SerializedEntry &entry, Callback<Error> &&cb) {
+    if (writer) {
+        std::string data;
+        StringSink sink{data};
+        (void)entry.write(sink); // Cannot fail
+        data += "\n";
+        writer->write(std::move(data), 1, std::move(cb));
+        return;
+    }
+    std::ostream &frf = (filename == "-") ? std::cout : file;
+    OstreamSink ostream_sink{frf};
+    CountingSink sink{ostream_sink};
+    if (!entry.write(sink)) {
+        frf << "\n" << std::flush;
+    }
+    if (!frf.good()) {
+        cb(map_error(frf));
+        return;
+    }
+    plain_stats.entries += 1;
+    plain_stats.bytes += sink.bytes + 1;
+    cb(NoError());
+}
+
+void FileReporter::write_(std::string data, size_t entries,
+                          Callback<Error> &&cb) {
+    if (writer) {
+        writer->write(std::move(data), entries, std::move(cb));
+        return;
+    }
+    std::ostream &frf = (filename == "-") ? std::cout : file;
+    frf << data << std::flush;
+    if (!frf.good()) {
+        cb(map_error(frf));
+        return;
+    }
+    plain_stats.entries += entries;
+    plain_stats.bytes += data.size();
+    cb(NoError());
+}
+
+void FileReporter::flush_frame_(Callback<Error> &&cb) {
+    if (frame_error) {
+        cb(frame_error);
+        return;
+    }
+    if (frame_count <= 0) {
         cb(NoError());
+        return;
+    }
+    ErrorOr<std::string> compressed = frame->finish();
+    size_t entries = frame_count;
+    frame.reset();
+    frame_count = 0;
+    if (!compressed) {
+        frame_error = compressed.as_error();
+        cb(frame_error);
+        return;
+    }
+    write_(std::move(*compressed), entries, [=](Error err) {
+        if (err) {
+            frame_error = err;
+        }
+        cb(err);
     });
 }
 
 Continuation<Error> FileReporter::close() {
     return do_close_([=](Callback<Error> cb) {
-        if (filename == "-") {
-            cb(NoError());
-            return;
-        }
-        file.close();
-        if (!file.good()) {
-            cb(map_error(file));
-            return;
-        }
-        cb(NoError());
+        flush_frame_([=](Error err) {
+            if (err) {
+                cb(err);
+                return;
+            }
+            close_(cb);
+        });
     });
 }
 
+void FileReporter::close_(Callback<Error> cb) {
+    if (filename == "-") {
+        cb(NoError());
+        return;
+    }
+    if (writer) {
+        writer->close([=](Error err) {
+            FileReporterStats st = writer->stats();
+            logger->debug("report: wrote %llu entries (%llu bytes) with "
+                          "%llu commits and %llu fsyncs; max commit "
+                          "latency %f s; max entry latency %f s",
+                          (unsigned long long)st.entries,
+                          (unsigned long long)st.bytes,
+                          (unsigned long long)st.commits,
+                          (unsigned long long)st.fsyncs,
+                          st.commit_latency_max, st.entry_latency_max);
+            cb(err);
+        });
+        return;
+    }
+    file.close();
+    if (!file.good()) {
+        cb(map_error(file));
+        return;
+    }
+    cb(NoError());
+}
+
 } // namespace report
 } // namespace mk
@@ -0,0 +1,83 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/report/gzip_frame.hpp"
+
+#include <algorithm>
+
+namespace mk {
+namespace report {
+
+ErrorOr<std::string> gzip_frame(const std::string &data, int level) {
+    z_stream stream{};
+    // Note: adding 16 to the window bits selects the gzip wrapper
+    if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        return {ReportLogicalError(), {}};
+    }
+    std::string out;
+    out.resize(deflateBound(&stream, (uLong)data.size()));
+    stream.next_in = (Bytef *)data.data();
+    stream.avail_in = (uInt)data.size();
+    stream.next_out = (Bytef *)&out[0];
+    stream.avail_out = (uInt)out.size();
+    // Since the output buffer is as large as deflateBound(), a single call
+    // with Z_FINISH is guaranteed to compress all the input.
+    int ret = deflate(&stream, Z_FINISH);
+    size_t total = stream.total_out;
+    deflateEnd(&stream);
+    if (ret != Z_STREAM_END) {
+        return {ReportLogicalError(), {}};
+    }
+    out.resize(total);
+    return {NoError(), std::move(out)};
+}
+
+GzipFrameWriter::GzipFrameWriter(int level) {
+    if (deflateInit2(&stream_, level, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        error_ = ReportLogicalError();
+    }
+}
+
+GzipFrameWriter::~GzipFrameWriter() { deflateEnd(&stream_); }
+
+Error GzipFrameWriter::write(const char *base, size_t count) {
+    return deflate_(base, count, Z_NO_FLUSH);
+}
+
+ErrorOr<std::string> GzipFrameWriter::finish() {
+    Error err = deflate_(nullptr, 0, Z_FINISH);
+    if (err) {
+        return {err, {}};
+    }
+    return {NoError(), std::move(out_)};
+}
+
+Error GzipFrameWriter::deflate_(const char *base, size_t count, int flush) {
+    if (error_) {
+        return error_;
+    }
+    stream_.next_in = (Bytef *)base;
+    stream_.avail_in = (uInt)count;
+    int ret;
+    do {
+        // Grow the output as needed, since we cannot know its final size
+        size_t used = out_.size();
+        out_.resize(used + std::max((size_t)4096, (size_t)count / 2));
+        stream_.next_out = (Bytef *)&out_[used];
+        stream_.avail_out = (uInt)(out_.size() - used);
+        ret = deflate(&stream_, flush);
+        out_.resize(out_.size() - stream_.avail_out);
+        if (ret == Z_STREAM_ERROR) {
+            error_ = ReportLogicalError();
+            return error_;
+        }
+    } while (stream_.avail_in > 0 ||
+             (flush == Z_FINISH && ret != Z_STREAM_END));
+    return NoError();
+}
+
+} // namespace report
+} // namespace mk
@@ -0,0 +1,45 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+#ifndef SRC_LIBMEASUREMENT_KIT_REPORT_GZIP_FRAME_HPP
+#define SRC_LIBMEASUREMENT_KIT_REPORT_GZIP_FRAME_HPP
+
+#include "src/libmeasurement_kit/common/json_writer.hpp"
+
+#include <measurement_kit/report.hpp>
+
+#include <zlib.h>
+
+namespace mk {
+namespace report {
+
+// Compresses `data` into a self contained gzip member. Since a sequence of
+// gzip members is a valid gzip file, a compressed report is a sequence of
+// such frames, each containing one or more entries.
+ErrorOr<std::string> gzip_frame(const std::string &data, int level = 6);
+
+// Compresses what is written into a gzip member as gzip_frame() does, but
+// incrementally, such that only the compressed data is kept in memory.
+class GzipFrameWriter : public JsonSink, public NonCopyable, public NonMovable {
+  public:
+    explicit GzipFrameWriter(int level = 6);
+
+    using JsonSink::write;
+    Error write(const char *base, size_t count) override;
+
+    // Completes the member and returns it; the writer is not usable after
+    ErrorOr<std::string> finish();
+
+    ~GzipFrameWriter() override;
+
+  private:
+    Error deflate_(const char *base, size_t count, int flush);
+
+    z_stream stream_{};
+    Error error_;
+    std::string out_;
+};
+
+} // namespace report
+} // namespace mk
+#endif
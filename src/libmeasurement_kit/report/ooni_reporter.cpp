@@ -2,6 +2,9 @@
 // Measurement Kit is free software under the BSD license. See AUTHORS
 // and LICENSE for more information on the copying conditions.
 
+#include "src/libmeasurement_kit/ooni/collector_session.hpp"
+#include "src/libmeasurement_kit/report/spool.hpp"
+
 #include <measurement_kit/ooni.hpp>
 #include <measurement_kit/report.hpp>
 
@@ -20,8 +23,24 @@ OoniReporter::OoniReporter(Settings s, SharedPtr<Reactor> r, SharedPtr<Logger> l
     }
     logger->info("Results collector: %s",
         settings["collector_base_url"].c_str());
+    if (settings.get("collector_persistent_connection", true)) {
+        session = ooni::collector::Session::make(settings, reactor, logger);
+    }
+    auto spool_dir = settings.find("spool_dir");
+    if (spool_dir != settings.end() && spool_dir->second != "") {
+        ErrorOr<SharedPtr<Spool>> maybe_spool = Spool::open(
+              spool_dir->second, settings.get("spool_segment_size", 1 << 20),
+              logger);
+        if (!maybe_spool) {
+            logger->warn("ooni_reporter: cannot open the spool");
+        } else {
+            spool = *maybe_spool;
+        }
+    }
 }
 
+OoniReporter::~OoniReporter() {}
+
 /* static */ SharedPtr<BaseReporter> OoniReporter::make(Settings settings,
         SharedPtr<Reactor> reactor, SharedPtr<Logger> logger) {
     SharedPtr<OoniReporter> reporter(new OoniReporter(settings, reactor, logger));
@@ -30,6 +49,14 @@ OoniReporter::OoniReporter(Settings s, SharedPtr<Reactor> r, SharedPtr<Logger> l
 
 Continuation<Error> OoniReporter::open(Report &report) {
     return do_open_([=](Callback<Error> cb) {
+        // When resuming a test, keep submitting to the report it opened
+        std::string rid = settings.get("collector_report_id", std::string{});
+        if (rid != "") {
+            logger->info("Reusing report ID: %s", rid.c_str());
+            report_id = rid;
+            cb(NoError());
+            return;
+        }
         logger->info("Opening report; please be patient...");
         ooni::collector::connect_and_create_report(
                 report.get_dummy_entry(),
@@ -48,6 +75,37 @@ Continuation<Error> OoniReporter::open(Report &report) {
 }
 
 Continuation<Error> OoniReporter::write_entry(Entry entry) {
+    return write_entry(SerializedEntry::make(std::move(entry)));
+}
+
+Continuation<Error> OoniReporter::write_entry(SerializedEntry entry) {
+    Continuation<Error> cc = submit_entry_(entry);
+    if (!spool) {
+        return cc;
+    }
+    // Save the entries that we could not submit, including the ones we
+    // could not submit because we could not open the report, so that
+    // they can be resubmitted later (see `ooni::collector::resubmit_spool`)
+    return [=](Callback<Error> cb) {
+        cc([=](Error error) {
+            if (!error) {
+                cb(error);
+                return;
+            }
+            Error spool_error =
+                  spool->append(settings.at("collector_base_url"), entry);
+            if (spool_error) {
+                cb(error);
+                return;
+            }
+            logger->warn("Cannot submit entry (%s); saved it for later",
+                         error.what());
+            cb(NoError());
+        });
+    };
+}
+
+Continuation<Error> OoniReporter::submit_entry_(SerializedEntry entry) {
 
     // Register action for when we will be asked to write the entry
     return do_write_entry_(entry, [=](Callback<Error> cb) {
@@ -57,18 +115,19 @@ Continuation<Error> OoniReporter::write_entry(Entry entry) {
             return;
         }
         logger->info("Submitting test results; please be patient...");
-        ooni::collector::connect_and_update_report(report_id, entry,
-                                             [=](Error e) {
-                                                 logger->debug(
-                                                     "Submitting entry... %d",
-                                                     e.code);
-                                                 if (!e) {
-                                                     logger->info("Results "
-                                                        "successfully "
-                                                        "submitted");
-                                                 }
-                                                 cb(e);
-                                             },
+        Callback<Error> callback = [=](Error e) {
+            logger->debug("Submitting entry... %d", e.code);
+            if (!e) {
+                logger->info("Results successfully submitted");
+            }
+            cb(e);
+        };
+        if (session) {
+            session->update_report(report_id, entry, callback);
+            return;
+        }
+        ooni::collector::connect_and_update_report_serialized(report_id, entry,
+                                             callback,
                                              settings,
                                              reactor,
                                              logger);
@@ -83,17 +142,21 @@ Continuation<Error> OoniReporter::close() {
             return;
         }
         logger->info("Closing report; please be patient...");
+        Callback<Error> callback = [=](Error e) {
+            logger->debug("Closing report... %d", e.code);
+            if (!e) {
+                logger->info("Report successfully closed");
+            }
+            cb(e);
+        };
+        if (session) {
+            session->close_report(report_id, [=](Error e) {
+                session->close([=]() { callback(e); });
+            });
+            return;
+        }
         ooni::collector::connect_and_close_report(report_id,
-                                            [=](Error e) {
-                                                logger->debug(
-                                                    "Closing report... %d",
-                                                    e.code);
-                                                if (!e) {
-                                                    logger->info("Report "
-                                                        "successfully closed");
-                                                }
-                                                cb(e);
-                                            },
+                                            callback,
                                             settings,
                                             reactor,
                                             logger);
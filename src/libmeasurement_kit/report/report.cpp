@@ -55,6 +55,17 @@ void Report::open(Callback<Error> callback) {
 
 void Report::write_entry(Entry entry, Callback<Error> callback,
                          SharedPtr<Logger> logger) {
+    ErrorOr<SerializedEntry> serialized =
+          serialize_entry(std::move(entry), logger);
+    if (!serialized) {
+        callback(serialized.as_error());
+        return;
+    }
+    write_entry(*serialized, callback, logger);
+}
+
+ErrorOr<SerializedEntry> Report::serialize_entry(Entry entry,
+                                                 SharedPtr<Logger> logger) {
     if (report_id == "") {
         auto count = 0;
         for (auto &reporter : reporters_) {
@@ -72,8 +83,7 @@ void Report::write_entry(Entry entry, Callback<Error> callback,
          * back a good report-id (only ooni_reporter does that).
          */
         if (count > 1) {
-            callback(MultipleReportIdsError());
-            return;
+            return {MultipleReportIdsError(), {}};
         }
         if (report_id != "") {
             logger->debug("report: found report-id: '%s'", report_id.c_str());
@@ -91,6 +101,11 @@ void Report::write_entry(Entry entry, Callback<Error> callback,
             entry["report_id"].dump().c_str());
     }
 
+    return {NoError(), SerializedEntry::make(std::move(entry))};
+}
+
+void Report::write_entry(SerializedEntry entry, Callback<Error> callback,
+                         SharedPtr<Logger>) {
     mk::parallel(FMAP(reporters_, [=](SharedPtr<BaseReporter> r) {
         return r->write_entry(entry);
     }), callback);
@@ -0,0 +1,254 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/report/spool.hpp"
+
+#include "src/libmeasurement_kit/common/json_writer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <sstream>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace mk {
+namespace report {
+
+using Submitted = std::set<std::pair<std::string, uint64_t>>;
+
+// Serializes the accesses to all the spools of this process
+static std::mutex &spool_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+static const char *segment_prefix = "segment-";
+static const char *segment_suffix = ".njson";
+
+static bool is_segment_name(const std::string &name) {
+    size_t plen = strlen(segment_prefix), slen = strlen(segment_suffix);
+    return name.size() > plen + slen &&
+           name.compare(0, plen, segment_prefix) == 0 &&
+           name.compare(name.size() - slen, slen, segment_suffix) == 0;
+}
+
+static std::string make_segment_name(unsigned long long number) {
+    char name[64];
+    snprintf(name, sizeof(name), "%s%08llu%s", segment_prefix, number,
+             segment_suffix);
+    return name;
+}
+
+static Submitted read_index(const std::string &path) {
+    Submitted submitted;
+    std::ifstream index(path);
+    std::string segment;
+    uint64_t offset = 0;
+    while (index >> segment >> offset) {
+        submitted.insert({segment, offset});
+    }
+    return submitted;
+}
+
+// Calls `func` for each line of `path` along with the line offset
+template <typename Func> void for_each_line(const std::string &path, Func func) {
+    std::ifstream segment(path, std::ios::binary);
+    std::string line;
+    uint64_t offset = 0;
+    while (std::getline(segment, line)) {
+        bool complete = !segment.eof(); // i.e. the line ends with "\n"
+        func(offset, line, complete);
+        offset += line.size() + 1;
+    }
+}
+
+/* static */ ErrorOr<SharedPtr<Spool>>
+Spool::open(std::string dirpath, size_t segment_size,
+            SharedPtr<Logger> logger) {
+#ifdef _WIN32
+    int rv = ::mkdir(dirpath.c_str());
+#else
+    int rv = ::mkdir(dirpath.c_str(), 0700);
+#endif
+    if (rv != 0 && errno != EEXIST) {
+        logger->warn("spool: cannot create '%s': %s", dirpath.c_str(),
+                     strerror(errno));
+        return {ReportIoError(), {}};
+    }
+    return {NoError(), SharedPtr<Spool>{std::make_shared<Spool>(
+                             dirpath, segment_size, logger)}};
+}
+
+Spool::Spool(std::string dirpath, size_t segment_size, SharedPtr<Logger> logger)
+    : dirpath_{std::move(dirpath)}, logger_{std::move(logger)},
+      segment_size_{segment_size} {}
+
+std::vector<std::string> Spool::segments_() {
+    std::vector<std::string> segments;
+    DIR *dir = ::opendir(dirpath_.c_str());
+    if (dir == nullptr) {
+        return segments;
+    }
+    struct dirent *ent = nullptr;
+    while ((ent = ::readdir(dir)) != nullptr) {
+        if (is_segment_name(ent->d_name)) {
+            segments.push_back(ent->d_name);
+        }
+    }
+    ::closedir(dir);
+    // Note: names sort like numbers because numbers are zero padded
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+Error Spool::append(std::string collector_base_url,
+                    const SerializedEntry &entry) {
+    std::string line = "{\"collector_base_url\":" +
+                       Json(collector_base_url).dump() + ",\"entry\":";
+    StringSink sink{line};
+    (void)entry.write(sink); // Cannot fail
+    line += "}\n";
+    std::unique_lock<std::mutex> _{spool_mutex()};
+    std::vector<std::string> segments = segments_();
+    std::string name;
+    if (!segments.empty()) {
+        name = segments.back();
+        struct stat sb{};
+        if (::stat((dirpath_ + "/" + name).c_str(), &sb) == 0 &&
+            (size_t)sb.st_size >= segment_size_) {
+            unsigned long long number = strtoull(
+                  name.c_str() + strlen(segment_prefix), nullptr, 10);
+            name = make_segment_name(number + 1);
+        }
+    } else {
+        name = make_segment_name(0);
+    }
+    std::string path = dirpath_ + "/" + name;
+    {
+        // Make sure we do not glue our record to a truncated one
+        std::ifstream existing(path, std::ios::binary | std::ios::ate);
+        if (existing.good() && existing.tellg() > 0) {
+            existing.seekg(-1, std::ios::end);
+            if (existing.get() != '\n') {
+                line = "\n" + line;
+            }
+        }
+    }
+    std::ofstream segment(path, std::ios::app | std::ios::binary);
+    segment << line;
+    segment.flush();
+    if (!segment.good()) {
+        logger_->warn("spool: cannot append to '%s'", name.c_str());
+        return ReportIoError();
+    }
+    logger_->debug("spool: appended entry to '%s'", name.c_str());
+    return NoError();
+}
+
+ErrorOr<std::vector<SpoolRecord>> Spool::pending() {
+    std::unique_lock<std::mutex> _{spool_mutex()};
+    Submitted submitted = read_index(dirpath_ + "/index");
+    std::vector<SpoolRecord> records;
+    for (auto &name : segments_()) {
+        for_each_line(dirpath_ + "/" + name, [&](uint64_t offset,
+                                                 const std::string &line,
+                                                 bool complete) {
+            if (submitted.count({name, offset}) != 0) {
+                return;
+            }
+            SpoolRecord record;
+            try {
+                Json json = Json::parse(line);
+                record.collector_base_url = json.at("collector_base_url");
+                record.entry = json.at("entry");
+            } catch (const std::exception &) {
+                // A truncated last line means that we crashed while appending
+                logger_->warn("spool: skipping %s record at %s:%llu",
+                              complete ? "invalid" : "truncated",
+                              name.c_str(), (unsigned long long)offset);
+                return;
+            }
+            record.segment = name;
+            record.offset = offset;
+            records.push_back(std::move(record));
+        });
+    }
+    return {NoError(), std::move(records)};
+}
+
+Error Spool::mark_submitted(const SpoolRecord &record) {
+    std::unique_lock<std::mutex> _{spool_mutex()};
+    std::ofstream index(dirpath_ + "/index", std::ios::app);
+    index << record.segment << " " << record.offset << "\n";
+    index.flush();
+    if (!index.good()) {
+        logger_->warn("spool: cannot update the index");
+        return ReportIoError();
+    }
+    return NoError();
+}
+
+Error Spool::compact() {
+    std::unique_lock<std::mutex> _{spool_mutex()};
+    std::string index_path = dirpath_ + "/index";
+    Submitted submitted = read_index(index_path);
+    std::vector<std::string> segments = segments_();
+    std::set<std::string> removed;
+    // Note: never remove the last segment, where we may be appending
+    for (size_t i = 0; i + 1 < segments.size(); ++i) {
+        const std::string &name = segments[i];
+        bool done = true;
+        for_each_line(dirpath_ + "/" + name, [&](uint64_t offset,
+                                                 const std::string &line,
+                                                 bool) {
+            if (done && submitted.count({name, offset}) == 0) {
+                // Records that cannot be parsed will never be submitted
+                try {
+                    Json::parse(line);
+                    done = false;
+                } catch (const std::exception &) {
+                    /* Suppress */ ;
+                }
+            }
+        });
+        if (done && ::remove((dirpath_ + "/" + name).c_str()) == 0) {
+            logger_->debug("spool: removed '%s'", name.c_str());
+            removed.insert(name);
+        }
+    }
+    if (removed.empty()) {
+        return NoError();
+    }
+    // Rewrite the index without the removed segments and then atomically
+    // replace the old index with the new one
+    std::string temp_path = index_path + ".tmp";
+    {
+        std::ofstream temp(temp_path, std::ios::trunc);
+        for (auto &pair : submitted) {
+            if (removed.count(pair.first) == 0) {
+                temp << pair.first << " " << pair.second << "\n";
+            }
+        }
+        temp.flush();
+        if (!temp.good()) {
+            logger_->warn("spool: cannot write the new index");
+            return ReportIoError();
+        }
+    }
+    if (::rename(temp_path.c_str(), index_path.c_str()) != 0) {
+        logger_->warn("spool: cannot replace the index: %s", strerror(errno));
+        return ReportIoError();
+    }
+    return NoError();
+}
+
+} // namespace report
+} // namespace mk
@@ -0,0 +1,61 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+#ifndef SRC_LIBMEASUREMENT_KIT_REPORT_SPOOL_HPP
+#define SRC_LIBMEASUREMENT_KIT_REPORT_SPOOL_HPP
+
+#include <measurement_kit/report.hpp>
+
+#include <vector>
+
+namespace mk {
+namespace report {
+
+class SpoolRecord {
+  public:
+    std::string segment;
+    uint64_t offset = 0;
+    std::string collector_base_url;
+    Entry entry;
+};
+
+// Append-only directory of entries that could not be submitted to the
+// collector, so that they can be resubmitted later, possibly after the
+// application has been restarted.
+//
+// Entries are appended, one JSON object per line, to segment files named
+// `segment-NNNNNNNN.njson`, and a new segment is started when the last one
+// is larger than `segment_size` bytes. Submitted entries are not removed;
+// rather, their segment and offset are appended to the `index` file. Then
+// compact() removes the segments where all the entries were submitted.
+//
+// The methods of this class are synchronous and can be used by more than
+// one thread, and by more than one Spool bound to the same directory.
+class Spool : public NonCopyable, public NonMovable {
+  public:
+    static ErrorOr<SharedPtr<Spool>> open(std::string dirpath,
+                                          size_t segment_size = 1 << 20,
+                                          SharedPtr<Logger> = Logger::global());
+
+    Spool(std::string dirpath, size_t segment_size, SharedPtr<Logger> logger);
+
+    Error append(std::string collector_base_url, const SerializedEntry &entry);
+
+    // Returns the entries not yet submitted, in the order they were appended
+    ErrorOr<std::vector<SpoolRecord>> pending();
+
+    Error mark_submitted(const SpoolRecord &record);
+
+    Error compact();
+
+  private:
+    std::vector<std::string> segments_();
+
+    std::string dirpath_;
+    SharedPtr<Logger> logger_;
+    size_t segment_size_ = 0;
+};
+
+} // namespace report
+} // namespace mk
+#endif
@@ -0,0 +1,92 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#include "src/libmeasurement_kit/report/submission_queue.hpp"
+
+namespace mk {
+namespace report {
+
+SubmissionQueue::SubmissionQueue(size_t capacity, size_t concurrency,
+                                 Writer writer, SharedPtr<Reactor> reactor)
+    : capacity_{(capacity > 0) ? capacity : 1},
+      concurrency_{(concurrency > 0) ? concurrency : 1},
+      reactor_{std::move(reactor)}, writer_{std::move(writer)} {}
+
+/* static */ SharedPtr<SubmissionQueue>
+SubmissionQueue::make(size_t capacity, size_t concurrency, Writer writer,
+                      SharedPtr<Reactor> reactor) {
+    return SharedPtr<SubmissionQueue>{std::make_shared<SubmissionQueue>(
+          capacity, concurrency, std::move(writer), std::move(reactor))};
+}
+
+void SubmissionQueue::push(SerializedEntry entry, Callback<Error> cb) {
+    if (error_) {
+        Error error = error_;
+        reactor_->call_soon([cb, error]() { cb(error); });
+        return;
+    }
+    stats_.entries += 1;
+    queue_.push_back(std::move(entry));
+    if (queue_.size() > stats_.max_queued) {
+        stats_.max_queued = queue_.size();
+    }
+    if (queue_.size() > capacity_) {
+        // Backpressure: the producer is faster than the reporters
+        stats_.stalls += 1;
+        waiters_.push_back(std::move(cb));
+    } else {
+        reactor_->call_soon([cb]() { cb(NoError()); });
+    }
+    drain_();
+}
+
+void SubmissionQueue::flush(Callback<Error> cb) {
+    if (active_ == 0 && queue_.empty()) {
+        Error error = error_;
+        reactor_->call_soon([cb, error]() { cb(error); });
+        return;
+    }
+    flushers_.push_back(std::move(cb));
+}
+
+void SubmissionQueue::drain_() {
+    if (error_) {
+        queue_.clear();
+    }
+    while (!error_ && active_ < concurrency_ && !queue_.empty()) {
+        SerializedEntry entry = std::move(queue_.front());
+        queue_.pop_front();
+        active_ += 1;
+        if (active_ > stats_.max_active) {
+            stats_.max_active = active_;
+        }
+        SharedPtr<SubmissionQueue> self = shared_from_this();
+        writer_(std::move(entry), [self](Error error) {
+            self->active_ -= 1;
+            if (error && !self->error_) {
+                self->error_ = error;
+            }
+            self->drain_();
+        });
+    }
+    // Wake up the producers for which there is now room in the queue
+    size_t excess = (queue_.size() > capacity_) ? queue_.size() - capacity_ : 0;
+    while (waiters_.size() > excess) {
+        Callback<Error> cb = std::move(waiters_.front());
+        waiters_.pop_front();
+        Error error = error_;
+        reactor_->call_soon([cb, error]() { cb(error); });
+    }
+    if (active_ == 0 && queue_.empty()) {
+        std::list<Callback<Error>> flushers;
+        flushers.swap(flushers_);
+        for (auto &cb : flushers) {
+            Error error = error_;
+            reactor_->call_soon([cb, error]() { cb(error); });
+        }
+    }
+}
+
+} // namespace report
+} // namespace mk
@@ -0,0 +1,70 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+#ifndef SRC_LIBMEASUREMENT_KIT_REPORT_SUBMISSION_QUEUE_HPP
+#define SRC_LIBMEASUREMENT_KIT_REPORT_SUBMISSION_QUEUE_HPP
+
+#include <measurement_kit/report.hpp>
+
+#include <deque>
+#include <list>
+
+namespace mk {
+namespace report {
+
+class SubmissionQueueStats {
+  public:
+    uint64_t entries = 0;
+    uint64_t max_queued = 0;
+    uint64_t max_active = 0;
+    uint64_t stalls = 0; // Number of push()es that had to wait
+};
+
+// Bounded queue between the code that produces entries and the reporters,
+// so that producers do not need to wait for entries to be written.
+//
+// The `writer` writes an entry and calls its callback when done. Up to
+// `concurrency` entries are written at the same time, in queue order. The
+// first error returned by the writer is sticky: it is passed to all the
+// later push() and flush() callbacks, and queued entries are discarded.
+class SubmissionQueue : public EnableSharedFromThis<SubmissionQueue>,
+                        public NonCopyable,
+                        public NonMovable {
+  public:
+    using Writer = std::function<void(SerializedEntry, Callback<Error>)>;
+
+    // Use make() to construct, because we need to be owned by a SharedPtr
+    SubmissionQueue(size_t capacity, size_t concurrency, Writer writer,
+                    SharedPtr<Reactor> reactor);
+
+    static SharedPtr<SubmissionQueue> make(size_t capacity, size_t concurrency,
+                                           Writer writer,
+                                           SharedPtr<Reactor> reactor);
+
+    // Queues `entry` and calls `cb` as soon as there is room for another
+    // entry, which is immediately unless the queue is full.
+    void push(SerializedEntry entry, Callback<Error> cb);
+
+    // Calls `cb` once all the entries pushed so far have been written.
+    void flush(Callback<Error> cb);
+
+    SubmissionQueueStats stats() const { return stats_; }
+
+  private:
+    void drain_();
+
+    size_t active_ = 0;
+    size_t capacity_ = 1;
+    size_t concurrency_ = 1;
+    Error error_;
+    std::list<Callback<Error>> flushers_;
+    std::deque<SerializedEntry> queue_;
+    SharedPtr<Reactor> reactor_;
+    SubmissionQueueStats stats_;
+    std::deque<Callback<Error>> waiters_;
+    Writer writer_;
+};
+
+} // namespace report
+} // namespace mk
+#endif
@@ -0,0 +1,125 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include "src/libmeasurement_kit/common/deadline.hpp"
+#include "src/libmeasurement_kit/common/utils.hpp"
+
+#include <measurement_kit/dns.hpp>
+#include <measurement_kit/net.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace mk;
+
+TEST_CASE("Deadline helpers work as expected") {
+    SECTION("Without a deadline") {
+        Settings settings;
+        REQUIRE(!has_deadline(settings));
+        REQUIRE(!deadline_expired(settings));
+        REQUIRE(timeout_before_deadline(settings, 7.0) == 7.0);
+        REQUIRE(timeout_before_deadline(settings, -1.0) == -1.0);
+    }
+
+    SECTION("With a deadline") {
+        Settings settings = with_deadline({}, 10.0);
+        REQUIRE(has_deadline(settings));
+        REQUIRE(!deadline_expired(settings));
+        REQUIRE(timeout_before_deadline(settings, 1.0) == 1.0);
+        REQUIRE(timeout_before_deadline(settings, 30.0) <= 10.0);
+        REQUIRE(timeout_before_deadline(settings, 30.0) > 9.0);
+        REQUIRE(timeout_before_deadline(settings, -1.0) <= 10.0);
+    }
+
+    SECTION("With an expired deadline") {
+        Settings settings = with_deadline({}, -1.0);
+        REQUIRE(deadline_expired(settings));
+        REQUIRE(timeout_before_deadline(settings, 30.0) > 0.0);
+        REQUIRE(timeout_before_deadline(settings, 30.0) < 0.1);
+    }
+}
+
+// Server that accepts connections, thanks to the listen backlog, and
+// never sends anything; returns its port
+static int listen_forever(int &fd) {
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(fd >= 0);
+    sockaddr_in sin{};
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    REQUIRE(bind(fd, (sockaddr *)&sin, sizeof(sin)) == 0);
+    REQUIRE(listen(fd, 10) == 0);
+    socklen_t len = sizeof(sin);
+    REQUIRE(getsockname(fd, (sockaddr *)&sin, &len) == 0);
+    return ntohs(sin.sin_port);
+}
+
+TEST_CASE("net::connect() honours the deadline") {
+    SharedPtr<Reactor> reactor = Reactor::make();
+    int fd = -1;
+    int port = listen_forever(fd);
+
+    SECTION("An open connection is interrupted at the deadline") {
+        Error error;
+        double elapsed = 0.0;
+        Settings settings = with_deadline({{"net/timeout", 10.0}}, 0.5);
+        double begin = time_now();
+        reactor->run_with_initial_event([&]() {
+            net::connect("127.0.0.1", port,
+                         [&](Error err, SharedPtr<net::Transport> txp) {
+                             REQUIRE(!err);
+                             txp->on_data([](net::Buffer) {});
+                             txp->on_error([&, txp](Error err) {
+                                 error = err;
+                                 elapsed = time_now() - begin;
+                                 txp->close([]() {});
+                             });
+                         },
+                         settings, reactor);
+        });
+        REQUIRE(error == DeadlineExceededError());
+        REQUIRE(elapsed >= 0.4);
+        REQUIRE(elapsed < 5.0);
+    }
+
+    SECTION("A closed connection does not delay the reactor") {
+        double begin = time_now();
+        Settings settings = with_deadline({}, 30.0);
+        reactor->run_with_initial_event([&]() {
+            net::connect("127.0.0.1", port,
+                         [&](Error err, SharedPtr<net::Transport> txp) {
+                             REQUIRE(!err);
+                             txp->close([]() {});
+                         },
+                         settings, reactor);
+        });
+        REQUIRE(time_now() - begin < 5.0);
+    }
+
+    SECTION("Nothing is attempted after the deadline") {
+        Error connect_error, query_error;
+        Settings settings = with_deadline({}, -1.0);
+        reactor->run_with_initial_event([&]() {
+            net::connect("127.0.0.1", port,
+                         [&](Error err, SharedPtr<net::Transport>) {
+                             connect_error = err;
+                         },
+                         settings, reactor);
+            dns::query("IN", "A", "www.example.com",
+                       [&](Error err, SharedPtr<dns::Message>) {
+                           query_error = err;
+                       },
+                       settings, reactor);
+        });
+        REQUIRE(connect_error == DeadlineExceededError());
+        REQUIRE(query_error == DeadlineExceededError());
+    }
+
+    close(fd);
+}
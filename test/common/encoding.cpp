@@ -5,7 +5,9 @@
 #define CATCH_CONFIG_MAIN
 #include "src/libmeasurement_kit/ext/catch.hpp"
 
+#include "src/libmeasurement_kit/common/citrus_ctype.h"
 #include "src/libmeasurement_kit/common/encoding.hpp"
+#include "src/libmeasurement_kit/common/utils.hpp"
 
 #include <resolv.h>
 
@@ -53,6 +55,61 @@ TEST_CASE("utf8_parse works") {
     }
 }
 
+// The original implementation, which parses one byte at a time
+static mk::Error reference_utf8_parse(const std::string &s) {
+    _utf8_state state = {};
+    size_t r = 1;
+    for (char c : s) {
+        r = mk_utf8_mbrtowc(nullptr, &c, 1, (mbstate_t *)&state);
+        if (r == (size_t)-1) {
+            return mk::IllegalSequenceError();
+        }
+        if (r == 0) {
+            return mk::UnexpectedNullByteError();
+        }
+    }
+    if (r == (size_t)-2) {
+        return mk::IncompleteUtf8SequenceError();
+    }
+    return mk::NoError();
+}
+
+static std::string random_bytes(size_t size) {
+    std::string s(size, '\0');
+    evutil_secure_rng_get_bytes(&s[0], s.size());
+    return s;
+}
+
+TEST_CASE("utf8_parse() behaves like the byte by byte parser") {
+    // Mostly ASCII text with some multibyte sequences, spanning the
+    // boundaries of the blocks checked at once by the ASCII fast path
+    std::string text = "<p>caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80 ";
+    while (text.size() < 100) {
+        text += "lorem ipsum dolor \xd0\xbf\xd1\x80\xd0\xb8 ";
+    }
+    REQUIRE(mk::utf8_parse(text) == mk::NoError());
+    for (int i = 0; i < 4000; ++i) {
+        std::string s = text.substr(0, text.size() - i % 7);
+        uint8_t where = 0, what = 0;
+        evutil_secure_rng_get_bytes(&where, sizeof(where));
+        evutil_secure_rng_get_bytes(&what, sizeof(what));
+        if (i % 3 != 0) { // Corrupt one byte in most cases
+            s[where % s.size()] = (char)what;
+        }
+        REQUIRE(mk::utf8_parse(s) == reference_utf8_parse(s));
+    }
+    for (size_t size = 1; size < 64; ++size) {
+        std::string s = random_bytes(size);
+        REQUIRE(mk::utf8_parse(s) == reference_utf8_parse(s));
+    }
+    // Redundant encodings, surrogates, and too large code points
+    for (std::string s : {"\xc0\x80", "\xe0\x80\x80", "\xed\xa0\x80",
+                          "\xf4\x90\x80\x80", "\xf8\x88\x80\x80\x80",
+                          "\xe0\x80"}) {
+        REQUIRE(mk::utf8_parse(s) == reference_utf8_parse(s));
+    }
+}
+
 TEST_CASE("base64_encode() works as expected") {
     // Note: 'any carnal pleasure' example taken from wikipedia
     //  https://en.wikipedia.org/wiki/Base64
@@ -99,3 +156,68 @@ TEST_CASE("base64_encode() works as expected") {
         }
     }
 }
+
+TEST_CASE("base64_decode() works as expected") {
+    SECTION("With valid input") {
+        REQUIRE(*mk::base64_decode("") == "");
+        REQUIRE(*mk::base64_decode("YW55IGNhcm5hbCBwbGVhcw==") ==
+                "any carnal pleas");
+        REQUIRE(*mk::base64_decode("YW55IGNhcm5hbCBwbGVhc3U=") ==
+                "any carnal pleasu");
+        REQUIRE(*mk::base64_decode("YW55IGNhcm5hbCBwbGVhc3Vy") ==
+                "any carnal pleasur");
+    }
+
+    SECTION("With random input") {
+        for (size_t size = 0; size < 300; ++size) {
+            std::string input = random_bytes(size);
+            REQUIRE(*mk::base64_decode(mk::base64_encode(input)) == input);
+        }
+    }
+
+    SECTION("With invalid input") {
+        for (std::string s : {"YW5", "YW5=5", "Y=55", "====", "YW5!",
+                              "YQ==YQ==", "YW55\n"}) {
+            REQUIRE(mk::base64_decode(s).as_error() == mk::ValueError());
+        }
+    }
+}
+
+TEST_CASE("Throughput of utf8_parse() and base64_encode()") {
+    // A realistic body: mostly ASCII markup with some multibyte text
+    std::string body;
+    while (body.size() < (1 << 22)) {
+        body += "<div class=\"article\"><a href=\"/news/2017/item\">"
+                "Breaking news</a> \xe2\x80\x94 caf\xc3\xa9 "
+                "\xd0\xbd\xd0\xbe\xd0\xb2\xd0\xbe\xd1\x81\xd1\x82"
+                "\xd0\xb8</div>\n";
+    }
+    std::string binary = random_bytes(1 << 22);
+    auto mbps = [](size_t bytes, double elapsed) {
+        return bytes / (elapsed > 0.0 ? elapsed : 1e-09) / 1e06;
+    };
+
+    double t0 = mk::monotonic_time_now();
+    REQUIRE(mk::utf8_parse(body) == mk::NoError());
+    double t1 = mk::monotonic_time_now();
+    REQUIRE(reference_utf8_parse(body) == mk::NoError());
+    double t2 = mk::monotonic_time_now();
+    std::string encoded = mk::base64_encode(binary);
+    double t3 = mk::monotonic_time_now();
+    std::vector<char> output(binary.size() * 2);
+    REQUIRE(b64_ntop((const uint8_t *)binary.data(), binary.size(),
+                     output.data(), output.size()) == (int)encoded.size());
+    double t4 = mk::monotonic_time_now();
+    REQUIRE(*mk::base64_decode(encoded) == binary);
+    double t5 = mk::monotonic_time_now();
+
+    mk::Logger::global()->set_verbosity(MK_LOG_INFO); // to see the results
+    mk::Logger::global()->info("utf8_parse: %.0f MB/s (byte by byte: %.0f MB/s)",
+                               mbps(body.size(), t1 - t0),
+                               mbps(body.size(), t2 - t1));
+    mk::Logger::global()->info("base64_encode: %.0f MB/s (b64_ntop: %.0f MB/s)",
+                               mbps(binary.size(), t3 - t2),
+                               mbps(binary.size(), t4 - t3));
+    mk::Logger::global()->info("base64_decode: %.0f MB/s",
+                               mbps(encoded.size(), t5 - t4));
+}
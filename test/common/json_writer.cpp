@@ -0,0 +1,150 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include "src/libmeasurement_kit/common/json_writer.hpp"
+#include "src/libmeasurement_kit/common/utils.hpp"
+
+#include <event2/buffer.h>
+
+#include <sstream>
+
+#include <unistd.h>
+
+using namespace mk;
+
+static std::string write_to_string(const Json &json) {
+    std::string s;
+    StringSink sink{s};
+    REQUIRE(!write_json(json, sink));
+    return s;
+}
+
+static Json make_large_entry() {
+    std::string body;
+    for (int i = 0; i < 2000; ++i) {
+        body += "<p class=\"x\">Line " + std::to_string(i) + "\tof text</p>\n";
+    }
+    Json requests;
+    for (int i = 0; i < 10; ++i) {
+        requests.push_back({{"request", {{"url", "http://www.example.com/"},
+                                         {"headers", {{"Accept", "*/*"}}}}},
+                            {"response", {{"body", body}, {"code", 200}}}});
+    }
+    return Json{{"input", "http://www.example.com/"},
+                {"test_keys", {{"requests", requests}}},
+                {"test_runtime", 0.253494024276733}};
+}
+
+TEST_CASE("write_json() writes the same bytes of dump()") {
+    SECTION("With scalars") {
+        for (Json json : {Json(nullptr), Json(true), Json(false), Json(17),
+                          Json(-17), Json((uint64_t)1 << 63), Json(1.3),
+                          Json(0.253494024276733), Json(1e100), Json(""),
+                          Json("foo")}) {
+            REQUIRE(write_to_string(json) == json.dump());
+        }
+    }
+
+    SECTION("With empty and nested containers") {
+        Json json{{"array", Json::array()},
+                  {"object", Json::object()},
+                  {"nested", {{"a", {1, 2, {{"b", nullptr}}}}, {"c", "d"}}}};
+        REQUIRE(write_to_string(json) == json.dump());
+    }
+
+    SECTION("With strings that must be escaped") {
+        std::string s = "\"quoted\" back\\slash \b\f\n\r\t";
+        for (int c = 0; c < 0x20; ++c) {
+            s += (char)c;
+        }
+        s += "caf\xc3\xa9 \x7f \xff";
+        Json json{{s, s}, {"list", {s, "", s}}};
+        REQUIRE(write_to_string(json) == json.dump());
+    }
+
+    SECTION("With strings larger than the internal buffer") {
+        Json json = make_large_entry();
+        REQUIRE(write_to_string(json) == json.dump());
+    }
+}
+
+TEST_CASE("The sinks work as expected") {
+    Json json = make_large_entry();
+    std::string expect = json.dump();
+
+    SECTION("OstreamSink") {
+        std::stringstream ss;
+        OstreamSink sink{ss};
+        REQUIRE(!write_json(json, sink));
+        REQUIRE(ss.str() == expect);
+    }
+
+    SECTION("EvbufferSink") {
+        evbuffer *evbuf = evbuffer_new();
+        REQUIRE(evbuf != nullptr);
+        EvbufferSink sink{evbuf};
+        REQUIRE(!write_json(json, sink));
+        size_t length = evbuffer_get_length(evbuf);
+        std::string s((const char *)evbuffer_pullup(evbuf, -1), length);
+        evbuffer_free(evbuf);
+        REQUIRE(s == expect);
+    }
+
+    SECTION("FdSink") {
+        char name[] = "/tmp/mk-json-writer-XXXXXX";
+        int fd = mkstemp(name);
+        REQUIRE(fd >= 0);
+        FdSink sink{fd};
+        REQUIRE(!write_json(json, sink));
+        REQUIRE(::close(fd) == 0);
+        ErrorOr<std::string> s = slurp(name);
+        REQUIRE(::unlink(name) == 0);
+        REQUIRE(!!s);
+        REQUIRE(*s == expect);
+    }
+
+    SECTION("FdSink with an invalid file descriptor") {
+        FdSink sink{-1};
+        REQUIRE(write_json(json, sink) == FileIoError());
+    }
+
+    SECTION("Sha256Sink") {
+        Sha256Sink sink;
+        REQUIRE(!write_json(json, sink));
+        REQUIRE(sink.hexdigest() == sha256_of(expect));
+    }
+}
+
+TEST_CASE("Throughput of write_json() compared to dump()") {
+    Json json = make_large_entry();
+    const int count = 20;
+    double t0 = mk::monotonic_time_now();
+    size_t dumped = 0;
+    for (int i = 0; i < count; ++i) {
+        // What we used to do: serialize and then copy into the destination
+        evbuffer *evbuf = evbuffer_new();
+        std::string s = json.dump();
+        evbuffer_add(evbuf, s.data(), s.size());
+        dumped += evbuffer_get_length(evbuf);
+        evbuffer_free(evbuf);
+    }
+    double t1 = mk::monotonic_time_now();
+    size_t written = 0;
+    for (int i = 0; i < count; ++i) {
+        evbuffer *evbuf = evbuffer_new();
+        EvbufferSink sink{evbuf};
+        REQUIRE(!write_json(json, sink));
+        written += evbuffer_get_length(evbuf);
+        evbuffer_free(evbuf);
+    }
+    double t2 = mk::monotonic_time_now();
+    REQUIRE(dumped == written);
+    Logger::global()->set_verbosity(MK_LOG_INFO); // to see the results
+    Logger::global()->info("%d entries of %zu bytes into evbuffer: dump() "
+                           "and copy %.4f s, write_json() %.4f s",
+                           count, written / count, t1 - t0, t2 - t1);
+}
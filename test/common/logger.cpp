@@ -8,6 +8,7 @@
 #include <measurement_kit/common.hpp>
 
 #include <string>
+#include <vector>
 
 using namespace mk;
 
@@ -122,3 +123,30 @@ TEST_CASE("We pass MK_LOG_EVENT only to event-handler if it is set") {
     REQUIRE(!log_called);
     REQUIRE(eh_called);
 }
+
+TEST_CASE("emit_event() passes the JSON to the JSON event handler") {
+    SharedPtr<Logger> logger = Logger::make();
+    auto eh_called = false;
+    logger->on_event([&](const char *) {
+        eh_called = true; /* We should not enter here */
+    });
+    Json received;
+    logger->on_json_event([&](Json &&event) { received = std::move(event); });
+    // The verbosity is WARNING, yet the JSON event handler is called
+    logger->emit_event(Json{{"type", "x"}, {"elapsed", {1.5, "s"}}});
+    REQUIRE(!eh_called);
+    REQUIRE((received == Json{{"type", "x"}, {"elapsed", {1.5, "s"}}}));
+}
+
+TEST_CASE("emit_event() serializes the event if there is no JSON handler") {
+    SharedPtr<Logger> logger = Logger::make();
+    std::vector<std::string> received;
+    logger->on_event([&](const char *s) { received.push_back(s); });
+    logger->emit_event(Json{{"type", "x"}});
+    REQUIRE(received.size() == 0); // Filtered because of the verbosity
+    logger->set_verbosity(MK_LOG_INFO);
+    logger->emit_event(Json{{"type", "x"}, {"speed", {100.0, "kbit/s"}}});
+    REQUIRE(received.size() == 1);
+    REQUIRE((Json::parse(received[0]) ==
+             Json{{"type", "x"}, {"speed", {100.0, "kbit/s"}}}));
+}
@@ -0,0 +1,67 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include "src/libmeasurement_kit/common/timer.hpp"
+#include "src/libmeasurement_kit/common/utils.hpp"
+
+#include <measurement_kit/common.hpp>
+
+using namespace mk;
+
+TEST_CASE("Timer works as expected") {
+    SharedPtr<Reactor> reactor = Reactor::make();
+
+    SECTION("The callback is called after the delay") {
+        SharedPtr<Timer> timer;
+        double elapsed = 0.0;
+        double begin = time_now();
+        reactor->run_with_initial_event([&]() {
+            timer = Timer::make(reactor, 0.2, [&]() {
+                elapsed = time_now() - begin;
+            });
+        });
+        REQUIRE(elapsed >= 0.2);
+    }
+
+    SECTION("A cancelled timer does not keep the reactor running") {
+        bool called = false;
+        double begin = time_now();
+        reactor->run_with_initial_event([&]() {
+            SharedPtr<Timer> timer =
+                  Timer::make(reactor, 10.0, [&]() { called = true; });
+            reactor->call_later(0.1, [timer]() { timer->cancel(); });
+        });
+        REQUIRE(!called);
+        REQUIRE(time_now() - begin < 5.0);
+    }
+
+    SECTION("Destroying the timer cancels it") {
+        bool called = false;
+        double begin = time_now();
+        reactor->run_with_initial_event([&]() {
+            Timer::make(reactor, 10.0, [&]() { called = true; });
+        });
+        REQUIRE(!called);
+        REQUIRE(time_now() - begin < 5.0);
+    }
+
+    SECTION("The callback can destroy the timer") {
+        SharedPtr<Timer> timer;
+        int count = 0;
+        reactor->run_with_initial_event([&]() {
+            timer = Timer::make(reactor, 0.0, [&]() {
+                timer = Timer::make(reactor, 0.0, [&]() {
+                    count += 1;
+                    timer = {};
+                });
+                count += 1;
+            });
+        });
+        REQUIRE(count == 2);
+        REQUIRE(!timer);
+    }
+}
@@ -0,0 +1,43 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include "src/libmeasurement_kit/common/token_bucket.hpp"
+
+using namespace mk;
+
+TEST_CASE("TokenBucket works as expected") {
+    SECTION("Without a rate there is no limit") {
+        TokenBucket bucket{0.0, 1.0};
+        for (int i = 0; i < 1000; ++i) {
+            REQUIRE(bucket.consume(10.0));
+        }
+    }
+
+    SECTION("Bursts are allowed and then the rate is enforced") {
+        TokenBucket bucket{4.0, 5.0};
+        for (int i = 0; i < 5; ++i) {
+            REQUIRE(bucket.consume(10.0));
+        }
+        REQUIRE(!bucket.consume(10.0));
+        REQUIRE(!bucket.consume(10.125));
+        REQUIRE(bucket.consume(10.25));
+        REQUIRE(!bucket.consume(10.25));
+        // After a long pause, no more than a burst is allowed
+        int allowed = 0;
+        for (int i = 0; i < 100; ++i) {
+            allowed += bucket.consume(100.0) ? 1 : 0;
+        }
+        REQUIRE(allowed == 5);
+    }
+
+    SECTION("The burst is at least one event") {
+        TokenBucket bucket{1.0, 0.0};
+        REQUIRE(bucket.consume(1.0));
+        REQUIRE(!bucket.consume(1.5));
+        REQUIRE(bucket.consume(2.0));
+    }
+}
@@ -0,0 +1,94 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include "src/libmeasurement_kit/engine/event_queue.hpp"
+
+using namespace mk::engine;
+
+static nlohmann::json make_event(const char *type) {
+    return nlohmann::json{{"type", type}};
+}
+
+static nlohmann::json make_progress(double percentage) {
+    return nlohmann::json{{"type", "PROGRESS"},
+                          {"percentage", percentage},
+                          {"message", "x"}};
+}
+
+TEST_CASE("EventQueue works as expected") {
+    SECTION("Events are popped in order") {
+        EventQueue queue;
+        queue.push(make_event("RESULT"));
+        queue.push(make_event("PERFORMANCE"));
+        nlohmann::json event;
+        REQUIRE(queue.pop(event));
+        REQUIRE(event == make_event("RESULT"));
+        REQUIRE(queue.pop(event));
+        REQUIRE(event == make_event("PERFORMANCE"));
+        REQUIRE(!queue.pop(event));
+    }
+
+    SECTION("Consecutive LOG events with the same verbosity are coalesced") {
+        EventQueue queue;
+        queue.push_log("INFO", "a");
+        queue.push(nlohmann::json{
+              {"type", "LOG"}, {"verbosity", "INFO"}, {"message", "b"}});
+        queue.push_log("DEBUG", "c");
+        queue.push(make_event("RESULT"));
+        queue.push_log("DEBUG", "d");
+        REQUIRE(queue.size() == 4);
+        REQUIRE(queue.merged() == 1);
+        nlohmann::json event;
+        REQUIRE(queue.pop(event));
+        REQUIRE(event["message"] == "a\nb");
+        REQUIRE(queue.pop(event));
+        REQUIRE(event["message"] == "c");
+        REQUIRE(queue.pop(event));
+        REQUIRE(queue.pop(event));
+        REQUIRE(event["message"] == "d");
+        // The LOG that was consumed cannot be extended anymore
+        queue.push_log("DEBUG", "e");
+        REQUIRE(queue.pop(event));
+        REQUIRE(event["message"] == "e");
+    }
+
+    SECTION("Only the latest PROGRESS is kept") {
+        EventQueue queue;
+        queue.push(make_progress(0.1));
+        queue.push(make_event("RESULT"));
+        queue.push(make_progress(0.2));
+        queue.push(make_progress(0.3));
+        REQUIRE(queue.size() == 2);
+        REQUIRE(queue.merged() == 2);
+        nlohmann::json event;
+        REQUIRE(queue.pop(event));
+        REQUIRE(event["percentage"] == 0.3);
+        queue.push(make_progress(0.4));
+        REQUIRE(queue.pop(event));
+        REQUIRE(event["type"] == "RESULT");
+        REQUIRE(queue.pop(event));
+        REQUIRE(event["percentage"] == 0.4);
+    }
+
+    SECTION("Only non critical events are dropped when full") {
+        EventQueue queue{2};
+        queue.push(make_event("PERFORMANCE"));
+        queue.push(make_event("RESULT"));
+        queue.push(make_event("PERFORMANCE"));
+        queue.push_log("INFO", "dropped");
+        queue.push(make_event("FAILURE"));
+        queue.push_log("WARNING", "kept");
+        queue.push(make_progress(1.0));
+        REQUIRE(queue.dropped() == 2);
+        REQUIRE(queue.size() == 5);
+        auto stats = queue.make_statistics_event();
+        REQUIRE(stats["type"] == "STATISTICS");
+        REQUIRE(stats["dropped_events"] == 2);
+        REQUIRE(stats["merged_events"] == 0);
+        REQUIRE(stats["max_queued_events"] == 5);
+    }
+}
@@ -0,0 +1,133 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include "src/libmeasurement_kit/engine/scheduler.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace mk::engine;
+
+static TaskBudget make_budget(size_t sockets, bool bandwidth_sensitive) {
+    TaskBudget budget;
+    budget.sockets = sockets;
+    budget.bandwidth_sensitive = bandwidth_sensitive;
+    return budget;
+}
+
+static bool never() { return false; }
+
+static void ignore(size_t, double) {}
+
+// Acquires `budget` in a background thread and records the queue positions
+class Waiter {
+  public:
+    Waiter(Scheduler &scheduler, TaskBudget budget) {
+        thread = std::thread{[this, &scheduler, budget]() {
+            running = scheduler.acquire(budget, never, [this](size_t pos,
+                                                              double) {
+                std::unique_lock<std::mutex> _{mutex};
+                positions_.push_back(pos);
+            });
+        }};
+        while (positions().empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    std::vector<size_t> positions() {
+        std::unique_lock<std::mutex> _{mutex};
+        return positions_;
+    }
+
+    std::atomic_bool running{false};
+    std::mutex mutex;
+    std::thread thread;
+
+  private:
+    std::vector<size_t> positions_;
+};
+
+TEST_CASE("Scheduler works as expected") {
+    SECTION("Latency tasks run concurrently up to max_tasks") {
+        Scheduler scheduler{2, 100};
+        auto budget = make_budget(10, false);
+        REQUIRE(scheduler.acquire(budget, never, ignore));
+        REQUIRE(scheduler.acquire(budget, never, ignore));
+        REQUIRE(scheduler.running() == 2);
+        Waiter waiter{scheduler, budget};
+        REQUIRE(!waiter.running);
+        scheduler.release(budget);
+        waiter.thread.join();
+        REQUIRE(waiter.running);
+        REQUIRE((waiter.positions() == std::vector<size_t>{1, 0}));
+        scheduler.release(budget);
+        scheduler.release(budget);
+        REQUIRE(scheduler.running() == 0);
+    }
+
+    SECTION("Tasks share the sockets budget") {
+        Scheduler scheduler{4, 100};
+        REQUIRE(scheduler.acquire(make_budget(60, false), never, ignore));
+        Waiter waiter{scheduler, make_budget(50, false)};
+        REQUIRE(!waiter.running);
+        scheduler.release(make_budget(60, false));
+        waiter.thread.join();
+        REQUIRE(waiter.running);
+        scheduler.release(make_budget(50, false));
+    }
+
+    SECTION("A task larger than the sockets budget runs alone") {
+        Scheduler scheduler{4, 100};
+        REQUIRE(scheduler.acquire(make_budget(200, false), never, ignore));
+        REQUIRE(scheduler.running() == 1);
+        scheduler.release(make_budget(200, false));
+    }
+
+    SECTION("Bandwidth sensitive tasks run alone") {
+        Scheduler scheduler{4, 100};
+        REQUIRE(scheduler.acquire(make_budget(1, false), never, ignore));
+        Waiter bw{scheduler, make_budget(1, true)};
+        // Would fit, but must wait for the bandwidth task ahead of it
+        Waiter latency{scheduler, make_budget(1, false)};
+        REQUIRE((latency.positions() == std::vector<size_t>{2}));
+        scheduler.release(make_budget(1, false));
+        bw.thread.join();
+        REQUIRE(bw.running);
+        REQUIRE(scheduler.running() == 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        REQUIRE(!latency.running);
+        scheduler.release(make_budget(1, true));
+        latency.thread.join();
+        REQUIRE(latency.running);
+        REQUIRE((latency.positions() == std::vector<size_t>{2, 1, 0}));
+        scheduler.release(make_budget(1, false));
+    }
+
+    SECTION("A waiting task can be interrupted") {
+        Scheduler scheduler{1, 100};
+        REQUIRE(scheduler.acquire(make_budget(1, false), never, ignore));
+        std::atomic_bool interrupted{false}, waiting{false}, rv{true};
+        std::thread thread{[&]() {
+            rv = scheduler.acquire(make_budget(1, false),
+                                   [&]() { return !!interrupted; },
+                                   [&](size_t, double) { waiting = true; });
+        }};
+        while (!waiting) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        interrupted = true;
+        scheduler.wakeup();
+        thread.join();
+        REQUIRE(!rv);
+        REQUIRE(scheduler.running() == 1);
+        scheduler.release(make_budget(1, false));
+    }
+}
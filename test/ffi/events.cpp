@@ -0,0 +1,64 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include <measurement_kit/common/nlohmann/json.hpp>
+#include <measurement_kit/ffi.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+TEST_CASE("mk_task_wait_for_events() works as expected") {
+    SECTION("With nullptr arguments") {
+        REQUIRE(mk_events_serialize(nullptr) == nullptr);
+        REQUIRE(mk_events_size(nullptr) == 0);
+        mk_events_destroy(nullptr);
+        auto events = mk_events_create();
+        REQUIRE(mk_task_wait_for_events(nullptr, events, 16, -1.0, nullptr) == 0);
+        auto task = mk_task_start("{\"type\": \"Nonexistent\"}");
+        REQUIRE(task != nullptr);
+        REQUIRE(mk_task_wait_for_events(task, nullptr, 16, -1.0, nullptr) == 0);
+        mk_task_destroy(task);
+        mk_events_destroy(events);
+    }
+
+    SECTION("With a task") {
+        auto task = mk_task_start("{\"type\": \"Nonexistent\"}");
+        REQUIRE(task != nullptr);
+        auto events = mk_events_create();
+        REQUIRE(mk_task_wait_for_events(task, events, 0, -1.0, nullptr) == 0);
+        std::vector<nlohmann::json> all;
+        int terminated = 0;
+        while (!terminated) {
+            size_t count =
+                  mk_task_wait_for_events(task, events, 2, 1.0, &terminated);
+            REQUIRE(count <= 2);
+            std::string serio{mk_events_serialize(events),
+                              mk_events_size(events)};
+            std::stringstream ss{serio};
+            std::string line;
+            size_t lines = 0;
+            while (std::getline(ss, line)) {
+                all.push_back(nlohmann::json::parse(line));
+                lines += 1;
+            }
+            REQUIRE(lines == count);
+        }
+        REQUIRE(!mk_task_is_running(task));
+        // A LOG and a FAILURE because of the unknown type, and STATISTICS
+        REQUIRE(all.size() == 3);
+        REQUIRE(all[0]["type"] == "LOG");
+        REQUIRE(all[1]["type"] == "FAILURE");
+        REQUIRE(all[2]["type"] == "STATISTICS");
+        // Once terminated, it does not block and stays terminated
+        REQUIRE(mk_task_wait_for_events(task, events, 2, -1.0,
+                                        &terminated) == 0);
+        REQUIRE(terminated);
+        mk_events_destroy(events);
+        mk_task_destroy(task);
+    }
+}
@@ -0,0 +1,149 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include "src/libmeasurement_kit/http/content_decoder.hpp"
+#include "src/libmeasurement_kit/http/response_parser.hpp"
+
+using namespace mk;
+using namespace mk::http;
+
+static std::string compress(const std::string &s, int window_bits) {
+    z_stream zs{};
+    REQUIRE(deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, window_bits, 8,
+                         Z_DEFAULT_STRATEGY) == Z_OK);
+    std::string out(deflateBound(&zs, s.size()) + 32, '\0');
+    zs.next_in = (Bytef *)s.data();
+    zs.avail_in = (uInt)s.size();
+    zs.next_out = (Bytef *)&out[0];
+    zs.avail_out = (uInt)out.size();
+    REQUIRE(deflate(&zs, Z_FINISH) == Z_STREAM_END);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return out;
+}
+
+static std::string decode(std::string encoding, const std::string &data,
+                          Error *err, size_t max_size = 1 << 20) {
+    ContentDecoder decoder{encoding, max_size};
+    std::string result;
+    // Feed one byte at a time to exercise the streaming code paths
+    for (auto c : data) {
+        *err = decoder.feed(&c, 1, [&](std::string s) { result += s; });
+        if (*err) {
+            return result;
+        }
+    }
+    *err = decoder.finish();
+    return result;
+}
+
+static const std::string plaintext = [] {
+    std::string s;
+    for (int i = 0; i < 4096; ++i) {
+        s += "The quick brown fox jumps over the lazy dog. ";
+    }
+    return s;
+}();
+
+TEST_CASE("is_decodable_content_encoding() works as expected") {
+    REQUIRE(is_decodable_content_encoding("gzip"));
+    REQUIRE(is_decodable_content_encoding(" GZip "));
+    REQUIRE(is_decodable_content_encoding("x-gzip"));
+    REQUIRE(is_decodable_content_encoding("deflate"));
+    REQUIRE(!is_decodable_content_encoding("br"));
+    REQUIRE(!is_decodable_content_encoding("gzip, gzip"));
+    REQUIRE(!is_decodable_content_encoding("identity"));
+}
+
+TEST_CASE("ContentDecoder works as expected") {
+    Error err;
+
+    SECTION("With gzip encoded data") {
+        REQUIRE(decode("gzip", compress(plaintext, 15 + 16), &err) ==
+                plaintext);
+        REQUIRE(err == NoError());
+    }
+
+    SECTION("With zlib wrapped deflate encoded data") {
+        REQUIRE(decode("deflate", compress(plaintext, 15), &err) ==
+                plaintext);
+        REQUIRE(err == NoError());
+    }
+
+    SECTION("With raw deflate encoded data") {
+        REQUIRE(decode("deflate", compress(plaintext, -15), &err) ==
+                plaintext);
+        REQUIRE(err == NoError());
+    }
+
+    SECTION("With an empty body") {
+        REQUIRE(decode("gzip", "", &err) == "");
+        REQUIRE(err == NoError());
+    }
+
+    SECTION("With truncated data") {
+        auto data = compress(plaintext, 15 + 16);
+        data.resize(data.size() / 2);
+        decode("gzip", data, &err);
+        REQUIRE(err == ContentDecodingError());
+    }
+
+    SECTION("With corrupt data") {
+        decode("gzip", plaintext, &err);
+        REQUIRE(err == ContentDecodingError());
+    }
+
+    SECTION("When the decoded body is too large") {
+        auto result = decode("gzip", compress(plaintext, 15 + 16), &err,
+                             plaintext.size() - 1);
+        REQUIRE(err == MaxDecompressedSizeExceededError());
+        REQUIRE(result.size() < plaintext.size());
+    }
+}
+
+TEST_CASE("ResponseParserNg decodes the body when asked to do so") {
+    auto encoded = compress(plaintext, 15 + 16);
+    std::string data;
+    data += "HTTP/1.1 200 Ok\r\n";
+    data += "Content-Encoding: gzip\r\n";
+    data += "Content-Length: " + std::to_string(encoded.size()) + "\r\n";
+    data += "\r\n";
+    data += encoded;
+
+    ResponseParserNg parser;
+    std::string body, raw_body;
+    bool called = false;
+    parser.on_body([&](std::string s) { body += s; });
+    parser.on_raw_body([&](std::string s) { raw_body += s; });
+    parser.on_end([&]() { called = true; });
+
+    SECTION("When decoding is enabled") {
+        parser.enable_content_decoding(1 << 20);
+        parser.feed(data);
+        REQUIRE(called);
+        REQUIRE(body == plaintext);
+        REQUIRE(raw_body == encoded);
+    }
+
+    SECTION("When decoding is not enabled") {
+        parser.feed(data);
+        REQUIRE(called);
+        REQUIRE(body == encoded);
+        REQUIRE(raw_body == "");
+    }
+
+    SECTION("When the decoded body exceeds the maximum size") {
+        parser.enable_content_decoding(1024);
+        try {
+            parser.feed(data);
+            REQUIRE(false); // Should not happen
+        } catch (const Error &err) {
+            REQUIRE(err == MaxDecompressedSizeExceededError());
+        }
+        REQUIRE(!called);
+    }
+}
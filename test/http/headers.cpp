@@ -14,3 +14,18 @@ TEST_CASE("HTTP headers search is case insensitive") {
     headers["Location"] = "https://www.x.org/";
     REQUIRE((headers["locAtion"] == "https://www.x.org/"));
 }
+
+TEST_CASE("http::header_has_token() works as expected") {
+    http::Headers headers;
+    REQUIRE(!http::header_has_token(headers, "Connection", "close"));
+    headers["Connection"] = "close";
+    REQUIRE(http::header_has_token(headers, "connection", "close"));
+    headers["Connection"] = "Close";
+    REQUIRE(http::header_has_token(headers, "Connection", "close"));
+    headers["Connection"] = "Keep-Alive ,\tCLOSE ";
+    REQUIRE(http::header_has_token(headers, "Connection", "close"));
+    headers["Connection"] = "keep-alive, , closed";
+    REQUIRE(!http::header_has_token(headers, "Connection", "close"));
+    headers["Connection"] = "";
+    REQUIRE(!http::header_has_token(headers, "Connection", "close"));
+}
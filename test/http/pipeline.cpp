@@ -0,0 +1,159 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include "src/libmeasurement_kit/http/pipeline.hpp"
+#include "src/libmeasurement_kit/net/emitter.hpp"
+
+using namespace mk;
+using namespace mk::net;
+using namespace mk::http;
+
+// Fake server that answers each request with `responses[i]` (or with the
+// last response, if there are fewer responses than requests) and that, like
+// a real socket, only delivers data when someone is reading.
+class FakeServer : public Emitter {
+  public:
+    FakeServer(SharedPtr<Reactor> r, SharedPtr<Logger> l) : Emitter(r, l) {}
+    ~FakeServer() override;
+
+    std::vector<std::string> responses;
+    size_t num_requests = 0;
+    size_t max_unanswered = 0;
+
+  protected:
+    void start_writing() override {
+        std::string s = output_buff.read();
+        for (size_t pos = 0; (pos = s.find("\r\n\r\n", pos)) !=
+                             std::string::npos; pos += 4) {
+            size_t idx = std::min(num_requests++, responses.size() - 1);
+            pending += responses[idx];
+        }
+        max_unanswered = std::max(max_unanswered, num_requests - answered);
+        reactor->call_soon([this]() { emit_flush(); });
+    }
+
+    void start_reading() override {
+        reactor->call_soon([this]() {
+            if (pending != "") {
+                answered = num_requests;
+                Buffer data{pending};
+                pending = "";
+                emit_data(data);
+            }
+        });
+    }
+
+  private:
+    size_t answered = 0;
+    std::string pending;
+};
+
+FakeServer::~FakeServer() {}
+
+static std::string make_response(std::string version, std::string body,
+                                 std::string extra = "") {
+    return version + " 200 Ok\r\nContent-Length: " +
+           std::to_string(body.size()) + "\r\n" + extra + "\r\n" + body;
+}
+
+static void run(SharedPtr<Reactor> reactor,
+                std::shared_ptr<FakeServer> server, size_t depth, int count,
+                std::vector<Error> &errors, std::vector<std::string> &bodies,
+                bool &broken) {
+    reactor->run_with_initial_event([&]() {
+        auto pipeline = Pipeline::make(SharedPtr<Transport>{server}, depth,
+                                       reactor);
+        for (int i = 0; i < count; ++i) {
+            pipeline->submit({{"http/url", "http://example.com/"},
+                              {"http/path", "/" + std::to_string(i)}},
+                             {}, "",
+                             [&, pipeline](Error err, SharedPtr<Response> r) {
+                                 errors.push_back(err);
+                                 bodies.push_back(r->body);
+                                 if ((int)errors.size() == count) {
+                                     broken = pipeline->broken();
+                                     reactor->stop();
+                                 }
+                             });
+        }
+    });
+}
+
+TEST_CASE("http::Pipeline works as expected") {
+    SharedPtr<Reactor> reactor = Reactor::make();
+    auto server = std::make_shared<FakeServer>(reactor, Logger::global());
+    std::vector<Error> errors;
+    std::vector<std::string> bodies;
+    bool broken = false;
+
+    SECTION("When the server supports pipelining") {
+        for (int i = 0; i < 6; ++i) {
+            server->responses.push_back(
+                  make_response("HTTP/1.1", "body" + std::to_string(i)));
+        }
+        run(reactor, server, 3, 6, errors, bodies, broken);
+        REQUIRE(errors.size() == 6);
+        for (int i = 0; i < 6; ++i) {
+            REQUIRE(errors[i] == NoError());
+            REQUIRE(bodies[i] == "body" + std::to_string(i));
+        }
+        REQUIRE(server->max_unanswered == 3);
+        REQUIRE(!broken);
+    }
+
+    SECTION("When the server speaks HTTP/1.0") {
+        server->responses.push_back(make_response("HTTP/1.0", "abc"));
+        run(reactor, server, 3, 4, errors, bodies, broken);
+        REQUIRE(errors.size() == 4);
+        for (auto &e : errors) {
+            REQUIRE(e == NoError());
+        }
+        REQUIRE(server->max_unanswered == 1);
+        REQUIRE(broken);
+    }
+
+    SECTION("When the connection is closed with requests in flight") {
+        server->responses.push_back(make_response("HTTP/1.1", "abc"));
+        server->responses.push_back(
+              make_response("HTTP/1.1", "abc", "Connection: close\r\n"));
+        run(reactor, server, 3, 4, errors, bodies, broken);
+        REQUIRE(errors.size() == 4);
+        REQUIRE(errors[0] == NoError());
+        REQUIRE(errors[1] == NoError());
+        REQUIRE(errors[2] == PipeliningBrokenError());
+        REQUIRE(errors[3] == PipeliningBrokenError());
+        REQUIRE(broken);
+    }
+}
+
+TEST_CASE("http::Pipeline does not reuse a connection being closed") {
+    SharedPtr<Reactor> reactor = Reactor::make();
+    auto server = std::make_shared<FakeServer>(reactor, Logger::global());
+    server->responses.push_back(
+          make_response("HTTP/1.1", "abc", "Connection: close\r\n"));
+    std::vector<Error> errors;
+    reactor->run_with_initial_event([&]() {
+        auto pipeline = Pipeline::make(SharedPtr<Transport>{server}, 3,
+                                       reactor);
+        Settings settings{{"http/url", "http://example.com/"}};
+        pipeline->submit(settings, {}, "",
+                         [&, pipeline, settings](Error err,
+                                                 SharedPtr<Response>) {
+            errors.push_back(err);
+            // Submit from within the callback of the closing response
+            pipeline->submit(settings, {}, "",
+                             [&](Error err, SharedPtr<Response>) {
+                errors.push_back(err);
+                reactor->stop();
+            });
+        });
+    });
+    REQUIRE(errors.size() == 2);
+    REQUIRE(errors[0] == NoError());
+    REQUIRE(errors[1] == PipeliningBrokenError());
+    REQUIRE(server->num_requests == 1);
+}
@@ -104,6 +104,34 @@ TEST_CASE("HTTP Request class works as expected with explicit path") {
     REQUIRE(serialized == expect);
 }
 
+TEST_CASE("HTTP Request class honours http/accept_encoding") {
+    Request request;
+
+    SECTION("When no Accept-Encoding header is passed") {
+        request.init(
+            {
+                {"http/url", "http://www.example.com/"},
+                {"http/accept_encoding", "gzip, deflate"},
+            },
+            {}, "");
+        REQUIRE(request.headers.at("Accept-Encoding") == "gzip, deflate");
+    }
+
+    SECTION("When an Accept-Encoding header is passed") {
+        request.init(
+            {
+                {"http/url", "http://www.example.com/"},
+                {"http/accept_encoding", "gzip, deflate"},
+            },
+            {
+                {"accept-encoding", "identity"},
+            },
+            "");
+        REQUIRE(request.headers.size() == 1);
+        REQUIRE(request.headers.at("Accept-Encoding") == "identity");
+    }
+}
+
 /*
  _             _
 | | ___   __ _(_) ___
@@ -270,6 +298,38 @@ TEST_CASE("http::request_recv_response() deals with immediate EOF") {
     });
 }
 
+TEST_CASE("http::request_recv_response() records timings") {
+    SharedPtr<Reactor> reactor = Reactor::make();
+    SharedPtr<Response> response;
+    reactor->run_with_initial_event([&]() {
+        connect("xxx.antani", 0,
+                [&](Error err, SharedPtr<Transport> transport) {
+                    REQUIRE(!err);
+                    request_recv_response(transport,
+                                          [&](Error e, SharedPtr<Response> r) {
+                                              REQUIRE(e == NoError());
+                                              response = r;
+                                              reactor->stop();
+                                          },
+                                          {}, reactor);
+                    Buffer data;
+                    data << "HTTP/1.1 200 Ok\r\n";
+                    data << "Content-Length: 7\r\n";
+                    data << "\r\n";
+                    data << "1234567";
+                    transport->emit_data(data);
+                },
+                {{"net/dumb_transport", true}});
+    });
+    REQUIRE(!!response);
+    auto &t = response->timings;
+    REQUIRE(t.first_byte > 0.0);
+    REQUIRE(t.headers_complete >= t.first_byte);
+    REQUIRE(t.body_complete >= t.headers_complete);
+    REQUIRE(t.request_written == 0.0); // We did not send any request
+    REQUIRE(t.connect.dns_start == 0.0); // Only set by request()
+}
+
 #define SOCKS_PORT_IS(port)                                                    \
     static void socks_port_is_##port(                                          \
         std::string, int, Callback<Error, SharedPtr<Transport>>, Settings settings,  \
@@ -207,3 +207,135 @@ TEST_CASE("verify_peer works as expected") {
         SSL_free(ssl);
     }
 }
+
+static SSL_SESSION *make_session(long lifetime) {
+    SSL_SESSION *session = SSL_SESSION_new();
+    REQUIRE(session != nullptr);
+    SSL_SESSION_set_time(session, (long)time(nullptr));
+    SSL_SESSION_set_timeout(session, lifetime);
+    return session;
+}
+
+TEST_CASE("SessionCache works as expected") {
+    SharedPtr<SessionCache> cache{new SessionCache{2, 3600}};
+
+    SECTION("get() returns nullptr for unknown keys") {
+        REQUIRE(cache->get("foo") == nullptr);
+        REQUIRE(cache->stats().lookups == 1);
+        REQUIRE(cache->stats().hits == 0);
+    }
+
+    SECTION("put() and get() work as expected") {
+        SSL_SESSION *session = make_session(300);
+        cache->put("foo", session);
+        SSL_SESSION *other = cache->get("foo");
+        REQUIRE(other == session);
+        SSL_SESSION_free(other);
+        SSL_SESSION_free(session);
+        REQUIRE(cache->size() == 1);
+        REQUIRE(cache->stats().stored == 1);
+        REQUIRE(cache->stats().hits == 1);
+    }
+
+    SECTION("put() replaces the session saved for a key") {
+        SSL_SESSION *first = make_session(300);
+        SSL_SESSION *second = make_session(300);
+        cache->put("foo", first);
+        cache->put("foo", second);
+        SSL_SESSION *session = cache->get("foo");
+        REQUIRE(session == second);
+        SSL_SESSION_free(session);
+        SSL_SESSION_free(first);
+        SSL_SESSION_free(second);
+        REQUIRE(cache->size() == 1);
+    }
+
+    SECTION("the least recently used session is evicted") {
+        SSL_SESSION *session = make_session(300);
+        cache->put("foo", session);
+        cache->put("bar", session);
+        SSL_SESSION_free(cache->get("foo"));
+        cache->put("baz", session);
+        SSL_SESSION_free(session);
+        REQUIRE(cache->size() == 2);
+        REQUIRE(cache->stats().evicted == 1);
+        REQUIRE(cache->get("bar") == nullptr);
+        session = cache->get("foo");
+        REQUIRE(session != nullptr);
+        SSL_SESSION_free(session);
+    }
+
+    SECTION("expired sessions are not returned") {
+        SSL_SESSION *session = make_session(300);
+        SSL_SESSION_set_time(session, (long)time(nullptr) - 301);
+        cache->put("foo", session);
+        SSL_SESSION_free(session);
+        REQUIRE(cache->get("foo") == nullptr);
+        REQUIRE(cache->size() == 0);
+        REQUIRE(cache->stats().expired == 1);
+    }
+
+    SECTION("sessions expire after max_lifetime") {
+        SharedPtr<SessionCache> short_cache{new SessionCache{2, 10}};
+        SSL_SESSION *session = make_session(300);
+        SSL_SESSION_set_time(session, (long)time(nullptr) - 11);
+        short_cache->put("foo", session);
+        SSL_SESSION_free(session);
+        REQUIRE(short_cache->get("foo") == nullptr);
+    }
+
+    SECTION("verified() is a no-op when resume() was not called") {
+        auto ssl = Cache<>{}.get_client_ssl(default_cert, "www.google.com",
+                                            Logger::global());
+        REQUIRE(!!ssl);
+        SessionCache::verified(*ssl, Logger::global());
+        REQUIRE(cache->size() == 0);
+        SSL_free(*ssl);
+    }
+
+    SECTION("resume() sets the saved session") {
+        auto ssl = Cache<>{}.get_client_ssl(default_cert, "www.google.com",
+                                            Logger::global());
+        REQUIRE(!!ssl);
+        SSL_SESSION *session = make_session(300);
+        cache->put("foo", session);
+        cache->resume(*ssl, "foo", Logger::global());
+        REQUIRE(SSL_get_session(*ssl) == session);
+        SSL_SESSION_free(session);
+        SSL_free(*ssl);
+    }
+}
+
+TEST_CASE("TrustStore works as expected") {
+    SECTION("shared() parses the same bundle only once") {
+        auto first = TrustStore::shared(default_cert, Logger::global());
+        REQUIRE(!!first);
+        auto second = std::async(std::launch::async, []() {
+            return TrustStore::shared(default_cert, Logger::global());
+        }).get();
+        REQUIRE(!!second);
+        REQUIRE(*first == *second);
+    }
+
+    SECTION("shared() does not cache failures") {
+        auto store = TrustStore::shared<SSL_CTX_new,
+                                        ssl_ctx_load_verify_locations_fail>(
+              default_cert, Logger::global());
+        REQUIRE(!store);
+        REQUIRE(store.as_error() == SslCtxLoadVerifyLocationsError());
+    }
+
+    SECTION("contexts created by different threads share the store") {
+        auto make = []() {
+            return Cache<>::thread_local_instance()->get_client_ssl(
+                  default_cert, "www.google.com", Logger::global());
+        };
+        auto first = std::async(std::launch::async, make).get();
+        auto second = std::async(std::launch::async, make).get();
+        REQUIRE(SSL_get_SSL_CTX(*first) != SSL_get_SSL_CTX(*second));
+        REQUIRE(SSL_CTX_get_cert_store(SSL_get_SSL_CTX(*first)) ==
+                SSL_CTX_get_cert_store(SSL_get_SSL_CTX(*second)));
+        SSL_free(*first);
+        SSL_free(*second);
+    }
+}
@@ -0,0 +1,211 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include "src/libmeasurement_kit/nettests/checkpoint.hpp"
+#include "src/libmeasurement_kit/nettests/runnable.hpp"
+
+#include <fstream>
+#include <set>
+
+#include <stdlib.h>
+
+using namespace mk;
+using namespace mk::nettests;
+
+static std::string make_temp_dir() {
+    char name[] = "/tmp/mk-checkpoint-XXXXXX";
+    REQUIRE(mkdtemp(name) != nullptr);
+    return name;
+}
+
+static std::vector<Json> read_report(std::string path) {
+    std::vector<Json> entries;
+    std::ifstream file{path};
+    std::string line;
+    while (std::getline(file, line)) {
+        entries.push_back(Json::parse(line));
+    }
+    return entries;
+}
+
+TEST_CASE("Checkpoint works as expected") {
+    std::string dir = make_temp_dir();
+    std::string path = dir + "/checkpoint.json";
+
+    SECTION("Done inputs are tracked compactly") {
+        Checkpoint checkpoint;
+        for (uint64_t index : {3, 0, 1, 7}) {
+            checkpoint.mark_done(index);
+        }
+        REQUIRE(checkpoint.done_below == 2);
+        REQUIRE((checkpoint.done == std::set<uint64_t>{3, 7}));
+        checkpoint.mark_done(2);
+        REQUIRE(checkpoint.done_below == 4);
+        REQUIRE((checkpoint.done == std::set<uint64_t>{7}));
+        REQUIRE(checkpoint.is_done(0));
+        REQUIRE(checkpoint.is_done(7));
+        REQUIRE(!checkpoint.is_done(4));
+    }
+
+    SECTION("A checkpoint can be saved and loaded") {
+        Checkpoint checkpoint;
+        checkpoint.output_filepath = "report.njson";
+        checkpoint.report_offset = 1234;
+        checkpoint.report_id = "xx";
+        checkpoint.randomized = true;
+        checkpoint.seed = 18446744073709551615ULL;
+        checkpoint.mark_done(0);
+        checkpoint.mark_done(5);
+        REQUIRE(!checkpoint.save(path, Logger::global()));
+        auto loaded = Checkpoint::load(path, Logger::global());
+        REQUIRE(!!loaded);
+        REQUIRE(loaded->output_filepath == "report.njson");
+        REQUIRE(loaded->report_offset == 1234);
+        REQUIRE(loaded->report_id == "xx");
+        REQUIRE(loaded->randomized);
+        REQUIRE(loaded->seed == 18446744073709551615ULL);
+        REQUIRE(loaded->done_below == 1);
+        REQUIRE((loaded->done == std::set<uint64_t>{5}));
+    }
+
+    SECTION("Loading fails for missing or invalid checkpoints") {
+        REQUIRE(Checkpoint::load(path, Logger::global()).as_error() ==
+                FileIoError());
+        std::ofstream{path} << "{\"output_filepath\": ";
+        REQUIRE(Checkpoint::load(path, Logger::global()).as_error() ==
+                JsonParseError());
+    }
+
+    REQUIRE(system(("rm -rf " + dir).c_str()) == 0);
+}
+
+// Simulates being killed by never completing the measurements after the
+// first `hang_after` ones, such that the reactor runs out of events
+class HangingRunnable : public Runnable {
+  public:
+    void main(std::string input, Settings options,
+              Callback<SharedPtr<report::Entry>> cb) override {
+        if (hang_after > 0 && started++ >= hang_after) {
+            return;
+        }
+        Runnable::main(input, options, cb);
+    }
+
+    int hang_after = 0;
+    int started = 0;
+};
+
+TEST_CASE("A killed test can be resumed") {
+    std::string dir = make_temp_dir();
+    std::string input_path = dir + "/input.txt";
+    {
+        std::ofstream input{input_path};
+        for (int i = 0; i < 100; ++i) {
+            input << "input-" << i << "\n";
+        }
+    }
+
+    // Runs the test until `kill_after` entries were produced, if nonzero,
+    // and otherwise until completion
+    auto run = [&](bool resume, int kill_after) {
+        HangingRunnable test;
+        test.hang_after = kill_after;
+        test.reactor = Reactor::make();
+        test.needs_input = true;
+        test.use_bouncer = false;
+        test.input_filepaths.push_back(input_path);
+        test.options["no_collector"] = true;
+        test.options["save_real_probe_asn"] = false;
+        test.options["save_real_probe_cc"] = false;
+        test.options["dns/nameserver"] = "127.0.0.1";
+        test.options["checkpoint_filepath"] = dir + "/checkpoint.json";
+        test.options["checkpoint_interval"] = 0.0;
+        test.options["resume"] = resume;
+        if (!resume) {
+            test.output_filepath = dir + "/report.njson";
+        }
+        int count = 0;
+        test.entry_cb = [&](std::string) { count += 1; };
+        test.reactor->run_with_initial_event([&]() {
+            test.begin([&](Error) {
+                test.end([&](Error) { test.reactor->stop(); });
+            });
+        });
+        return count;
+    };
+
+    REQUIRE(run(false, 40) == 40);
+    auto partial = read_report(dir + "/report.njson");
+    REQUIRE(partial.size() == 40);
+
+    // Simulate a crash in the middle of writing an entry
+    std::ofstream{dir + "/report.njson", std::ios::app} << "{\"annotat";
+
+    REQUIRE(run(true, 0) == 60);
+    auto entries = read_report(dir + "/report.njson");
+    std::set<std::string> inputs;
+    for (auto &entry : entries) {
+        inputs.insert(entry.at("input").get<std::string>());
+        // The inputs are still shuffled according to the same seed
+        REQUIRE(entry.at("annotations").at("input_shuffle_seed") ==
+                partial[0].at("annotations").at("input_shuffle_seed"));
+    }
+    REQUIRE(entries.size() == 100);
+    REQUIRE(inputs.size() == 100);
+
+    // There is nothing left to do when resuming a completed test
+    REQUIRE(run(true, 0) == 0);
+    REQUIRE(read_report(dir + "/report.njson").size() == 100);
+
+    REQUIRE(system(("rm -rf " + dir).c_str()) == 0);
+}
+
+#ifndef _WIN32
+
+TEST_CASE("A failed write does not advance the checkpoint") {
+    std::string dir = make_temp_dir();
+    std::string input_path = dir + "/input.txt";
+    {
+        std::ofstream input{input_path};
+        for (int i = 0; i < 10; ++i) {
+            input << "input-" << i << "\n";
+        }
+    }
+    Runnable test;
+    test.reactor = Reactor::make();
+    test.needs_input = true;
+    test.use_bouncer = false;
+    test.input_filepaths.push_back(input_path);
+    // Writing on /dev/full fails with ENOSPC. When compressing, entries
+    // are acknowledged before writing their frame, which then fails.
+    test.output_filepath = "/dev/full";
+    test.options["file_report_compression"] = "gzip";
+    test.options["file_report_frame_entries"] = 3;
+    test.options["no_collector"] = true;
+    test.options["save_real_probe_asn"] = false;
+    test.options["save_real_probe_cc"] = false;
+    test.options["dns/nameserver"] = "127.0.0.1";
+    test.options["checkpoint_filepath"] = dir + "/checkpoint.json";
+    test.options["checkpoint_interval"] = 0.0;
+    int count = 0;
+    test.entry_cb = [&](std::string) { count += 1; };
+    test.reactor->run_with_initial_event([&]() {
+        test.begin([&](Error) {
+            test.end([&](Error) { test.reactor->stop(); });
+        });
+    });
+    REQUIRE(count == 10);
+    auto checkpoint = Checkpoint::load(dir + "/checkpoint.json",
+                                       Logger::global());
+    REQUIRE(!!checkpoint);
+    REQUIRE(checkpoint->report_offset == 0);
+    REQUIRE(checkpoint->done_below == 0);
+    REQUIRE(checkpoint->done.empty());
+    REQUIRE(system(("rm -rf " + dir).c_str()) == 0);
+}
+
+#endif
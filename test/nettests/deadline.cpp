@@ -0,0 +1,116 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include "src/libmeasurement_kit/common/utils.hpp"
+#include "src/libmeasurement_kit/nettests/runnable.hpp"
+
+#include <measurement_kit/net.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace mk;
+using namespace mk::nettests;
+
+// Connects to a server that never answers, and reports what it measured
+// when the connection fails, unless `hang` is true, in which case it never
+// calls back at all
+class SlowRunnable : public Runnable {
+  public:
+    void main(std::string, Settings settings,
+              Callback<SharedPtr<report::Entry>> cb) override {
+        if (hang) {
+            return;
+        }
+        net::connect("127.0.0.1", port,
+                     [=](Error err, SharedPtr<net::Transport> txp) {
+                         SharedPtr<report::Entry> entry{new report::Entry};
+                         (*entry)["connected"] = !err;
+                         if (err) {
+                             (*entry)["failure"] = err.reason;
+                             cb(entry);
+                             return;
+                         }
+                         txp->on_data([](net::Buffer) {});
+                         txp->on_error([=](Error err) {
+                             (*entry)["failure"] = err.reason;
+                             txp->close([=]() { cb(entry); });
+                         });
+                     },
+                     settings, reactor, logger);
+    }
+
+    int port = 0;
+    bool hang = false;
+};
+
+static std::vector<Json> run(bool hang, double &elapsed) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(fd >= 0);
+    sockaddr_in sin{};
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    REQUIRE(bind(fd, (sockaddr *)&sin, sizeof(sin)) == 0);
+    REQUIRE(listen(fd, 10) == 0);
+    socklen_t len = sizeof(sin);
+    REQUIRE(getsockname(fd, (sockaddr *)&sin, &len) == 0);
+
+    SlowRunnable test;
+    test.port = ntohs(sin.sin_port);
+    test.hang = hang;
+    test.reactor = Reactor::make();
+    test.needs_input = true;
+    test.use_bouncer = false;
+    test.inputs = {"a", "b"};
+    test.options["no_collector"] = true;
+    test.options["no_file_report"] = true;
+    test.options["save_real_probe_asn"] = false;
+    test.options["save_real_probe_cc"] = false;
+    test.options["dns/nameserver"] = "127.0.0.1";
+    test.options["net/timeout"] = 30.0;
+    test.options["max_measurement_runtime"] = 0.5;
+    std::vector<Json> entries;
+    test.entry_cb = [&](std::string s) { entries.push_back(Json::parse(s)); };
+    double begin = time_now();
+    test.reactor->run_with_initial_event([&]() {
+        test.begin([&](Error err) {
+            REQUIRE(!err);
+            test.end([&](Error) {});
+        });
+    });
+    elapsed = time_now() - begin;
+    close(fd);
+    return entries;
+}
+
+TEST_CASE("Measurements are interrupted at their deadline") {
+    double elapsed = 0.0;
+
+    SECTION("The entry contains what was measured so far") {
+        auto entries = run(false, elapsed);
+        REQUIRE(entries.size() == 2);
+        for (auto &entry : entries) {
+            REQUIRE(entry["test_keys"]["failure"] == "deadline_exceeded");
+            REQUIRE(entry["test_keys"]["connected"] == true);
+            REQUIRE(entry["test_runtime"].get<double>() < 1.0);
+        }
+        REQUIRE(elapsed < 10.0);
+    }
+
+    SECTION("A measurement that does not stop is given up") {
+        auto entries = run(true, elapsed);
+        REQUIRE(entries.size() == 2);
+        for (auto &entry : entries) {
+            REQUIRE(entry["test_keys"]["failure"] == "deadline_exceeded");
+            REQUIRE(entry["test_keys"].count("connected") == 0);
+            REQUIRE(entry["test_runtime"].get<double>() >= 1.5);
+        }
+        REQUIRE(elapsed < 10.0);
+    }
+}
@@ -0,0 +1,162 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include "src/libmeasurement_kit/nettests/host_scheduler.hpp"
+#include "src/libmeasurement_kit/nettests/runnable.hpp"
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+using namespace mk;
+using namespace mk::nettests;
+
+static SharedPtr<InputSource> make_source(std::deque<std::string> inputs,
+                                          bool randomize = false) {
+    Settings options;
+    options["randomize_input"] = randomize;
+    options["input_shuffle_seed"] = 17;
+    auto source = InputSource::open(inputs, true, {}, "ZZ", options,
+                                    Logger::global());
+    REQUIRE(!!source);
+    return *source;
+}
+
+TEST_CASE("HostScheduler::host_of() works as expected") {
+    REQUIRE(HostScheduler::host_of("http://www.Example.com/foo") ==
+            "www.example.com");
+    REQUIRE(HostScheduler::host_of("https://example.com:8443/") ==
+            "example.com");
+    REQUIRE(HostScheduler::host_of("example.com:80") == "example.com");
+    REQUIRE(HostScheduler::host_of("Example.com") == "example.com");
+    REQUIRE(HostScheduler::host_of("[::1]:80") == "[::1]:80");
+}
+
+TEST_CASE("HostScheduler works as expected") {
+    SECTION("Invalid options are rejected") {
+        auto source = make_source({"x"});
+        REQUIRE(HostScheduler::make(source, {{"max_parallelism_per_host", 0}},
+                                    Logger::global())
+                      .as_error() == ValueError());
+        REQUIRE(HostScheduler::make(source, {{"input_host_lookahead", 0}},
+                                    Logger::global())
+                      .as_error() == ValueError());
+    }
+
+    SECTION("The inputs of the same host are measured one after the other") {
+        HostScheduler scheduler{
+              make_source({"http://a/1", "http://b/1", "http://a/2",
+                           "http://c/1", "http://b/2", "http://a/3"}),
+              1, 1024};
+        std::vector<std::string> order;
+        std::string input;
+        uint64_t index = 0;
+        bool wait = false;
+        // Measure sequentially, such that a host is never busy
+        while (scheduler.next(input, index, wait)) {
+            order.push_back(input);
+            scheduler.done(input);
+        }
+        REQUIRE(!wait);
+        REQUIRE((order == std::vector<std::string>{
+                               "http://a/1", "http://a/2", "http://a/3",
+                               "http://b/1", "http://b/2", "http://c/1"}));
+    }
+
+    SECTION("Hosts are interleaved when busy") {
+        HostScheduler scheduler{
+              make_source({"http://a/1", "http://a/2", "http://a/3",
+                           "http://b/1", "http://b/2"}),
+              2, 1024};
+        std::string input;
+        uint64_t index = 0;
+        bool wait = false;
+        std::vector<std::string> running;
+        while (scheduler.next(input, index, wait)) {
+            running.push_back(input);
+        }
+        // Two of `a`, because of the cap, and then what is left of `b`
+        REQUIRE((running == std::vector<std::string>{
+                                 "http://a/1", "http://a/2", "http://b/1",
+                                 "http://b/2"}));
+        REQUIRE(wait);
+        scheduler.done("http://b/1");
+        REQUIRE(!scheduler.next(input, index, wait));
+        REQUIRE(wait);
+        scheduler.done("http://a/1");
+        REQUIRE(scheduler.next(input, index, wait));
+        REQUIRE(input == "http://a/3");
+        REQUIRE(index == 2);
+        REQUIRE(!scheduler.next(input, index, wait));
+        REQUIRE(!wait);
+    }
+
+    SECTION("The lookahead is bounded") {
+        HostScheduler scheduler{
+              make_source({"http://a/1", "http://b/1", "http://a/2"}), 1, 2};
+        std::string input;
+        uint64_t index = 0;
+        bool wait = false;
+        REQUIRE(scheduler.next(input, index, wait));
+        REQUIRE(input == "http://a/1");
+        scheduler.done(input);
+        // `a/2` was not read yet, so `b` is the only host with input
+        REQUIRE(scheduler.next(input, index, wait));
+        REQUIRE(input == "http://b/1");
+    }
+}
+
+// Checks that no more than one measurement per host runs at a time
+class PerHostRunnable : public Runnable {
+  public:
+    void main(std::string input, Settings,
+              Callback<SharedPtr<report::Entry>> cb) override {
+        std::string host = HostScheduler::host_of(input);
+        REQUIRE(active[host] == 0);
+        active[host] += 1;
+        order.push_back(host);
+        reactor->call_soon([=]() {
+            active[host] -= 1;
+            cb(SharedPtr<report::Entry>{new report::Entry});
+        });
+    }
+
+    std::map<std::string, int> active;
+    std::vector<std::string> order;
+};
+
+TEST_CASE("Runnable can schedule the input by host") {
+    PerHostRunnable test;
+    test.reactor = Reactor::make();
+    test.needs_input = true;
+    test.use_bouncer = false;
+    for (int i = 0; i < 40; ++i) {
+        test.inputs.push_back("https://host-" + std::to_string(i % 4) +
+                              ".example.com/" + std::to_string(i));
+    }
+    test.options["no_collector"] = true;
+    test.options["no_file_report"] = true;
+    test.options["save_real_probe_asn"] = false;
+    test.options["save_real_probe_cc"] = false;
+    test.options["dns/nameserver"] = "127.0.0.1";
+    test.options["schedule_input_by_host"] = true;
+    test.options["parallelism"] = 6; // More than the number of hosts
+    std::set<std::string> inputs;
+    test.entry_json_cb = [&](const report::Entry &entry) {
+        inputs.insert(entry.at("input").get<std::string>());
+    };
+    Error error = GenericError();
+    test.reactor->run_with_initial_event([&]() {
+        test.begin([&](Error err) {
+            error = err;
+            test.end([&](Error) { test.reactor->stop(); });
+        });
+    });
+    REQUIRE(error == NoError());
+    REQUIRE(inputs.size() == 40);
+    REQUIRE(test.order.size() == 40);
+}
@@ -0,0 +1,137 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include "src/libmeasurement_kit/nettests/input_source.hpp"
+
+#include <measurement_kit/ooni.hpp>
+
+#include <algorithm>
+#include <fstream>
+
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace mk;
+using namespace mk::nettests;
+
+static std::string make_input_file(size_t count) {
+    char name[] = "/tmp/mk-input-XXXXXX";
+    int fd = mkstemp(name);
+    REQUIRE(fd >= 0);
+    close(fd);
+    std::ofstream file{name};
+    for (size_t i = 0; i < count; ++i) {
+        file << i << "\n";
+    }
+    return name;
+}
+
+static std::vector<std::string> drain(SharedPtr<InputSource> source) {
+    std::vector<std::string> result;
+    std::string input;
+    while (source->next(input)) {
+        result.push_back(input);
+    }
+    return result;
+}
+
+static ErrorOr<SharedPtr<InputSource>>
+open_source(std::list<std::string> paths, Settings settings) {
+    return InputSource::open({}, true, paths, "IT", settings,
+                             Logger::global());
+}
+
+TEST_CASE("InputSource works as expected") {
+    std::string path = make_input_file(1000);
+
+    SECTION("A test that needs no input runs exactly once") {
+        auto source = InputSource::open({"a", "b"}, false, {path}, "IT", {},
+                                        Logger::global());
+        REQUIRE(!!source);
+        REQUIRE(drain(*source) == std::vector<std::string>{""});
+    }
+
+    SECTION("Input is required") {
+        auto source = open_source({}, {});
+        REQUIRE(source.as_error() == ooni::MissingRequiredInputFileError());
+    }
+
+    SECTION("At least an input must be readable") {
+        auto source = open_source({"./nonexistent", "/tmp"}, {});
+        REQUIRE(source.as_error() == ooni::CannotReadAnyInputFileError());
+    }
+
+    SECTION("Invalid options are rejected") {
+        REQUIRE(open_source({path}, {{"randomize_input", "antani"}})
+                      .as_error() == ValueError());
+        REQUIRE(open_source({path}, {{"input_shuffle_window", 0}})
+                      .as_error() == ValueError());
+        REQUIRE(open_source({path}, {{"input_shuffle_seed", "x"}})
+                      .as_error() == ValueError());
+    }
+
+    SECTION("Without randomization the order is preserved") {
+        auto source = InputSource::open({"a", "b"}, true,
+                                        {"./nonexistent", path}, "IT",
+                                        {{"randomize_input", false}},
+                                        Logger::global());
+        REQUIRE(!!source);
+        REQUIRE(!(*source)->randomized());
+        REQUIRE((*source)->progress() == 0.0);
+        std::vector<std::string> inputs = drain(*source);
+        REQUIRE(inputs.size() == 1002);
+        REQUIRE(inputs[0] == "a");
+        REQUIRE(inputs[1] == "b");
+        for (size_t i = 0; i < 1000; ++i) {
+            REQUIRE(inputs[i + 2] == std::to_string(i));
+        }
+        REQUIRE((*source)->progress() == 1.0);
+    }
+
+    SECTION("The ${probe_cc} variable is expanded") {
+        std::string dir = path.substr(0, path.rfind('/'));
+        std::string name = path.substr(path.rfind('/') + 1);
+        REQUIRE(rename(path.c_str(), (dir + "/it-" + name).c_str()) == 0);
+        path = dir + "/it-" + name;
+        auto source = open_source({dir + "/${probe_cc}-" + name}, {});
+        REQUIRE(!!source);
+        REQUIRE(drain(*source).size() == 1000);
+    }
+
+    SECTION("The order is a permutation that depends only on the seed") {
+        Settings settings{{"input_shuffle_seed", "12345678901234"}};
+        auto first = open_source({path}, settings);
+        REQUIRE(!!first);
+        REQUIRE((*first)->randomized());
+        REQUIRE((*first)->seed() == 12345678901234ULL);
+        std::vector<std::string> inputs = drain(*first);
+        REQUIRE(drain(*open_source({path}, settings)) == inputs);
+        std::vector<std::string> sorted = inputs;
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const std::string &a, const std::string &b) {
+                      return std::stoi(a) < std::stoi(b);
+                  });
+        REQUIRE(sorted == drain(*open_source({path}, {{"randomize_input",
+                                                       false}})));
+        REQUIRE(inputs != sorted);
+        settings["input_shuffle_seed"] = 17;
+        REQUIRE(drain(*open_source({path}, settings)) != inputs);
+    }
+
+    SECTION("Only a window of the input is kept in memory") {
+        auto source = open_source({path}, {{"input_shuffle_window", 10}});
+        REQUIRE(!!source);
+        std::vector<std::string> inputs = drain(*source);
+        REQUIRE(inputs.size() == 1000);
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            // The i-th input must be among the first i + 10 lines
+            REQUIRE(std::stoul(inputs[i]) < i + 10);
+        }
+    }
+
+    REQUIRE(unlink(path.c_str()) == 0);
+}
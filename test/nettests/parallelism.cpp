@@ -0,0 +1,203 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include "src/libmeasurement_kit/nettests/parallelism.hpp"
+#include "src/libmeasurement_kit/nettests/runnable.hpp"
+
+#include <measurement_kit/net.hpp>
+
+#include <algorithm>
+
+using namespace mk;
+using namespace mk::nettests;
+
+static SharedPtr<ParallelismController> make(Settings options) {
+    auto pc = ParallelismController::make(options, Logger::global());
+    REQUIRE(!!pc);
+    return *pc;
+}
+
+TEST_CASE("ParallelismController works as expected") {
+    SECTION("By default the parallelism is fixed") {
+        auto pc = make({{"parallelism", 5}});
+        REQUIRE(!pc->adaptive());
+        for (int i = 0; i < 100; ++i) {
+            REQUIRE(!pc->on_measurement(0.1, ""));
+        }
+        REQUIRE(!pc->on_measurement(10.0, "generic_timeout_error"));
+        REQUIRE(pc->window() == 5);
+    }
+
+    SECTION("Invalid options are rejected") {
+        for (Settings options : std::vector<Settings>{
+                   {{"parallelism", 0}},
+                   {{"parallelism", "x"}},
+                   {{"adaptive_parallelism", true}, {"parallelism_min", 0}},
+                   {{"adaptive_parallelism", true},
+                    {"parallelism_min", 8},
+                    {"parallelism_max", 4}},
+                   {{"adaptive_parallelism", true},
+                    {"parallelism_latency_ratio", 0.5}},
+             }) {
+            REQUIRE(ParallelismController::make(options, Logger::global())
+                          .as_error() == ValueError());
+        }
+    }
+
+    SECTION("The window grows additively up to the maximum") {
+        auto pc = make({{"adaptive_parallelism", true},
+                        {"parallelism", 2},
+                        {"parallelism_max", 10}});
+        REQUIRE(pc->window() == 2);
+        size_t changes = 0;
+        // Growing by one takes about as many measurements as the window
+        for (int i = 0; i < 11; ++i) {
+            changes += pc->on_measurement(0.1, "") ? 1 : 0;
+        }
+        REQUIRE(pc->window() == 5);
+        REQUIRE(changes == 3);
+        for (int i = 0; i < 1000; ++i) {
+            pc->on_measurement(0.1, "");
+        }
+        REQUIRE(pc->window() == std::min<size_t>(10, pc->maximum()));
+    }
+
+    SECTION("The window is cut in half on timeouts and EMFILE") {
+        auto pc = make({{"adaptive_parallelism", true},
+                        {"parallelism", 16},
+                        {"parallelism_max", 16}});
+        if (pc->maximum() < 16) {
+            return; // Too few file descriptors for this test
+        }
+        REQUIRE(pc->on_measurement(10.0, "generic_timeout_error"));
+        REQUIRE(pc->window() == 8);
+        // The measurements that were running at the time of the cut are
+        // likely to fail as well, and must not cut it again
+        for (int i = 0; i < 7; ++i) {
+            REQUIRE(!pc->on_measurement(10.0, "generic_timeout_error"));
+        }
+        REQUIRE(pc->on_measurement(
+              0.1, net::TooManyFilesOpenError().reason));
+        REQUIRE(pc->window() == 4);
+        for (int i = 0; i < 100; ++i) {
+            pc->on_measurement(10.0, "generic_timeout_error");
+        }
+        REQUIRE(pc->window() == pc->minimum());
+    }
+
+    SECTION("The window does not grow when latency increases") {
+        auto pc = make({{"adaptive_parallelism", true},
+                        {"parallelism", 4}});
+        for (int i = 0; i < 8; ++i) {
+            pc->on_measurement(0.1, "");
+        }
+        size_t window = pc->window();
+        for (int i = 0; i < 100; ++i) {
+            pc->on_measurement(1.0, "");
+        }
+        // It may have grown a bit before the average exceeded the limit
+        REQUIRE(pc->window() <= window + 1);
+    }
+
+    SECTION("The window does not grow when many measurements fail") {
+        auto pc = make({{"adaptive_parallelism", true},
+                        {"parallelism", 4}});
+        for (int i = 0; i < 100; ++i) {
+            REQUIRE(!pc->on_measurement(0.1, "connection_refused"));
+        }
+        REQUIRE(pc->window() == 4);
+    }
+
+    SECTION("The window is bounded by the limit on open files") {
+        size_t limit = ParallelismController::fd_limit();
+        auto pc = make({{"adaptive_parallelism", true},
+                        {"parallelism_max", 1000000}});
+        if (limit > 0) {
+            REQUIRE(pc->maximum() == limit);
+        } else {
+            REQUIRE(pc->maximum() == 1000000);
+        }
+    }
+}
+
+// Counts the measurements running at the same time, and makes them time
+// out for a while, in the middle of the test
+class CongestedRunnable : public Runnable {
+  public:
+    void main(std::string, Settings,
+              Callback<SharedPtr<report::Entry>> cb) override {
+        size_t n = started++;
+        running += 1;
+        max_running = std::max(max_running, running);
+        reactor->call_soon([=]() {
+            running -= 1;
+            SharedPtr<report::Entry> entry{new report::Entry};
+            (*entry)["failure"] = nullptr;
+            if (n >= 100 && n < 120) {
+                (*entry)["failure"] = "generic_timeout_error";
+            }
+            cb(entry);
+        });
+    }
+
+    size_t started = 0;
+    size_t running = 0;
+    size_t max_running = 0;
+};
+
+TEST_CASE("Runnable adapts the number of parallel measurements") {
+    CongestedRunnable test;
+    test.reactor = Reactor::make();
+    test.needs_input = true;
+    test.use_bouncer = false;
+    for (int i = 0; i < 200; ++i) {
+        test.inputs.push_back("input-" + std::to_string(i));
+    }
+    test.options["no_collector"] = true;
+    test.options["no_file_report"] = true;
+    test.options["save_real_probe_asn"] = false;
+    test.options["save_real_probe_cc"] = false;
+    test.options["dns/nameserver"] = "127.0.0.1";
+    test.options["adaptive_parallelism"] = true;
+    test.options["parallelism"] = 2;
+    test.options["parallelism_max"] = 16;
+    std::vector<Json> events;
+    test.logger->set_verbosity(MK_LOG_INFO); // Needed to see the events
+    test.logger->on_log([](uint32_t, const char *) {});
+    test.logger->on_event([&](const char *s) {
+        Json event = Json::parse(s);
+        if (event.at("type") == "parallelism") {
+            events.push_back(event);
+        }
+    });
+    size_t entries = 0;
+    test.entry_cb = [&](std::string) { entries += 1; };
+    Error error = GenericError();
+    test.reactor->run_with_initial_event([&]() {
+        test.begin([&](Error err) {
+            error = err;
+            test.end([&](Error) { test.reactor->stop(); });
+        });
+    });
+    REQUIRE(error == NoError());
+    REQUIRE(entries == 200);
+    REQUIRE(test.max_running > 2);
+    REQUIRE(test.max_running <= 16);
+    REQUIRE(events.size() > 1);
+    REQUIRE(events[0].at("window") == 2);
+    size_t max_window = 0;
+    bool decreased = false;
+    for (size_t i = 1; i < events.size(); ++i) {
+        size_t window = events[i].at("window");
+        max_window = std::max(max_window, window);
+        decreased = decreased || window < events[i - 1].at("window");
+    }
+    REQUIRE(test.max_running <= max_window);
+    REQUIRE(decreased);
+    // The slots that ended were reused
+    REQUIRE(error.child_errors.size() <= max_window);
+}
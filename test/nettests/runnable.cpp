@@ -1,7 +1,6 @@
 // Part of Measurement Kit <https://measurement-kit.github.io/>.
 // Measurement Kit is free software under the BSD license. See AUTHORS
 // and LICENSE for more information on the copying conditions.
-#ifdef ENABLE_INTEGRATION_TESTS
 
 #define CATCH_CONFIG_MAIN
 #include "src/libmeasurement_kit/ext/catch.hpp"
@@ -11,6 +10,37 @@
 using namespace mk::nettests;
 using namespace mk;
 
+TEST_CASE("The entry callbacks see the report ID") {
+    Runnable test;
+    test.reactor = Reactor::make();
+    test.use_bouncer = false;
+    // Reuse a report ID, such that we do not need to open a report (but
+    // submitting the entry fails, which by default is not fatal)
+    test.options["collector_base_url"] = "http://127.0.0.1:1";
+    test.options["collector_report_id"] = "xx";
+    test.options["no_file_report"] = true;
+    test.options["save_real_probe_asn"] = false;
+    test.options["save_real_probe_cc"] = false;
+    test.options["dns/nameserver"] = "127.0.0.1";
+    std::string json_report_id;
+    test.entry_json_cb = [&](const report::Entry &entry) {
+        json_report_id = entry.at("report_id").get<std::string>();
+    };
+    std::string report_id;
+    test.entry_cb = [&](std::string s) {
+        report_id = Json::parse(s).at("report_id").get<std::string>();
+    };
+    test.reactor->run_with_initial_event([&]() {
+        test.begin([&](Error) {
+            test.end([&](Error) { test.reactor->stop(); });
+        });
+    });
+    REQUIRE(json_report_id == "xx");
+    REQUIRE(report_id == "xx");
+}
+
+#ifdef ENABLE_INTEGRATION_TESTS
+
 TEST_CASE("Make sure that on_entry() works") {
     test::nettests::with_runnable([](nettests::Runnable &test) {
         test.reactor = Reactor::make();
@@ -201,6 +231,4 @@ TEST_CASE("Make sure that 'randomize_input' works") {
     }
 }
 
-#else
-int main() {}
 #endif
@@ -0,0 +1,144 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include "src/libmeasurement_kit/net/emitter.hpp"
+#include "src/libmeasurement_kit/neubot/dash_impl.hpp"
+
+#include <deque>
+#include <string>
+
+using namespace mk;
+using namespace mk::neubot;
+
+// Transport that remembers the sizes of the chunks that were requested
+// and whether it was closed, so that the mocks below can answer.
+class FakeTransport : public net::Emitter {
+  public:
+    FakeTransport(SharedPtr<Reactor> r, SharedPtr<Logger> l) : Emitter(r, l) {}
+    ~FakeTransport() override;
+
+    bool closed = false;
+    std::deque<size_t> requested;
+    int responses = 0;
+
+  protected:
+    void shutdown() override { closed = true; }
+};
+
+FakeTransport::~FakeTransport() {}
+
+static int connections = 0;
+
+// What the pipelined server does with the second response
+static std::string second_response_is = "";
+
+static void connect_ok(Settings, Callback<Error, SharedPtr<net::Transport>> cb,
+                       SharedPtr<Reactor> reactor, SharedPtr<Logger> logger) {
+    connections += 1;
+    cb(NoError(), SharedPtr<net::Transport>{
+                        std::make_shared<FakeTransport>(reactor, logger)});
+}
+
+static void send_ok(SharedPtr<net::Transport> txp, Settings settings,
+                    http::Headers headers, std::string body,
+                    SharedPtr<Logger>, Callback<Error, SharedPtr<http::Request>> cb) {
+    auto fake = static_cast<FakeTransport *>(txp.get());
+    if (fake->closed) {
+        cb(net::EofError(), {});
+        return;
+    }
+    std::string path = settings.get<std::string>("http/path", "");
+    fake->requested.push_back(std::stoul(path.substr(path.rfind('/') + 1)));
+    cb(NoError(), *http::Request::make(settings, headers, body));
+}
+
+static void respond(SharedPtr<net::Transport> txp,
+                    Callback<Error, SharedPtr<http::Response>> cb,
+                    SharedPtr<Reactor> reactor, bool pipelined) {
+    // Answer a bit later, such that the elapsed time is positive
+    reactor->call_later(0.001, [=]() {
+        auto fake = static_cast<FakeTransport *>(txp.get());
+        if (fake->closed || fake->requested.empty()) {
+            cb(net::EofError(), {});
+            return;
+        }
+        SharedPtr<http::Response> res{std::make_shared<http::Response>()};
+        res->http_major = 1;
+        res->http_minor = 1;
+        res->status_code = 200;
+        size_t length = fake->requested.front();
+        fake->requested.pop_front();
+        if (pipelined && ++fake->responses == 2) {
+            if (second_response_is == "too_long") {
+                length += 1;
+            } else if (second_response_is == "closing") {
+                res->headers["Connection"] = "Close";
+            }
+        }
+        res->body = std::string(length, 'x');
+        cb(NoError(), res);
+    });
+}
+
+static void recv_ok(SharedPtr<net::Transport> txp,
+                    Callback<Error, SharedPtr<http::Response>> cb, Settings,
+                    SharedPtr<Reactor> reactor, SharedPtr<Logger>) {
+    respond(txp, cb, reactor, false);
+}
+
+static void recv_pipelined_ok(SharedPtr<net::Transport> txp,
+                              SharedPtr<net::Buffer>,
+                              Callback<Error, SharedPtr<http::Response>> cb,
+                              Settings, SharedPtr<Reactor> reactor,
+                              SharedPtr<Logger>) {
+    respond(txp, cb, reactor, true);
+}
+
+static Error run_dash(SharedPtr<report::Entry> entry) {
+    SharedPtr<Reactor> reactor = Reactor::make();
+    Settings settings{{"constant_bitrate", 8},
+                      {"http/url", "http://127.0.0.1/"},
+                      {"max_iteration", 6},
+                      {"pipeline_depth", 3}};
+    Error error = GenericError("not_called");
+    connections = 0;
+    reactor->run_with_initial_event([&]() {
+        dash::run_impl<connect_ok, send_ok, recv_ok, recv_pipelined_ok>(
+              "http://127.0.0.1/", "", "127.0.0.1", entry, settings, reactor,
+              Logger::global(), [&](Error err) {
+                  error = err;
+                  reactor->stop();
+              });
+    });
+    return error;
+}
+
+TEST_CASE("dash::run_impl() deals with pipelining") {
+    SharedPtr<report::Entry> entry{new report::Entry};
+
+    SECTION("When pipelining works") {
+        second_response_is = "";
+        REQUIRE(run_dash(entry) == NoError());
+        REQUIRE(connections == 1);
+        REQUIRE((*entry)["receiver_data"].size() == 6);
+    }
+
+    SECTION("When a response has not the requested length") {
+        second_response_is = "too_long";
+        REQUIRE(run_dash(entry) == NoError());
+        REQUIRE(connections == 2);
+        // The response after which pipelining broke was not accounted
+        REQUIRE((*entry)["receiver_data"].size() == 6);
+    }
+
+    SECTION("When a response closes the connection") {
+        second_response_is = "closing";
+        REQUIRE(run_dash(entry) == dash::MiddleboxDetectedError());
+        REQUIRE(connections == 1);
+        REQUIRE((*entry)["receiver_data"].size() == 1);
+    }
+}
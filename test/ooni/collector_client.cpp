@@ -334,6 +334,31 @@ TEST_CASE("collector::update_report deals with entry with missing key") {
     });
 }
 
+static void check_body(SharedPtr<Transport>, std::string path,
+                       std::string body, Callback<Error, Json> cb, Settings,
+                       SharedPtr<Reactor>, SharedPtr<Logger>) {
+    REQUIRE(path == "/report/xx");
+    Json expect;
+    expect["format"] = "json";
+    expect["content"] = static_cast<const Json &>(ENTRY);
+    expect["content"]["report_id"] = "xx";
+    REQUIRE(body == expect.dump());
+    cb(NoError(), nullptr);
+}
+
+TEST_CASE("collector::update_report does not reserialize the entry") {
+    SharedPtr<Reactor> reactor = Reactor::make();
+    reactor->run_with_initial_event([=]() {
+        collector::update_report_impl<check_body>(
+        nullptr, "xx", ENTRY,
+        [=](Error err) {
+            REQUIRE(err == NoError());
+            reactor->stop();
+        },
+        {}, reactor, Logger::global());
+    });
+}
+
 TEST_CASE("collector::get_next_entry() works correctly at EOF") {
     SharedPtr<std::istream> input(new std::istringstream(""));
     ErrorOr<Entry> entry = collector::get_next_entry(input, Logger::global());
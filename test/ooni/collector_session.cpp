@@ -0,0 +1,196 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include "src/libmeasurement_kit/common/utils.hpp"
+#include "src/libmeasurement_kit/ooni/collector_session.hpp"
+
+#include <event2/http.h>
+
+#include <set>
+#include <string>
+
+using namespace mk;
+using namespace mk::ooni;
+using namespace mk::report;
+
+static Entry ENTRY{
+    {"data_format_version", "0.2.0"},
+    {"input", "torproject.org"},
+    {"measurement_start_time", "2016-06-04 17:53:13"},
+    {"probe_asn", "AS0"},
+    {"probe_cc", "ZZ"},
+    {"probe_ip", "127.0.0.1"},
+    {"report_id", "xx"},
+    {"software_name", "measurement_kit"},
+    {"software_version", "0.2.0-alpha.1+11.1"},
+    {"test_keys", {{"failure", nullptr}}},
+    {"test_name", "tcp_connect"},
+    {"test_runtime", 0.253494024276733},
+    {"test_start_time", "2016-06-04 17:53:13"},
+    {"test_version", "0.0.1"},
+};
+
+// Local stand-in for the collector, running in the reactor's event base,
+// that accepts all entries and counts connections and requests. Unless it
+// is keeping connections alive, it sends `Connection: <closing>`.
+class FakeCollector {
+  public:
+    FakeCollector(SharedPtr<Reactor> reactor, bool keep_alive,
+                  std::string closing = "close")
+        : closing_{closing}, keep_alive_{keep_alive} {
+        http_ = evhttp_new(reactor->get_event_base());
+        REQUIRE(http_ != nullptr);
+        evhttp_set_gencb(http_, on_request, this);
+        auto handle = evhttp_bind_socket_with_handle(http_, "127.0.0.1", 0);
+        REQUIRE(handle != nullptr);
+        sockaddr_storage ss{};
+        ev_socklen_t sslen = sizeof(ss);
+        REQUIRE(getsockname(evhttp_bound_socket_get_fd(handle),
+                            (sockaddr *)&ss, &sslen) == 0);
+        port_ = ntohs(((sockaddr_in *)&ss)->sin_port);
+    }
+
+    ~FakeCollector() { stop(); }
+
+    // Note: the reactor does not leave the loop while the server is active
+    void stop() {
+        if (http_ != nullptr) {
+            evhttp_free(http_);
+            http_ = nullptr;
+        }
+    }
+
+    std::string url() const {
+        return "http://127.0.0.1:" + std::to_string(port_);
+    }
+
+    std::set<uint16_t> connections; // client ports
+
+    int requests = 0;
+
+  private:
+    static void on_request(evhttp_request *req, void *ptr) {
+        auto self = static_cast<FakeCollector *>(ptr);
+        char *address = nullptr;
+        uint16_t port = 0;
+        evhttp_connection_get_peer(evhttp_request_get_connection(req),
+                                   &address, &port);
+        self->connections.insert(port);
+        self->requests += 1;
+        if (!self->keep_alive_) {
+            evhttp_add_header(evhttp_request_get_output_headers(req),
+                              "Connection", self->closing_.c_str());
+        }
+        evhttp_send_reply(req, 200, "OK", nullptr);
+    }
+
+    std::string closing_;
+    evhttp *http_ = nullptr;
+    bool keep_alive_ = true;
+    uint16_t port_ = 0;
+};
+
+static double submit_many(SharedPtr<Reactor> reactor,
+                          FakeCollector &collector, Settings settings,
+                          bool persistent, int count) {
+    SerializedEntry entry = SerializedEntry::make(ENTRY);
+    double begin = mk::monotonic_time_now();
+    reactor->run_with_initial_event([&]() {
+        auto session = collector::Session::make(settings, reactor);
+        auto left = std::make_shared<int>(count);
+        Callback<Error> cb = [&, left, session](Error err) {
+            REQUIRE(!err);
+            if (--*left <= 0) {
+                session->close([&]() {
+                    collector.stop();
+                    reactor->stop();
+                });
+            }
+        };
+        for (int i = 0; i < count; ++i) {
+            if (persistent) {
+                session->update_report("xx", entry, cb);
+            } else {
+                collector::connect_and_update_report_serialized(
+                      "xx", entry, cb, settings, reactor);
+            }
+        }
+    });
+    double elapsed = mk::monotonic_time_now() - begin;
+    return count / elapsed;
+}
+
+TEST_CASE("collector::Session reuses the connection") {
+    Logger::global()->set_verbosity(MK_LOG_INFO); // to see the rates
+    SharedPtr<Reactor> reactor = Reactor::make();
+    FakeCollector collector{reactor, true};
+    Settings settings{{"collector_base_url", collector.url()}};
+
+    SECTION("Without pipelining") {
+        double rate = submit_many(reactor, collector, settings, true, 200);
+        REQUIRE(collector.requests == 200);
+        REQUIRE(collector.connections.size() == 1);
+        Logger::global()->info("persistent: %.1f submissions/s", rate);
+    }
+
+    SECTION("With pipelining") {
+        settings["collector_pipeline_depth"] = 4;
+        double rate = submit_many(reactor, collector, settings, true, 200);
+        REQUIRE(collector.requests == 200);
+        REQUIRE(collector.connections.size() == 1);
+        Logger::global()->info("pipelined: %.1f submissions/s", rate);
+    }
+
+    SECTION("Compared to a connection per entry") {
+        double rate = submit_many(reactor, collector, settings, false, 200);
+        REQUIRE(collector.requests == 200);
+        REQUIRE(collector.connections.size() == 200);
+        Logger::global()->info("connection per entry: %.1f submissions/s",
+                               rate);
+    }
+}
+
+TEST_CASE("collector::Session reconnects when the collector closes") {
+    SharedPtr<Reactor> reactor = Reactor::make();
+
+    SECTION("When the token is lowercase") {
+        FakeCollector collector{reactor, false};
+        Settings settings{{"collector_base_url", collector.url()},
+                          {"collector_pipeline_depth", 4}};
+        submit_many(reactor, collector, settings, true, 20);
+        REQUIRE(collector.requests >= 20);
+        REQUIRE(collector.connections.size() >= 20);
+    }
+
+    SECTION("When the token is not lowercase") {
+        FakeCollector collector{reactor, false, "Close"};
+        Settings settings{{"collector_base_url", collector.url()},
+                          {"collector_pipeline_depth", 4}};
+        submit_many(reactor, collector, settings, true, 20);
+        REQUIRE(collector.requests >= 20);
+        REQUIRE(collector.connections.size() >= 20);
+    }
+}
+
+TEST_CASE("collector::Session fails if it cannot connect") {
+    SharedPtr<Reactor> reactor = Reactor::make();
+    Settings settings{{"collector_base_url", "http://127.0.0.1:1"}};
+    int failures = 0;
+    reactor->run_with_initial_event([&]() {
+        auto session = collector::Session::make(settings, reactor);
+        for (int i = 0; i < 3; ++i) {
+            session->update_report("xx", SerializedEntry::make(ENTRY),
+                                   [&](Error err) {
+                REQUIRE(err);
+                if (++failures == 3) {
+                    reactor->stop();
+                }
+            });
+        }
+    });
+    REQUIRE(failures == 3);
+}
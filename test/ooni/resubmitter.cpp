@@ -0,0 +1,212 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include "src/libmeasurement_kit/ooni/resubmitter.hpp"
+#include "src/libmeasurement_kit/report/spool.hpp"
+
+#include <event2/buffer.h>
+#include <event2/http.h>
+
+#include <stdlib.h>
+
+using namespace mk;
+using namespace mk::ooni;
+using namespace mk::report;
+
+static Entry make_entry(std::string report_id, int idx) {
+    return Entry{
+        {"data_format_version", "0.2.0"},
+        {"input", "torproject.org"},
+        {"measurement_start_time", "2016-06-04 17:53:13"},
+        {"probe_asn", "AS0"},
+        {"probe_cc", "ZZ"},
+        {"probe_ip", "127.0.0.1"},
+        {"report_id", report_id},
+        {"software_name", "measurement_kit"},
+        {"software_version", "0.2.0-alpha.1+11.1"},
+        {"test_keys", {{"idx", idx}}},
+        {"test_name", "tcp_connect"},
+        {"test_runtime", 0.253494024276733},
+        {"test_start_time", "2016-06-04 17:53:13"},
+        {"test_version", "0.0.1"},
+    };
+}
+
+// Local stand-in for the collector, running in the reactor's event base,
+// that fails the first `failures` requests and then accepts everything.
+class FakeCollector {
+  public:
+    FakeCollector(SharedPtr<Reactor> reactor, int failures)
+        : failures_{failures} {
+        http_ = evhttp_new(reactor->get_event_base());
+        REQUIRE(http_ != nullptr);
+        evhttp_set_gencb(http_, on_request, this);
+        auto handle = evhttp_bind_socket_with_handle(http_, "127.0.0.1", 0);
+        REQUIRE(handle != nullptr);
+        sockaddr_storage ss{};
+        ev_socklen_t sslen = sizeof(ss);
+        REQUIRE(getsockname(evhttp_bound_socket_get_fd(handle),
+                            (sockaddr *)&ss, &sslen) == 0);
+        port_ = ntohs(((sockaddr_in *)&ss)->sin_port);
+    }
+
+    ~FakeCollector() { stop(); }
+
+    // Note: the reactor does not leave the loop while the server is active
+    void stop() {
+        if (http_ != nullptr) {
+            evhttp_free(http_);
+            http_ = nullptr;
+        }
+    }
+
+    std::string url() const {
+        return "http://127.0.0.1:" + std::to_string(port_);
+    }
+
+    int creates = 0;
+    int closes = 0;
+    std::vector<Json> updates;
+
+  private:
+    static void on_request(evhttp_request *req, void *ptr) {
+        auto self = static_cast<FakeCollector *>(ptr);
+        if (self->failures_ > 0) {
+            self->failures_ -= 1;
+            evhttp_send_reply(req, 500, "Internal Server Error", nullptr);
+            return;
+        }
+        std::string uri = evhttp_request_get_uri(req);
+        evbuffer *input = evhttp_request_get_input_buffer(req);
+        std::string body((const char *)evbuffer_pullup(input, -1),
+                         evbuffer_get_length(input));
+        evbuffer *output = evbuffer_new();
+        if (uri == "/report") {
+            self->creates += 1;
+            std::string reply = Json{{"report_id", "new-" +
+                          std::to_string(self->creates)}}.dump();
+            evbuffer_add(output, reply.data(), reply.size());
+        } else if (uri.size() > 6 && uri.substr(uri.size() - 6) == "/close") {
+            self->closes += 1;
+        } else {
+            self->updates.push_back(Json::parse(body).at("content"));
+        }
+        evhttp_send_reply(req, 200, "OK", output);
+        evbuffer_free(output);
+    }
+
+    evhttp *http_ = nullptr;
+    int failures_ = 0;
+    uint16_t port_ = 0;
+};
+
+static std::string make_temp_dir() {
+    char name[] = "/tmp/mk-spool-XXXXXX";
+    REQUIRE(mkdtemp(name) != nullptr);
+    return name;
+}
+
+static void fill_spool(std::string dir, std::string url) {
+    auto spool = *Spool::open(dir);
+    for (int i = 0; i < 3; ++i) {
+        REQUIRE(!spool->append(url, SerializedEntry::make(make_entry("a", i))));
+    }
+    for (int i = 3; i < 5; ++i) {
+        REQUIRE(!spool->append(url, SerializedEntry::make(make_entry("b", i))));
+    }
+}
+
+static size_t pending(std::string dir) {
+    return (*Spool::open(dir))->pending()->size();
+}
+
+static std::pair<Error, collector::ResubmitStats>
+resubmit(SharedPtr<Reactor> reactor, FakeCollector *collector, std::string dir,
+         Settings settings) {
+    std::pair<Error, collector::ResubmitStats> result;
+    reactor->run_with_initial_event([&]() {
+        collector::resubmit_spool(dir, [&](Error err,
+                                           collector::ResubmitStats stats) {
+            result = {err, stats};
+            if (collector != nullptr) {
+                collector->stop();
+            }
+            reactor->stop();
+        }, settings, reactor);
+    });
+    return result;
+}
+
+TEST_CASE("resubmit_spool() works as expected") {
+    SharedPtr<Reactor> reactor = Reactor::make();
+    std::string dir = make_temp_dir();
+    Settings settings{{"spool_resubmit_backoff", 0.01}};
+
+    SECTION("Entries are resubmitted into new reports") {
+        FakeCollector collector{reactor, 0};
+        fill_spool(dir, collector.url());
+        auto result = resubmit(reactor, &collector, dir, settings);
+        REQUIRE(!result.first);
+        REQUIRE(result.second.entries == 5);
+        REQUIRE(result.second.submitted == 5);
+        REQUIRE(result.second.reports == 2);
+        REQUIRE(result.second.retries == 0);
+        REQUIRE(collector.creates == 2);
+        REQUIRE(collector.closes == 2);
+        REQUIRE(collector.updates.size() == 5);
+        std::set<int> seen;
+        for (auto &entry : collector.updates) {
+            REQUIRE(entry.at("report_id").get<std::string>().find("new-") ==
+                    0);
+            seen.insert(entry.at("test_keys").at("idx").get<int>());
+        }
+        REQUIRE(seen.size() == 5);
+        REQUIRE(pending(dir) == 0);
+    }
+
+    SECTION("Failed reports are retried") {
+        FakeCollector collector{reactor, 2};
+        fill_spool(dir, collector.url());
+        auto result = resubmit(reactor, &collector, dir, settings);
+        REQUIRE(!result.first);
+        REQUIRE(result.second.submitted == 5);
+        REQUIRE(result.second.retries == 2);
+        REQUIRE(pending(dir) == 0);
+    }
+
+    SECTION("Entries are kept when we give up") {
+        fill_spool(dir, "http://127.0.0.1:1");
+        settings["spool_resubmit_attempts"] = 2;
+        auto result = resubmit(reactor, nullptr, dir, settings);
+        REQUIRE(result.first);
+        REQUIRE(result.second.submitted == 0);
+        REQUIRE(result.second.retries == 2);
+        REQUIRE(pending(dir) == 5);
+    }
+
+    SECTION("OoniReporter spools the entries it cannot submit") {
+        settings["collector_base_url"] = "http://127.0.0.1:1";
+        settings["spool_dir"] = dir;
+        auto reporter = OoniReporter::make(settings, reactor, Logger::global());
+        Report report;
+        reactor->run_with_initial_event([&]() {
+            reporter->open(report)([&](Error err) {
+                REQUIRE(err);
+                reporter->write_entry(make_entry("", 0))([&](Error err) {
+                    REQUIRE(!err);
+                    reactor->stop();
+                });
+            });
+        });
+        auto records = *(*Spool::open(dir))->pending();
+        REQUIRE(records.size() == 1);
+        REQUIRE(records[0].collector_base_url == "http://127.0.0.1:1");
+        REQUIRE(records[0].entry.at("test_keys").at("idx") == 0);
+    }
+
+    REQUIRE(system(("rm -rf " + dir).c_str()) == 0);
+}
@@ -0,0 +1,107 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include "src/libmeasurement_kit/common/utils.hpp"
+#include "src/libmeasurement_kit/ooni/scrubber.hpp"
+#include "src/libmeasurement_kit/ooni/utils.hpp"
+
+using namespace mk;
+using namespace mk::ooni;
+
+// The straightforward implementation, for comparison
+static std::string naive_scrub(std::string s, std::string pattern) {
+    size_t p = 0;
+    while ((p = s.find(pattern, p)) != std::string::npos) {
+        s = s.replace(p, pattern.size(), "[REDACTED]");
+    }
+    return s;
+}
+
+TEST_CASE("Scrubber works as expected") {
+    SECTION("With a single pattern") {
+        Scrubber scrubber{{"1.2.3.4"}};
+        for (std::string s : {"", "1.2.3.4", "x1.2.3.4x", "1.2.3.41.2.3.4",
+                              "1.2.3.1.2.3.4", "1.2.3", "11.2.3.45",
+                              "IP: 1.2.3.4, again: 1.2.3.4."}) {
+            REQUIRE(scrubber.scrub(s) == naive_scrub(s, "1.2.3.4"));
+        }
+    }
+
+    SECTION("With many patterns") {
+        Scrubber scrubber{{"he", "she", "his", "hers"}};
+        // The longest of the matches ending at the same position wins
+        REQUIRE(scrubber.scrub("ushers") == "u[REDACTED]rs");
+        REQUIRE(scrubber.scrub("his hat") == "[REDACTED] hat");
+        REQUIRE(scrubber.scrub("the hers") == "t[REDACTED] [REDACTED]rs");
+    }
+
+    SECTION("The output is only written if there is a match") {
+        Scrubber scrubber{{"1.2.3.4"}};
+        std::string out = "unchanged";
+        REQUIRE(scrubber.scrub("5.6.7.8", out) == 0);
+        REQUIRE(out == "unchanged");
+        REQUIRE(scrubber.scrub("1.2.3.4 and 1.2.3.4", out) == 2);
+        REQUIRE(out == "[REDACTED] and [REDACTED]");
+    }
+
+    SECTION("An empty scrubber does nothing") {
+        Scrubber scrubber;
+        REQUIRE(scrubber.empty());
+        REQUIRE(scrubber.scrub("1.2.3.4") == "1.2.3.4");
+        REQUIRE(Scrubber{{""}}.empty());
+    }
+
+    SECTION("IPv6 addresses are matched in all their forms") {
+        Scrubber scrubber = Scrubber::for_probe_ip("2001:db8::ff00:42:8329");
+        for (std::string s : {"2001:db8::ff00:42:8329",
+                              "2001:0db8:0000:0000:0000:ff00:0042:8329",
+                              "2001:db8:0:0:0:ff00:42:8329",
+                              "2001:DB8::FF00:42:8329"}) {
+            REQUIRE(scrubber.scrub("[" + s + "]:443") == "[[REDACTED]]:443");
+        }
+    }
+
+    SECTION("The whole entry can be scrubbed in place") {
+        Scrubber scrubber = Scrubber::for_probe_ip("1.2.3.4");
+        report::Entry entry{
+              {"probe_ip", "127.0.0.1"},
+              {"test_keys",
+               {{"requests",
+                 {{{"response", {{"body", "Your IP is 1.2.3.4"}}}}}},
+                {"1.2.3.4", 17},
+                {"list", {"1.2.3.4", 1, nullptr, "foo"}}}}};
+        REQUIRE(scrubber.scrub_entry(entry) == 2);
+        REQUIRE(entry["test_keys"]["requests"][0]["response"]["body"] ==
+                "Your IP is [REDACTED]");
+        REQUIRE(entry["test_keys"]["list"][0] == "[REDACTED]");
+        REQUIRE(entry["test_keys"]["1.2.3.4"] == 17); // keys are unchanged
+    }
+}
+
+TEST_CASE("scrub() works as expected") {
+    REQUIRE(scrub("IP: 1.2.3.4", "1.2.3.4") == "IP: [REDACTED]");
+}
+
+TEST_CASE("Scrubber is faster than repeated find and replace") {
+    // Large body with many occurrences of the probe IP
+    std::string body;
+    for (size_t i = 0; i < 20000; ++i) {
+        body += "<p>Your address is 130.192.91.211 and ";
+        body += "2001:db8::ff00:42:8329</p>\n";
+    }
+    Scrubber scrubber = Scrubber::for_probe_ip("130.192.91.211");
+    double t0 = mk::monotonic_time_now();
+    std::string fast = scrubber.scrub(body);
+    double t1 = mk::monotonic_time_now();
+    std::string slow = naive_scrub(body, "130.192.91.211");
+    double t2 = mk::monotonic_time_now();
+    REQUIRE(fast == slow);
+    Logger::global()->set_verbosity(MK_LOG_INFO); // to see the timings
+    Logger::global()->info("scrub %zu bytes: single pass %.4f s, "
+                           "find and replace %.4f s",
+                           body.size(), t1 - t0, t2 - t1);
+}
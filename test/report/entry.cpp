@@ -5,11 +5,41 @@
 #define CATCH_CONFIG_MAIN
 #include "src/libmeasurement_kit/ext/catch.hpp"
 
+#include "src/libmeasurement_kit/common/json_writer.hpp"
+#include "src/libmeasurement_kit/common/utils.hpp"
+
 #include <measurement_kit/report.hpp>
 
+#include <cstdlib>
+#include <new>
+
 using namespace mk::report;
 using namespace mk;
 
+// Count the allocations, to check that entries are not needlessly copied
+static size_t allocations = 0;
+
+void *operator new(size_t size) {
+    ++allocations;
+    void *p = malloc(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+
+static Entry make_test_keys() {
+    Entry test_keys;
+    for (int i = 0; i < 100; ++i) {
+        test_keys["requests"].push_back(
+              {{"request", {{"url", "http://www.example.com/"}}},
+               {"response", {{"body", std::string(100, 'x')}}}});
+    }
+    return test_keys;
+}
+
 TEST_CASE("By default we have an empty entry") {
     Entry entry;
     REQUIRE(entry.dump() == "null");
@@ -95,3 +125,82 @@ TEST_CASE("Make sure it does not throw when accessing nonexistent key") {
     Entry entry{{"foo", "bar"}, {"baz", 17.0}};
     REQUIRE((entry["bar"] == nullptr));
 }
+
+TEST_CASE("SerializedEntry works as expected") {
+    Entry entry{{"foo", "bar"}, {"baz", 17.0}};
+    SerializedEntry se = SerializedEntry::make(entry);
+    REQUIRE(se.str() == entry.dump());
+    REQUIRE(se.entry().dump() == entry.dump());
+    REQUIRE(se.hash().size() == 64);
+
+    SECTION("Equal entries have the same hash") {
+        REQUIRE(SerializedEntry::make(entry).hash() == se.hash());
+    }
+
+    SECTION("Different entries have different hashes") {
+        entry["baz"] = 18.0;
+        REQUIRE(SerializedEntry::make(entry).hash() != se.hash());
+    }
+
+    SECTION("Copies share the same serialization") {
+        SerializedEntry copy = se;
+        REQUIRE(&copy.str() == &se.str());
+    }
+}
+
+TEST_CASE("SerializedEntry serializes once") {
+    Entry entry{{"input", "x\ny"}, {"test_keys", {{"list", {1, 2.5, nullptr}}}}};
+    std::string expect = entry.dump();
+    SerializedEntry se = SerializedEntry::make(entry);
+    REQUIRE(se.hash() == sha256_of(expect));
+    REQUIRE(se.str() == expect);
+
+    // Changing the entry after make() shows that write() does not walk the
+    // entry again but writes the serialization computed by make()
+    const_cast<Entry &>(se.entry())["input"] = "z";
+    std::string written;
+    StringSink sink{written};
+    REQUIRE(!se.write(sink));
+    REQUIRE(written == expect);
+}
+
+TEST_CASE("Large trees are moved rather than copied") {
+    Entry test_keys = make_test_keys();
+    size_t before = allocations;
+    Json copy = static_cast<const Json &>(test_keys);
+    size_t one_copy = allocations - before;
+    REQUIRE(one_copy > 100);
+
+    SECTION("When assigning a copy") {
+        Entry entry;
+        before = allocations;
+        entry["test_keys"] = static_cast<const Entry &>(test_keys);
+        REQUIRE(allocations - before < one_copy + 10);
+        REQUIRE(static_cast<const Json &>(entry["test_keys"]) == copy);
+    }
+
+    SECTION("When assigning a temporary") {
+        Entry entry;
+        before = allocations;
+        entry["test_keys"] = std::move(test_keys);
+        REQUIRE(allocations - before < 10);
+        REQUIRE(static_cast<const Json &>(entry["test_keys"]) == copy);
+    }
+
+    SECTION("When converting") {
+        before = allocations;
+        Entry entry(std::move(copy));
+        REQUIRE(allocations - before < 10);
+        REQUIRE(static_cast<const Json &>(entry) ==
+                static_cast<const Json &>(test_keys));
+    }
+
+    SECTION("When appending") {
+        Entry entry;
+        Entry other = make_test_keys();
+        before = allocations;
+        entry.push_back(std::move(other));
+        REQUIRE(allocations - before < 10);
+        REQUIRE(static_cast<const Json &>(entry[0]) == copy);
+    }
+}
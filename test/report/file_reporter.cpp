@@ -9,6 +9,8 @@
 
 #include <measurement_kit/report.hpp>
 
+#include <zlib.h>
+
 using namespace mk::report;
 using namespace mk;
 
@@ -79,3 +81,207 @@ TEST_CASE(
             }, Logger::global());
         });
     }
+
+static std::vector<std::string> read_lines(std::string filename) {
+    std::vector<std::string> lines;
+    std::ifstream infile(filename);
+    for (std::string line; getline(infile, line);) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+static void write_many(SharedPtr<Reactor> reactor, Settings settings,
+                       std::string filename, int count,
+                       SharedPtr<BaseReporter> &reporter) {
+    Report report;
+    report.test_name = "example_test";
+    reporter = FileReporter::make(filename, settings, reactor,
+                                  Logger::global());
+    report.add_reporter(reporter);
+    reactor->run_with_initial_event([&]() {
+        report.open([&](Error err) {
+            REQUIRE(!err);
+            // Note: submit all the entries at the same time, like it
+            // happens when running a nettest with parallelism
+            auto left = std::make_shared<int>(count);
+            for (int i = 0; i < count; ++i) {
+                Entry entry{{"idx", i}};
+                report.write_entry(entry, [&, left](Error err) {
+                    REQUIRE(!err);
+                    if (--*left > 0) {
+                        return;
+                    }
+                    report.close([&](Error err) {
+                        REQUIRE(!err);
+                        reactor->stop();
+                    });
+                }, Logger::global());
+            }
+        });
+    });
+}
+
+TEST_CASE("The buffered mode works as expected") {
+    SharedPtr<Reactor> reactor = Reactor::make();
+    SharedPtr<BaseReporter> reporter;
+    std::string filename("example_buffered_report.njson");
+    Settings settings{{"file_report_buffer_size", 4096}};
+
+    SECTION("With durability none") {
+        settings["file_report_durability"] = "none";
+        write_many(reactor, settings, filename, 1000, reporter);
+        auto stats = reporter.as<FileReporter>()->stats();
+        REQUIRE(stats.entries == 1000);
+        REQUIRE(stats.fsyncs == 0);
+        REQUIRE(stats.commits < 1000); // Entries are committed in groups
+    }
+
+    SECTION("With durability interval") {
+        settings["file_report_durability"] = "interval";
+        write_many(reactor, settings, filename, 1000, reporter);
+        auto stats = reporter.as<FileReporter>()->stats();
+        REQUIRE(stats.entries == 1000);
+        REQUIRE(stats.fsyncs >= 1); // At least when closing
+    }
+
+    SECTION("With durability entry") {
+        settings["file_report_durability"] = "entry";
+        write_many(reactor, settings, filename, 1000, reporter);
+        auto stats = reporter.as<FileReporter>()->stats();
+        REQUIRE(stats.entries == 1000);
+        REQUIRE(stats.fsyncs == stats.commits);
+        REQUIRE(stats.commits < 1000); // Entries are committed in groups
+    }
+
+    auto lines = read_lines(filename);
+    REQUIRE(lines.size() == 1000);
+    for (size_t i = 0; i < lines.size(); ++i) {
+        REQUIRE(Json::parse(lines[i])["idx"] == i);
+    }
+    auto stats = reporter.as<FileReporter>()->stats();
+    REQUIRE(stats.bytes > 0);
+    REQUIRE(stats.entry_latency_max >= stats.commit_latency_max);
+}
+
+TEST_CASE("The buffered mode rejects an invalid durability") {
+    Report report;
+    SharedPtr<BaseReporter> reporter = FileReporter::make(
+          "example_buffered_report.njson",
+          {{"file_report_buffer_size", 4096},
+           {"file_report_durability", "foobar"}});
+    reporter->open(report)([](Error err) {
+        REQUIRE(err == ValueError());
+    });
+}
+
+static std::vector<std::string> read_gzip_lines(std::string filename) {
+    std::vector<std::string> lines;
+    gzFile file = gzopen(filename.c_str(), "rb");
+    REQUIRE(file != nullptr);
+    std::string line;
+    char buf[4096];
+    int n;
+    while ((n = gzread(file, buf, sizeof(buf))) > 0) {
+        for (int i = 0; i < n; ++i) {
+            if (buf[i] == '\n') {
+                lines.push_back(line);
+                line = "";
+            } else {
+                line += buf[i];
+            }
+        }
+    }
+    REQUIRE(n == 0);
+    gzclose(file);
+    return lines;
+}
+
+static size_t count_gzip_members(std::string filename) {
+    std::ifstream infile(filename, std::ios::binary);
+    std::string data{std::istreambuf_iterator<char>(infile),
+                     std::istreambuf_iterator<char>()};
+    size_t count = 0;
+    while (data.size() > 0) {
+        z_stream stream{};
+        REQUIRE(inflateInit2(&stream, 15 + 16) == Z_OK);
+        std::vector<char> out(65536);
+        stream.next_in = (Bytef *)data.data();
+        stream.avail_in = (uInt)data.size();
+        int ret;
+        do {
+            stream.next_out = (Bytef *)out.data();
+            stream.avail_out = (uInt)out.size();
+            ret = inflate(&stream, Z_NO_FLUSH);
+        } while (ret == Z_OK);
+        REQUIRE(ret == Z_STREAM_END);
+        data = data.substr(data.size() - stream.avail_in);
+        inflateEnd(&stream);
+        ++count;
+    }
+    return count;
+}
+
+TEST_CASE("The report can be compressed") {
+    SharedPtr<Reactor> reactor = Reactor::make();
+    SharedPtr<BaseReporter> reporter;
+    std::string filename("example_compressed_report.njson.gz");
+    Settings settings{{"file_report_frame_entries", 64}};
+
+    SECTION("With the default writer") {
+        write_many(reactor, settings, filename, 1000, reporter);
+    }
+
+    SECTION("With the buffered writer") {
+        settings["file_report_buffer_size"] = 4096;
+        write_many(reactor, settings, filename, 1000, reporter);
+        auto stats = reporter.as<FileReporter>()->stats();
+        REQUIRE(stats.entries == 1000);
+    }
+
+    REQUIRE(count_gzip_members(filename) == 16); // 1000 / 64, rounded up
+    auto lines = read_gzip_lines(filename);
+    REQUIRE(lines.size() == 1000);
+    for (size_t i = 0; i < lines.size(); ++i) {
+        REQUIRE(Json::parse(lines[i])["idx"] == i);
+    }
+}
+
+#ifndef _WIN32
+
+TEST_CASE("Errors are sticky when compressing") {
+    // Writing on /dev/full fails with ENOSPC
+    SharedPtr<Reactor> reactor = Reactor::make();
+    Report report;
+    SharedPtr<BaseReporter> reporter = FileReporter::make(
+          "/dev/full",
+          {{"file_report_compression", "gzip"},
+           {"file_report_frame_entries", 2}},
+          reactor, Logger::global());
+    std::vector<Error> errors;
+    reactor->run_with_initial_event([&]() {
+        reporter->open(report)([&](Error err) {
+            REQUIRE(!err);
+            reporter->write_entry(Entry{{"idx", 0}})([&](Error err) {
+                errors.push_back(err); // Only kept in memory
+                reporter->write_entry(Entry{{"idx", 1}})([&](Error err) {
+                    errors.push_back(err); // The frame is written
+                    reporter->write_entry(Entry{{"idx", 2}})([&](Error err) {
+                        errors.push_back(err);
+                        reporter->close()([&](Error err) {
+                            errors.push_back(err);
+                            reactor->stop();
+                        });
+                    });
+                });
+            });
+        });
+    });
+    REQUIRE(errors.size() == 4);
+    REQUIRE(errors[0] == NoError());
+    REQUIRE(errors[1] != NoError());
+    REQUIRE(errors[2] == errors[1]);
+    REQUIRE(errors[3] == errors[1]);
+}
+
+#endif
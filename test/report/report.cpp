@@ -216,6 +216,59 @@ TEST_CASE("We can retry a partially successful write_entry()") {
     REQUIRE(failing_reporter->write_count == 2);
 }
 
+class SerializedReporter : public BaseReporter {
+  public:
+    static SharedPtr<SerializedReporter> make() {
+        return SharedPtr<SerializedReporter>(new SerializedReporter);
+    }
+
+    ~SerializedReporter() override;
+
+    Continuation<Error> write_entry(SerializedEntry e) override {
+        return do_write_entry_(e, [=](Callback<Error> cb) {
+            written.push_back(&e.str());
+            cb(NoError());
+        });
+    }
+
+    std::vector<const std::string *> written;
+};
+
+SerializedReporter::~SerializedReporter() {}
+
+TEST_CASE("write_entry() serializes the entry only once") {
+    SharedPtr<SerializedReporter> first = SerializedReporter::make();
+    SharedPtr<SerializedReporter> second = SerializedReporter::make();
+    SharedPtr<CountedReporter> legacy = CountedReporter::make();
+    Report report;
+    report.add_reporter(first.as<BaseReporter>());
+    report.add_reporter(second.as<BaseReporter>());
+    report.add_reporter(legacy.as<BaseReporter>());
+    report.open([&](Error err) {
+        REQUIRE(!err);
+        Entry entry{{"foobar", 1}};
+        ErrorOr<SerializedEntry> se = report.serialize_entry(entry,
+                                                             Logger::global());
+        REQUIRE(!!se);
+        report.write_entry(*se, [&](Error err) {
+            REQUIRE(!err);
+            REQUIRE(first->written.size() == 1);
+            REQUIRE(second->written.size() == 1);
+            REQUIRE(first->written[0] == second->written[0]);
+            REQUIRE(legacy->write_count == 1);
+            report.write_entry(*se, [&](Error err) {
+                REQUIRE(!err);
+                REQUIRE(err.child_errors.size() == 3);
+                for (auto &e : err.child_errors) {
+                    REQUIRE(e.child_errors.size() == 1);
+                    REQUIRE(e.child_errors[0] == DuplicateEntrySubmitError());
+                }
+                REQUIRE(first->written.size() == 1);
+            }, Logger::global());
+        }, Logger::global());
+    });
+}
+
 TEST_CASE("The close() method works correctly") {
     Report report;
     report.add_reporter(BaseReporter::make());
@@ -0,0 +1,106 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include "src/libmeasurement_kit/report/spool.hpp"
+
+#include <fstream>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace mk;
+using namespace mk::report;
+
+static std::string make_temp_dir() {
+    char name[] = "/tmp/mk-spool-XXXXXX";
+    REQUIRE(mkdtemp(name) != nullptr);
+    return name;
+}
+
+static SerializedEntry make_entry(int i) {
+    return SerializedEntry::make(Entry{{"idx", i}, {"report_id", "xx"}});
+}
+
+TEST_CASE("Spool works as expected") {
+    std::string dir = make_temp_dir();
+
+    SECTION("Appended entries are pending until submitted") {
+        auto spool = *Spool::open(dir, 1 << 20);
+        for (int i = 0; i < 3; ++i) {
+            REQUIRE(!spool->append("https://c.example.org", make_entry(i)));
+        }
+        auto records = *spool->pending();
+        REQUIRE(records.size() == 3);
+        for (int i = 0; i < 3; ++i) {
+            REQUIRE(records[i].collector_base_url == "https://c.example.org");
+            REQUIRE(records[i].entry.at("idx") == i);
+        }
+        REQUIRE(!spool->mark_submitted(records[1]));
+        auto left = *spool->pending();
+        REQUIRE(left.size() == 2);
+        REQUIRE(left[0].entry.at("idx") == 0);
+        REQUIRE(left[1].entry.at("idx") == 2);
+    }
+
+    SECTION("The state survives reopening the spool") {
+        {
+            auto spool = *Spool::open(dir, 1 << 20);
+            REQUIRE(!spool->append("https://c.example.org", make_entry(0)));
+            REQUIRE(!spool->append("https://c.example.org", make_entry(1)));
+            REQUIRE(!spool->mark_submitted((*spool->pending())[0]));
+        }
+        auto spool = *Spool::open(dir, 1 << 20);
+        auto records = *spool->pending();
+        REQUIRE(records.size() == 1);
+        REQUIRE(records[0].entry.at("idx") == 1);
+    }
+
+    SECTION("Segments are rotated and compacted") {
+        // Small segments so that each entry gets its own segment
+        auto spool = *Spool::open(dir, 1);
+        for (int i = 0; i < 4; ++i) {
+            REQUIRE(!spool->append("https://c.example.org", make_entry(i)));
+        }
+        auto records = *spool->pending();
+        REQUIRE(records.size() == 4);
+        REQUIRE(records[0].segment != records[1].segment);
+        for (auto &record : records) {
+            REQUIRE(!spool->mark_submitted(record));
+        }
+        REQUIRE(!spool->compact());
+        // The last segment is kept because we may still append to it
+        REQUIRE(!std::ifstream{dir + "/" + records[0].segment}.good());
+        REQUIRE(!std::ifstream{dir + "/" + records[2].segment}.good());
+        REQUIRE(std::ifstream{dir + "/" + records[3].segment}.good());
+        REQUIRE(spool->pending()->size() == 0);
+        REQUIRE(!spool->append("https://c.example.org", make_entry(4)));
+        auto left = *spool->pending();
+        REQUIRE(left.size() == 1);
+        REQUIRE(left[0].entry.at("idx") == 4);
+    }
+
+    SECTION("A truncated last record is skipped") {
+        auto spool = *Spool::open(dir, 1 << 20);
+        REQUIRE(!spool->append("https://c.example.org", make_entry(0)));
+        std::string segment = (*spool->pending())[0].segment;
+        {
+            std::ofstream file{dir + "/" + segment, std::ios::app};
+            file << "{\"collector_base_url\":\"https://c.exa";
+        }
+        REQUIRE(spool->pending()->size() == 1);
+        REQUIRE(!spool->append("https://c.example.org", make_entry(1)));
+        auto records = *spool->pending();
+        REQUIRE(records.size() == 2);
+        REQUIRE(records[1].entry.at("idx") == 1);
+    }
+
+    SECTION("Open fails if the directory cannot be created") {
+        REQUIRE(!Spool::open("/nonexistent/spool"));
+    }
+
+    REQUIRE(system(("rm -rf " + dir).c_str()) == 0);
+}
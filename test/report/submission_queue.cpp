@@ -0,0 +1,148 @@
+// Part of Measurement Kit <https://measurement-kit.github.io/>.
+// Measurement Kit is free software under the BSD license. See AUTHORS
+// and LICENSE for more information on the copying conditions.
+
+#define CATCH_CONFIG_MAIN
+#include "src/libmeasurement_kit/ext/catch.hpp"
+
+#include "src/libmeasurement_kit/report/submission_queue.hpp"
+
+using namespace mk;
+using namespace mk::report;
+
+static SerializedEntry make_entry(int i) {
+    return SerializedEntry::make(Entry{{"idx", i}});
+}
+
+TEST_CASE("SubmissionQueue works as expected") {
+    SharedPtr<Reactor> reactor = Reactor::make();
+
+    SECTION("Entries are written in order with bounded concurrency") {
+        std::vector<int> written;
+        size_t active = 0, max_active = 0;
+        auto queue = SubmissionQueue::make(
+              4, 2,
+              [&](SerializedEntry entry, Callback<Error> cb) {
+                  max_active = std::max(max_active, ++active);
+                  written.push_back(entry.entry().at("idx"));
+                  reactor->call_later(0.01, [&, cb]() {
+                      --active;
+                      cb(NoError());
+                  });
+              },
+              reactor);
+        reactor->run_with_initial_event([&]() {
+            for (int i = 0; i < 10; ++i) {
+                queue->push(make_entry(i), [](Error err) { REQUIRE(!err); });
+            }
+            queue->flush([&](Error err) {
+                REQUIRE(!err);
+                REQUIRE(active == 0);
+                reactor->stop();
+            });
+        });
+        REQUIRE(written == (std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+        REQUIRE(max_active == 2);
+        REQUIRE(queue->stats().entries == 10);
+        REQUIRE(queue->stats().max_active == 2);
+    }
+
+    SECTION("The producer does not wait for slow writers") {
+        int accepted = 0;
+        auto queue = SubmissionQueue::make(
+              8, 1,
+              [&](SerializedEntry, Callback<Error> cb) {
+                  reactor->call_later(0.1, [cb]() { cb(NoError()); });
+              },
+              reactor);
+        reactor->run_with_initial_event([&]() {
+            for (int i = 0; i < 4; ++i) {
+                queue->push(make_entry(i), [&](Error err) {
+                    REQUIRE(!err);
+                    accepted += 1;
+                });
+            }
+            // All entries must be accepted well before the first is written
+            reactor->call_later(0.05, [&]() {
+                REQUIRE(accepted == 4);
+                queue->flush([&](Error) { reactor->stop(); });
+            });
+        });
+        REQUIRE(queue->stats().stalls == 0);
+    }
+
+    SECTION("The producer waits when the queue is full") {
+        int accepted = 0;
+        std::vector<int> accepted_after;
+        int writes = 0;
+        auto queue = SubmissionQueue::make(
+              2, 1,
+              [&](SerializedEntry, Callback<Error> cb) {
+                  reactor->call_later(0.01, [&, cb]() {
+                      writes += 1;
+                      cb(NoError());
+                  });
+              },
+              reactor);
+        reactor->run_with_initial_event([&]() {
+            // One entry is being written and two are queued; the others
+            // can only be accepted after some entries are written
+            for (int i = 0; i < 6; ++i) {
+                queue->push(make_entry(i), [&](Error err) {
+                    REQUIRE(!err);
+                    accepted += 1;
+                    accepted_after.push_back(writes);
+                });
+            }
+            queue->flush([&](Error err) {
+                REQUIRE(!err);
+                reactor->stop();
+            });
+        });
+        REQUIRE(accepted == 6);
+        REQUIRE(accepted_after == (std::vector<int>{0, 0, 0, 1, 2, 3}));
+        REQUIRE(queue->stats().stalls == 3);
+        REQUIRE(queue->stats().max_queued == 5);
+    }
+
+    SECTION("The first error is sticky") {
+        int writes = 0;
+        auto queue = SubmissionQueue::make(
+              1, 1,
+              [&](SerializedEntry, Callback<Error> cb) {
+                  writes += 1;
+                  reactor->call_soon([cb]() { cb(MockedError()); });
+              },
+              reactor);
+        reactor->run_with_initial_event([&]() {
+            queue->push(make_entry(0), [](Error err) { REQUIRE(!err); });
+            queue->push(make_entry(1), [](Error err) { REQUIRE(!err); });
+            queue->push(make_entry(2), [](Error err) {
+                REQUIRE(err == MockedError());
+            });
+            queue->flush([&](Error err) {
+                REQUIRE(err == MockedError());
+                queue->push(make_entry(3), [&](Error err) {
+                    REQUIRE(err == MockedError());
+                    reactor->stop();
+                });
+            });
+        });
+        REQUIRE(writes == 1);
+    }
+
+    SECTION("Flushing an empty queue works") {
+        auto queue = SubmissionQueue::make(
+              1, 1, [](SerializedEntry, Callback<Error>) { REQUIRE(false); },
+              reactor);
+        bool flushed = false;
+        reactor->run_with_initial_event([&]() {
+            queue->flush([&](Error err) {
+                REQUIRE(!err);
+                flushed = true;
+                reactor->stop();
+            });
+        });
+        REQUIRE(flushed);
+    }
+}